@@ -656,6 +656,35 @@ namespace hpc
                             "Fix build setup for compatibility with more linux distros",
                         }
                     },                    
+                    { "6.3.0.0",
+                        {
+                            "Launch tasks directly without generating cmd.sh and run_dir_in_out.sh when the start info needs no shell expansion",
+                            "Restrict cpuset.mems to the NUMA nodes covering the task affinity, add CCP_NUMA_POLICY (local, interleave, none) and report NUMA local/remote pages per task",
+                            "Add AffinityMode configuration and CCP_AFFINITY_MODE (identity, physical-core-first, compact-l3) for mapping scheduler cores to logical cpus by SMT and L3 topology, and report overlapping task cpusets",
+                            "Support per-task cgroup v1/v2 limits through CCP_MEMORY_LIMIT_MB, CCP_MEMORY_HIGH_MB, CCP_PIDS_MAX, CCP_IO_WEIGHT, CCP_IO_MAX and CCP_CPU_QUOTA_PERCENT, and report OOM kill and cpu throttling counts",
+                            "Trace per-phase task startup timestamps, expose the latency histograms on the debug GET endpoint 'startuptrace' and add the breakdown to the task message when startup exceeds StartupTraceThresholdMs",
+                            "Read the task cgroup statistics natively with pread on files kept open instead of running Statistics.sh, and support cgroup v2 for them",
+                            "Sample the task statistics on a background thread every StatisticsSampleInterval seconds, the heartbeat only copies the latest snapshot",
+                            "Terminate tasks natively by freezing the cgroup (or cgroup.kill on v2) and signaling every process, and wait for the cgroup to be empty by inotify on cgroup.events with a 1s deadline",
+                            "Schedule the task cancel grace period kills on one hierarchical timer wheel instead of a sleeping thread per task",
+                            "End the tasks of a job in parallel outside of the executor lock, and remove the job user keys in the background",
+                            "Report task RSS, page cache, major faults, p50/p95 RSS over a downsampled history and cgroup v2 cpu/memory/io stall time on completion, and add the node PSI counters Pressure Some Stall (%) and Pressure Full Stall (%)",
+                            "Report task block I/O bytes, operations and IOPS from blkio or io.stat, and network bytes of tasks in their own network namespace",
+                            "Track the process tree of tasks without cgroup from /proc, with descendants found by parent links and reparented processes by session, for statistics and termination instead of pstree",
+                            "Split the executor lock into task, process and user locks, provision users once per user outside of them and expose the lock wait and hold times on the debug GET endpoint 'lockstats'",
+                            "Cache the user provisioning by key fingerprint, derive ssh public keys with OpenSSL, write key files natively and rewrite authorized_keys atomically under a folder lock with the key lines reference counted per job",
+                            "Maintain the running job, task and cores in use counts incrementally in the job task table, the metric collectors read them without locking",
+                            "Add the HeartbeatDelta configuration to send only the tasks changed since the last acknowledged heartbeat sequence, with full snapshots after the start, a resync or on request of the server",
+                            "Serialize the heartbeat, register, completion and output payloads with a streaming json writer instead of building json values",
+                            "Read the start requests straight from the request body into the arguments, pass the body to the start filters as is, skip them when they are not present and move the start info into the process",
+                            "Report the task completions from a dispatcher keeping the connection, coalesce the ones within TaskCompletionCoalesceMs into one request with TaskCompletionBatching or concurrent requests otherwise, and retry each with backoff before a resync",
+                            "Journal the task completions to the CompletionOutboxFile, a memory mapped file with crc checked records bounded by CompletionOutboxSizeMb, until the scheduler acknowledges them, and replay the pending ones in order after a reconnect or a restart",
+                            "Journal the running tasks and the job users to the StateJournalFile, and adopt the surviving tasks after a restart instead of killing them, only the tasks unknown to the journal are cleaned up",
+                            "Share one keep-alive client per scheme, host and port among all the outbound requests, with the trusted CAs loaded once and at most HttpMaxConnectionsPerEndpoint requests in flight per endpoint, the reuse counters are listed by the httpclients debug endpoint",
+                            "Share one client ssl context reloaded only when the trusted CA files change, and resume the last tls session of each endpoint on reconnect, the handshake counters are listed by the tlssessions debug endpoint",
+                            "Stream the clusrun output through a sender thread per task, reading the pipe in 64KB and coalescing up to 64KB or 100ms per ordered request, and block the task output only when 4MB is waiting for the head node",
+                        }
+                    },
                 };
 
                 return versionHistory;
@@ -54,3 +54,57 @@ ProcessStartInfo ProcessStartInfo::FromJson(const web::json::value& jsonValue)
     return std::move(startInfo);
 }
 
+
+ProcessStartInfo ProcessStartInfo::FromJson(JsonReader& reader)
+{
+    ProcessStartInfo startInfo;
+    bool hasRequeueCount = false;
+    std::string key, name;
+
+    reader.StartObject();
+    while (reader.NextKey(key))
+    {
+        if (key == "commandLine") { reader.ReadString(startInfo.CommandLine); }
+        else if (key == "stdin") { reader.ReadString(startInfo.StdInFile); }
+        else if (key == "stdout") { reader.ReadString(startInfo.StdOutFile); }
+        else if (key == "stderr") { reader.ReadString(startInfo.StdErrFile); }
+        else if (key == "workingDirectory") { reader.ReadString(startInfo.WorkDirectory); }
+        else if (key == "taskRequeueCount")
+        {
+            startInfo.TaskRequeueCount = reader.ReadInt();
+            hasRequeueCount = true;
+        }
+        else if (key == "affinity")
+        {
+            if (reader.ReadNull()) { continue; }
+
+            reader.StartArray();
+            while (reader.NextElement())
+            {
+                startInfo.Affinity.push_back(reader.ReadUInt64());
+            }
+        }
+        else if (key == "environmentVariables")
+        {
+            if (reader.ReadNull()) { continue; }
+
+            // the names and values are decoded into the map entries, nothing is copied afterwards.
+            reader.StartObject();
+            while (reader.NextKey(name))
+            {
+                reader.ReadString(startInfo.EnvironmentVariables[std::move(name)]);
+            }
+        }
+        else
+        {
+            reader.Skip();
+        }
+    }
+
+    if (!hasRequeueCount)
+    {
+        throw std::runtime_error("cannot get value from json object");
+    }
+
+    return std::move(startInfo);
+}
@@ -7,6 +7,8 @@
 
 #include <cpprest/json.h>
 
+#include "../utils/JsonReader.h"
+
 namespace hpc
 {
     namespace arguments
@@ -24,9 +26,12 @@ namespace hpc
                     std::vector<uint64_t>&& affinity,
                     std::map<std::string, std::string>&& enviVars);
 
+                ProcessStartInfo() : TaskRequeueCount(0) { }
                 ProcessStartInfo(ProcessStartInfo&& startInfo) = default;
+                ProcessStartInfo& operator=(ProcessStartInfo&& startInfo) = default;
 
                 static ProcessStartInfo FromJson(const web::json::value& jsonValue);
+                static ProcessStartInfo FromJson(hpc::utils::JsonReader& reader);
                 web::json::value ToJson() const;
 
                 std::string CommandLine;
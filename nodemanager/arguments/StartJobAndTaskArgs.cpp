@@ -1,4 +1,5 @@
 #include "StartJobAndTaskArgs.h"
+#include "StartTaskArgs.h"
 #include "../utils/JsonHelper.h"
 #include "../utils/Logger.h"
 
@@ -57,3 +58,36 @@ StartJobAndTaskArgs StartJobAndTaskArgs::FromJson(const json::value& j)
     return std::move(args);
 }
 
+StartJobAndTaskArgs StartJobAndTaskArgs::FromJson(JsonReader& reader)
+{
+    StartJobAndTaskArgs args(0, 0, ProcessStartInfo(), std::string(), std::string());
+    bool hasIds = false, hasStartInfo = false;
+    std::string key;
+
+    reader.StartObject();
+    while (reader.NextKey(key))
+    {
+        if (key == "m_Item1")
+        {
+            StartTaskArgs::ReadJobTaskId(reader, args.JobId, args.TaskId);
+            hasIds = true;
+        }
+        else if (key == "m_Item2")
+        {
+            args.StartInfo = ProcessStartInfo::FromJson(reader);
+            hasStartInfo = true;
+        }
+        else if (key == "m_Item3") { reader.ReadString(args.UserName); }
+        else if (key == "m_Item4") { reader.ReadString(args.Password); }
+        else if (key == "m_Item5") { reader.ReadString(args.PrivateKey); }
+        else if (key == "m_Item6") { reader.ReadString(args.PublicKey); }
+        else { reader.Skip(); }
+    }
+
+    if (!hasIds || !hasStartInfo)
+    {
+        throw std::runtime_error("cannot get value from json object");
+    }
+
+    return std::move(args);
+}
@@ -32,6 +32,7 @@ namespace hpc
                 std::string PublicKey;
 
                 static StartJobAndTaskArgs FromJson(const web::json::value& jsonValue);
+                static StartJobAndTaskArgs FromJson(hpc::utils::JsonReader& reader);
 
             protected:
             private:
@@ -20,3 +20,55 @@ StartTaskArgs StartTaskArgs::FromJson(const json::value& j)
     return std::move(args);
 }
 
+
+StartTaskArgs StartTaskArgs::FromJson(JsonReader& reader)
+{
+    StartTaskArgs args(0, 0, ProcessStartInfo());
+    bool hasIds = false, hasStartInfo = false;
+    std::string key;
+
+    reader.StartObject();
+    while (reader.NextKey(key))
+    {
+        if (key == "m_Item1")
+        {
+            ReadJobTaskId(reader, args.JobId, args.TaskId);
+            hasIds = true;
+        }
+        else if (key == "m_Item2")
+        {
+            args.StartInfo = ProcessStartInfo::FromJson(reader);
+            hasStartInfo = true;
+        }
+        else
+        {
+            reader.Skip();
+        }
+    }
+
+    if (!hasIds || !hasStartInfo)
+    {
+        throw std::runtime_error("cannot get value from json object");
+    }
+
+    return std::move(args);
+}
+
+void StartTaskArgs::ReadJobTaskId(JsonReader& reader, int& jobId, int& taskId)
+{
+    bool hasJobId = false, hasTaskId = false;
+    std::string key;
+
+    reader.StartObject();
+    while (reader.NextKey(key))
+    {
+        if (key == "JobId") { jobId = reader.ReadInt(); hasJobId = true; }
+        else if (key == "TaskId") { taskId = reader.ReadInt(); hasTaskId = true; }
+        else { reader.Skip(); }
+    }
+
+    if (!hasJobId || !hasTaskId)
+    {
+        throw std::runtime_error("cannot get value from json object");
+    }
+}
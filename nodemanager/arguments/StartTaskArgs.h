@@ -19,6 +19,10 @@ namespace hpc
                 ProcessStartInfo StartInfo;
 
                 static StartTaskArgs FromJson(const web::json::value& jsonValue);
+                static StartTaskArgs FromJson(hpc::utils::JsonReader& reader);
+
+                // the m_Item1 of the start requests.
+                static void ReadJobTaskId(hpc::utils::JsonReader& reader, int& jobId, int& taskId);
 
              protected:
             private:
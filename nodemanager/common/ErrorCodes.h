@@ -21,6 +21,8 @@ namespace hpc
             ReadFileError = 180,
             UnknownFilter = 181,
             CannotFindHomeDir = 182,
+            ApplyResourceLimitsError = 183,
+            TaskAdoptionError = 184,
         };
     }
 }
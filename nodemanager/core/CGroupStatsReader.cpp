@@ -0,0 +1,338 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+
+#include "CGroupStatsReader.h"
+#include "../utils/Logger.h"
+#include "../utils/System.h"
+#include "../utils/String.h"
+
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+CGroupStatsReader::CGroupStatsReader(const CGroup& group)
+{
+    this->unified = group.IsUnified("cpuacct");
+
+    auto cpuPath = group.GetPath("cpuacct");
+    auto memoryPath = group.GetPath("memory");
+    auto cpusetPath = group.GetPath("cpuset");
+    auto blkioPath = group.GetPath("blkio");
+
+    if (this->unified)
+    {
+        this->cpuStat.Path = cpuPath + "/cpu.stat";
+
+        // memory.peak is only in kernel 5.19 and later.
+        struct stat st;
+        std::string peak = memoryPath + "/memory.peak";
+        this->memoryUsage.Path = stat(peak.c_str(), &st) == 0 ? peak : memoryPath + "/memory.current";
+        this->tasks.Path = cpusetPath + "/cgroup.threads";
+        this->memoryStat.Path = memoryPath + "/memory.stat";
+        this->cpuPressure.Path = cpuPath + "/cpu.pressure";
+        this->memoryPressure.Path = memoryPath + "/memory.pressure";
+        this->ioPressure.Path = cpuPath + "/io.pressure";
+        this->ioBytes.Path = cpuPath + "/io.stat";
+    }
+    else
+    {
+        this->cpuStat.Path = cpuPath + "/cpuacct.stat";
+        this->memoryUsage.Path = memoryPath + "/memory.max_usage_in_bytes";
+        this->tasks.Path = cpusetPath + "/tasks";
+        this->memoryStat.Path = memoryPath + "/memory.stat";
+
+        if (!blkioPath.empty())
+        {
+            this->ioBytes.Path = blkioPath + "/blkio.throttle.io_service_bytes";
+            this->ioOps.Path = blkioPath + "/blkio.throttle.io_serviced";
+        }
+    }
+
+    this->rssHistory.reserve(RssHistorySize);
+}
+
+CGroupStatsReader::~CGroupStatsReader()
+{
+    Close(this->cpuStat);
+    Close(this->memoryUsage);
+    Close(this->tasks);
+    Close(this->memoryStat);
+    Close(this->cpuPressure);
+    Close(this->memoryPressure);
+    Close(this->ioPressure);
+    Close(this->ioBytes);
+    Close(this->ioOps);
+}
+
+void CGroupStatsReader::Close(StatFile& file)
+{
+    if (file.Fd != -1)
+    {
+        close(file.Fd);
+        file.Fd = -1;
+    }
+}
+
+bool CGroupStatsReader::ReadFile(StatFile& file)
+{
+    this->buffer.clear();
+    if (file.Path.empty()) return false;
+
+    // a second try re-opens the file, in case the group was re-created.
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (file.Fd == -1)
+        {
+            file.Fd = open(file.Path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file.Fd == -1)
+            {
+                // not supported by the kernel, such as the pressure files without PSI.
+                if (errno == ENOENT) file.Path.clear();
+                return false;
+            }
+        }
+
+        char chunk[4096];
+        off_t offset = 0;
+        ssize_t bytes;
+        while ((bytes = pread(file.Fd, chunk, sizeof(chunk), offset)) > 0)
+        {
+            this->buffer.append(chunk, bytes);
+            offset += bytes;
+        }
+
+        if (bytes == 0) return true;
+
+        Logger::Debug("pread {0} failed, errno {1}", file.Path, errno);
+        Close(file);
+        this->buffer.clear();
+    }
+
+    return false;
+}
+
+void CGroupStatsReader::Read(ProcessStatistics& stat)
+{
+    stat.UserTimeMs = 0;
+    stat.KernelTimeMs = 0;
+    stat.WorkingSetKb = 0;
+    stat.ProcessIds.clear();
+
+    if (this->ReadFile(this->cpuStat))
+    {
+        if (this->unified)
+        {
+            stat.UserTimeMs = CGroup::ReadKey(this->buffer, "user_usec") / 1000;
+            stat.KernelTimeMs = CGroup::ReadKey(this->buffer, "system_usec") / 1000;
+        }
+        else
+        {
+            static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+            stat.UserTimeMs = CGroup::ReadKey(this->buffer, "user") * 1000 / ticksPerSecond;
+            stat.KernelTimeMs = CGroup::ReadKey(this->buffer, "system") * 1000 / ticksPerSecond;
+        }
+    }
+
+    if (this->ReadFile(this->memoryUsage))
+    {
+        stat.WorkingSetKb = strtoull(this->buffer.c_str(), nullptr, 10) / 1024;
+    }
+
+    stat.RssKb = 0;
+    stat.PageCacheKb = 0;
+    stat.MajorFaults = 0;
+    if (this->ReadFile(this->memoryStat))
+    {
+        // the total_ values of v1 include the sub groups, as v2 always does.
+        stat.RssKb = CGroup::ReadKey(this->buffer, this->unified ? "anon" : "total_rss") / 1024;
+        stat.PageCacheKb = CGroup::ReadKey(this->buffer, this->unified ? "file" : "total_cache") / 1024;
+        stat.MajorFaults = CGroup::ReadKey(this->buffer, this->unified ? "pgmajfault" : "total_pgmajfault");
+
+        this->AddRssSample(stat.RssKb);
+    }
+
+    stat.RssP50Kb = this->GetRssPercentile(50);
+    stat.RssP95Kb = this->GetRssPercentile(95);
+
+    stat.CpuStallMs = this->ReadStallMs(this->cpuPressure);
+    stat.MemoryStallMs = this->ReadStallMs(this->memoryPressure);
+    stat.IoStallMs = this->ReadStallMs(this->ioPressure);
+
+    if (this->ReadFile(this->tasks))
+    {
+        const char* p = this->buffer.c_str();
+        char* end;
+        for (long id = strtol(p, &end, 10); end != p; id = strtol(p, &end, 10))
+        {
+            stat.ProcessIds.push_back(id);
+            p = end;
+        }
+    }
+
+    this->ReadIo(stat);
+    this->ReadNetwork(stat);
+}
+
+uint64_t CGroupStatsReader::ReadStallMs(StatFile& file)
+{
+    float avg10;
+    uint64_t totalUs = 0;
+    if (this->ReadFile(file) && System::ParsePressure(this->buffer, "some", avg10, totalUs))
+    {
+        return totalUs / 1000;
+    }
+
+    return 0;
+}
+
+void CGroupStatsReader::AddRssSample(uint64_t rssKb)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!this->rssHistory.empty() && now - this->lastRssSample < std::chrono::milliseconds(RssSampleIntervalMs))
+    {
+        return;
+    }
+
+    this->lastRssSample = now;
+
+    if (++this->rssSkipped < this->rssStride)
+    {
+        return;
+    }
+
+    this->rssSkipped = 0;
+
+    if (this->rssHistory.size() == RssHistorySize)
+    {
+        for (size_t i = 0; i < RssHistorySize / 2; i++)
+        {
+            this->rssHistory[i] = this->rssHistory[i * 2 + 1];
+        }
+
+        this->rssHistory.resize(RssHistorySize / 2);
+        this->rssStride *= 2;
+    }
+
+    this->rssHistory.push_back(rssKb);
+}
+
+uint64_t CGroupStatsReader::GetRssPercentile(int percent) const
+{
+    if (this->rssHistory.empty()) return 0;
+
+    std::vector<uint64_t> samples(this->rssHistory);
+    auto nth = samples.begin() + (samples.size() - 1) * percent / 100;
+    std::nth_element(samples.begin(), nth, samples.end());
+
+    return *nth;
+}
+
+void CGroupStatsReader::ReadIo(ProcessStatistics& stat)
+{
+    stat.IoReadBytes = stat.IoWriteBytes = stat.IoReadOps = stat.IoWriteOps = 0;
+
+    if (this->unified)
+    {
+        // 8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0, one line per device.
+        if (this->ReadFile(this->ioBytes))
+        {
+            std::istringstream iss(this->buffer);
+            std::string item;
+            while (iss >> item)
+            {
+                auto pos = item.find('=');
+                if (pos == std::string::npos) continue;
+
+                uint64_t value = strtoull(item.c_str() + pos + 1, nullptr, 10);
+                auto key = item.substr(0, pos);
+                if (key == "rbytes") stat.IoReadBytes += value;
+                else if (key == "wbytes") stat.IoWriteBytes += value;
+                else if (key == "rios") stat.IoReadOps += value;
+                else if (key == "wios") stat.IoWriteOps += value;
+            }
+        }
+    }
+    else
+    {
+        // 8:0 Read 4096, one line per device and operation, then Total.
+        auto sum = [](const std::string& content, uint64_t& read, uint64_t& write)
+        {
+            std::istringstream iss(content);
+            std::string device, op;
+            uint64_t value;
+            while (iss >> device >> op >> value)
+            {
+                if (op == "Read") read += value;
+                else if (op == "Write") write += value;
+            }
+        };
+
+        if (this->ReadFile(this->ioBytes)) sum(this->buffer, stat.IoReadBytes, stat.IoWriteBytes);
+        if (this->ReadFile(this->ioOps)) sum(this->buffer, stat.IoReadOps, stat.IoWriteOps);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->lastIoSample).count();
+    if (elapsedMs >= 1000)
+    {
+        if (this->lastIoSample != std::chrono::steady_clock::time_point())
+        {
+            this->readIops = (stat.IoReadOps - std::min(stat.IoReadOps, this->lastReadOps)) * 1000 / elapsedMs;
+            this->writeIops = (stat.IoWriteOps - std::min(stat.IoWriteOps, this->lastWriteOps)) * 1000 / elapsedMs;
+        }
+
+        this->lastReadOps = stat.IoReadOps;
+        this->lastWriteOps = stat.IoWriteOps;
+        this->lastIoSample = now;
+    }
+
+    stat.IoReadIops = this->readIops;
+    stat.IoWriteIops = this->writeIops;
+}
+
+void CGroupStatsReader::ReadNetwork(ProcessStatistics& stat)
+{
+    stat.NetworkReceivedBytes = stat.NetworkSentBytes = 0;
+    if (stat.ProcessIds.empty()) return;
+
+    // processes in the host namespace share the host counters, which can't be attributed.
+    static const std::string hostNamespace = ReadNetNamespace("self");
+    std::string pid = std::to_string(stat.ProcessIds[0]);
+    std::string taskNamespace = ReadNetNamespace(pid);
+    if (taskNamespace.empty() || taskNamespace == hostNamespace) return;
+
+    std::ifstream fs("/proc/" + pid + "/net/dev", std::ios::in);
+    std::string line;
+
+    // Inter-|   Receive ...
+    //  face |bytes    packets errs drop fifo frame compressed multicast|bytes ...
+    //   eth0: 1234 ...
+    while (std::getline(fs, line))
+    {
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+
+        auto name = String::Trim(line.substr(0, colon));
+        if (name == "lo") continue;
+
+        std::istringstream iss(line.substr(colon + 1));
+        uint64_t values[9] = { 0 };
+        for (auto& v : values) { iss >> v; }
+
+        stat.NetworkReceivedBytes += values[0];
+        stat.NetworkSentBytes += values[8];
+    }
+}
+
+std::string CGroupStatsReader::ReadNetNamespace(const std::string& pid)
+{
+    char link[64];
+    std::string path = "/proc/" + pid + "/ns/net";
+    ssize_t len = readlink(path.c_str(), link, sizeof(link) - 1);
+    return len > 0 ? std::string(link, len) : std::string();
+}
@@ -0,0 +1,79 @@
+#ifndef CGROUPSTATSREADER_H
+#define CGROUPSTATSREADER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../utils/CGroup.h"
+#include "../data/ProcessStatistics.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Reads the cpu, memory and task statistics of a task cgroup without forking.
+        /// The files are resolved and opened once and then read with pread.
+        class CGroupStatsReader
+        {
+            public:
+                CGroupStatsReader(const hpc::utils::CGroup& group);
+                ~CGroupStatsReader();
+
+                CGroupStatsReader(const CGroupStatsReader&) = delete;
+                CGroupStatsReader& operator=(const CGroupStatsReader&) = delete;
+
+                /// Fills the statistics, the values of unreadable files are 0, as in the former Statistics.sh.
+                void Read(hpc::data::ProcessStatistics& stat);
+
+            protected:
+            private:
+                struct StatFile
+                {
+                    std::string Path;
+                    int Fd = -1;
+                };
+
+                bool ReadFile(StatFile& file);
+                static void Close(StatFile& file);
+
+                uint64_t ReadStallMs(StatFile& file);
+                void ReadIo(hpc::data::ProcessStatistics& stat);
+                void ReadNetwork(hpc::data::ProcessStatistics& stat);
+                static std::string ReadNetNamespace(const std::string& pid);
+                void AddRssSample(uint64_t rssKb);
+                uint64_t GetRssPercentile(int percent) const;
+
+                StatFile cpuStat;
+                StatFile memoryUsage;
+                StatFile memoryStat;
+                StatFile tasks;
+                StatFile cpuPressure;
+                StatFile memoryPressure;
+                StatFile ioPressure;
+                // io.stat on v2, blkio.throttle.io_service_bytes and io_serviced on v1.
+                StatFile ioBytes;
+                StatFile ioOps;
+                bool unified = false;
+
+                // when full, every other sample is dropped and the stride doubles,
+                // so the history covers the whole task lifetime with fixed memory.
+                static const size_t RssHistorySize = 64;
+                static const int RssSampleIntervalMs = 1000;
+                std::vector<uint64_t> rssHistory;
+                int rssStride = 1;
+                int rssSkipped = 0;
+                std::chrono::steady_clock::time_point lastRssSample;
+
+                uint64_t lastReadOps = 0;
+                uint64_t lastWriteOps = 0;
+                uint64_t readIops = 0;
+                uint64_t writeIops = 0;
+                std::chrono::steady_clock::time_point lastIoSample;
+
+                std::string buffer;
+        };
+    }
+}
+
+#endif // CGROUPSTATSREADER_H
@@ -0,0 +1,239 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <openssl/x509_vfy.h>
+
+#include "ClientSslContext.h"
+#include "NodeManagerConfig.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+
+using namespace web;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+namespace
+{
+    // marks the connections whose handshake is counted already, the post handshake
+    // messages of TLS 1.3 report the handshake done again.
+    int HandshakeCountedIndex()
+    {
+        static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+}
+
+ClientSslContext& ClientSslContext::GetInstance()
+{
+    static ClientSslContext instance;
+    return instance;
+}
+
+ClientSslContext::~ClientSslContext()
+{
+    for (auto& s : this->sessions)
+    {
+        SSL_SESSION_free(s.second);
+    }
+
+    if (this->context)
+    {
+        SSL_CTX_free(this->context);
+    }
+}
+
+void ClientSslContext::Configure(boost::asio::ssl::context& ctx)
+{
+    SSL_CTX* shared;
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        std::string file = NodeManagerConfig::GetTrustedCAFile();
+        std::string path = NodeManagerConfig::GetTrustedCAPath();
+        FileStamp fileStamp = GetFileStamp(file);
+        FileStamp pathStamp = GetFileStamp(path);
+
+        if (!this->context || file != this->caFile || path != this->caPath ||
+            !(fileStamp == this->caFileStamp) || !(pathStamp == this->caPathStamp))
+        {
+            this->caFile = file;
+            this->caPath = path;
+            this->caFileStamp = fileStamp;
+            this->caPathStamp = pathStamp;
+
+            // the connections using the old context keep it alive by their references.
+            if (this->context) { SSL_CTX_free(this->context); }
+            this->context = this->CreateContext();
+        }
+
+        shared = this->context;
+        SSL_CTX_up_ref(shared);
+    }
+
+    // the context takes over the reference, the one cpprest created for the connection is freed.
+    ctx = boost::asio::ssl::context(shared);
+}
+
+SSL_CTX* ClientSslContext::CreateContext()
+{
+    Logger::Info("Create the client ssl context, trusted CA file {0}, path {1}", this->caFile, this->caPath);
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_options(ctx, SSL_OP_ALL);
+
+    if (NodeManagerConfig::GetUseDefaultCA())
+    {
+        SSL_CTX_set_default_verify_paths(ctx);
+    }
+
+    if (!this->caFile.empty() || !this->caPath.empty())
+    {
+        if (1 != SSL_CTX_load_verify_locations(
+            ctx,
+            this->caFile.empty() ? nullptr : this->caFile.c_str(),
+            this->caPath.empty() ? nullptr : this->caPath.c_str()))
+        {
+            Logger::Error("Failed to load the trusted CA file {0}, path {1}", this->caFile, this->caPath);
+        }
+    }
+
+    // the sessions are kept by the endpoint here, not in the cache of the context.
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, NewSessionCallback);
+    SSL_CTX_set_info_callback(ctx, InfoCallback);
+
+    this->contextsCreated++;
+
+    return ctx;
+}
+
+ClientSslContext::FileStamp ClientSslContext::GetFileStamp(const std::string& path)
+{
+    FileStamp stamp;
+    struct stat st;
+
+    if (!path.empty() && stat(path.c_str(), &st) == 0)
+    {
+        stamp.Exists = true;
+        stamp.Device = st.st_dev;
+        stamp.Inode = st.st_ino;
+        stamp.Size = st.st_size;
+        stamp.ModifiedTime = st.st_mtime;
+    }
+
+    return stamp;
+}
+
+std::string ClientSslContext::GetSessionKey(const SSL* ssl)
+{
+    // cpprest sends the host of the uri as the server name.
+    const char* host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host == nullptr)
+    {
+        return std::string();
+    }
+
+    sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    int port = 0;
+
+    if (getpeername(SSL_get_fd(ssl), (sockaddr*)&address, &length) == 0)
+    {
+        if (address.ss_family == AF_INET) { port = ntohs(((sockaddr_in*)&address)->sin_port); }
+        else if (address.ss_family == AF_INET6) { port = ntohs(((sockaddr_in6*)&address)->sin6_port); }
+    }
+
+    return String::Join(":", host, port);
+}
+
+int ClientSslContext::NewSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+    GetInstance().SaveSession(ssl, session);
+
+    // the reference is taken over.
+    return 1;
+}
+
+void ClientSslContext::InfoCallback(const SSL* ssl, int where, int ret)
+{
+    SSL* s = const_cast<SSL*>(ssl);
+
+    if ((where & SSL_CB_HANDSHAKE_START) && SSL_in_before(ssl))
+    {
+        GetInstance().ResumeSession(s);
+    }
+    else if ((where & SSL_CB_HANDSHAKE_DONE) && SSL_get_ex_data(ssl, HandshakeCountedIndex()) == nullptr)
+    {
+        SSL_set_ex_data(s, HandshakeCountedIndex(), s);
+
+        auto& instance = GetInstance();
+        std::lock_guard<std::mutex> guard(instance.lock);
+
+        if (SSL_session_reused(s)) { instance.resumedHandshakes++; }
+        else { instance.fullHandshakes++; }
+    }
+}
+
+void ClientSslContext::ResumeSession(SSL* ssl)
+{
+    std::string key = GetSessionKey(ssl);
+    if (key.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto it = this->sessions.find(key);
+    if (it == this->sessions.end())
+    {
+        return;
+    }
+
+    if (!SSL_SESSION_is_resumable(it->second))
+    {
+        SSL_SESSION_free(it->second);
+        this->sessions.erase(it);
+        return;
+    }
+
+    // the connection takes its own reference.
+    if (SSL_set_session(ssl, it->second) == 1)
+    {
+        this->sessionsOffered++;
+    }
+}
+
+void ClientSslContext::SaveSession(const SSL* ssl, SSL_SESSION* session)
+{
+    std::string key = GetSessionKey(ssl);
+    if (key.empty())
+    {
+        SSL_SESSION_free(session);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto& saved = this->sessions[key];
+    if (saved)
+    {
+        SSL_SESSION_free(saved);
+    }
+
+    saved = session;
+}
+
+json::value ClientSslContext::ToJson() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    json::value j;
+    j["ContextsCreated"] = this->contextsCreated;
+    j["FullHandshakes"] = this->fullHandshakes;
+    j["ResumedHandshakes"] = this->resumedHandshakes;
+    j["SessionsOffered"] = this->sessionsOffered;
+    j["SessionsCached"] = (uint64_t)this->sessions.size();
+    return j;
+}
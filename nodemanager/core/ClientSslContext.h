@@ -0,0 +1,85 @@
+#ifndef CLIENTSSLCONTEXT_H
+#define CLIENTSSLCONTEXT_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <openssl/ssl.h>
+#include <cpprest/json.h>
+#include <boost/asio/ssl.hpp>
+
+namespace hpc
+{
+    namespace core
+    {
+        /// One ssl context shared by all the outbound connections, with the trusted CAs loaded
+        /// into it once and again only when the files change.
+        /// The last session of every endpoint is kept, a reconnect offers it to resume the session
+        /// instead of a full handshake.
+        class ClientSslContext
+        {
+            public:
+                static ClientSslContext& GetInstance();
+
+                ~ClientSslContext();
+
+                ClientSslContext(const ClientSslContext&) = delete;
+                ClientSslContext& operator=(const ClientSslContext&) = delete;
+
+                /// The ssl context callback of the clients, it replaces the context of the connection by the shared one.
+                void Configure(boost::asio::ssl::context& ctx);
+
+                /// The handshake and session counters for the debug endpoint.
+                web::json::value ToJson() const;
+
+            protected:
+            private:
+                ClientSslContext() { }
+
+                struct FileStamp
+                {
+                    bool Exists = false;
+                    dev_t Device = 0;
+                    ino_t Inode = 0;
+                    off_t Size = 0;
+                    time_t ModifiedTime = 0;
+
+                    bool operator==(const FileStamp& other) const
+                    {
+                        return this->Exists == other.Exists && this->Device == other.Device && this->Inode == other.Inode &&
+                            this->Size == other.Size && this->ModifiedTime == other.ModifiedTime;
+                    }
+                };
+
+                static FileStamp GetFileStamp(const std::string& path);
+                static std::string GetSessionKey(const SSL* ssl);
+
+                static int NewSessionCallback(SSL* ssl, SSL_SESSION* session);
+                static void InfoCallback(const SSL* ssl, int where, int ret);
+
+                /// Must be called with the lock held.
+                SSL_CTX* CreateContext();
+                void ResumeSession(SSL* ssl);
+                void SaveSession(const SSL* ssl, SSL_SESSION* session);
+
+                mutable std::mutex lock;
+
+                SSL_CTX* context = nullptr;
+                std::string caFile;
+                std::string caPath;
+                FileStamp caFileStamp;
+                FileStamp caPathStamp;
+
+                // keyed by host and port, each holds a reference of its session.
+                std::map<std::string, SSL_SESSION*> sessions;
+
+                uint64_t contextsCreated = 0;
+                uint64_t fullHandshakes = 0;
+                uint64_t resumedHandshakes = 0;
+                uint64_t sessionsOffered = 0;
+        };
+    }
+}
+
+#endif // CLIENTSSLCONTEXT_H
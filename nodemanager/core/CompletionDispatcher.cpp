@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "CompletionDispatcher.h"
+#include "HttpHelper.h"
+#include "TaskTracer.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+
+using namespace web::http;
+using namespace web::http::client;
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::data;
+
+CompletionDispatcher::CompletionDispatcher(
+    std::function<std::string(const std::string&)> uriResolver,
+    std::function<void()> failed,
+    int coalesceMs,
+    bool batching,
+    std::unique_ptr<Journal> outbox) :
+    resolveUri(uriResolver), onFailed(failed), coalesceWindow(std::max(coalesceMs, 0)), batching(batching),
+    outbox(std::move(outbox))
+{
+    if (this->outbox)
+    {
+        for (auto& record : this->outbox->GetPending())
+        {
+            Completion c { 0, 0, 0, std::string(), std::string(), 0, Clock::now() };
+            size_t separator = record.second.find('\n');
+
+            if (sscanf(record.first.c_str(), "%d.%d.%d", &c.JobId, &c.TaskId, &c.RequeueCount) != 3 || separator == std::string::npos)
+            {
+                Logger::Warn("Skipped the invalid task completion {0} in the outbox", record.first);
+                continue;
+            }
+
+            c.CallbackUri = record.second.substr(0, separator);
+            c.Body = record.second.substr(separator + 1);
+            this->completions.push_back(std::move(c));
+        }
+
+        Logger::Info("Replaying {0} task completions from the outbox", this->completions.size());
+    }
+
+    int result = pthread_create(&this->threadId, nullptr, DispatchThread, this);
+    if (result != 0)
+    {
+        Logger::Error("Create completion dispatch thread result {0}, errno {1}", result, errno);
+        this->threadId = 0;
+    }
+}
+
+CompletionDispatcher::~CompletionDispatcher()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->isRunning = false;
+    }
+
+    this->queued.notify_all();
+
+    if (this->threadId != 0)
+    {
+        pthread_join(this->threadId, nullptr);
+    }
+
+    if (!this->completions.empty())
+    {
+        Logger::Warn("{0} task completions were not reported before closing", this->completions.size());
+    }
+}
+
+void CompletionDispatcher::Report(int jobId, int taskId, int requeueCount, std::string&& jsonBody, const std::string& callbackUri)
+{
+    Completion completion { jobId, taskId, requeueCount, std::move(jsonBody), callbackUri, 0, Clock::now() };
+
+    // the uri has no new line, the body is the rest of the payload.
+    if (this->outbox && !this->outbox->Append(GetKey(completion), completion.CallbackUri + '\n' + completion.Body))
+    {
+        Logger::Warn(jobId, taskId, requeueCount, "The task completion is not journaled to the outbox");
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->completions.push_back(std::move(completion));
+    }
+
+    this->queued.notify_one();
+}
+
+void* CompletionDispatcher::DispatchThread(void* arg)
+{
+    CompletionDispatcher* const d = static_cast<CompletionDispatcher* const>(arg);
+
+    std::unique_lock<std::mutex> guard(d->lock);
+
+    while (d->isRunning)
+    {
+        if (d->completions.empty())
+        {
+            d->queued.wait(guard);
+            continue;
+        }
+
+        auto earliest = std::min_element(
+            d->completions.cbegin(), d->completions.cend(),
+            [](const auto& a, const auto& b) { return a.NotBefore < b.NotBefore; })->NotBefore;
+
+        // the window starts with the first completion which is due, the later ones join it.
+        auto deadline = earliest + d->coalesceWindow;
+        size_t count = d->completions.size();
+        d->queued.wait_until(guard, deadline, [d, count]() { return !d->isRunning || d->completions.size() != count; });
+
+        if (!d->isRunning) { break; }
+
+        // a new completion may be due before the earliest retry.
+        if (Clock::now() < deadline) { continue; }
+
+        auto now = Clock::now();
+        std::vector<Completion> due;
+        for (auto it = d->completions.begin(); it != d->completions.end(); )
+        {
+            if (it->NotBefore <= now)
+            {
+                due.push_back(std::move(*it));
+                it = d->completions.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+
+        if (due.empty()) { continue; }
+
+        guard.unlock();
+
+        try
+        {
+            d->Dispatch(std::move(due));
+        }
+        catch (const std::exception& ex)
+        {
+            Logger::Error("Exception happened when dispatching task completions, ex = {0}", ex.what());
+        }
+
+        guard.lock();
+    }
+
+    return nullptr;
+}
+
+void CompletionDispatcher::Dispatch(std::vector<Completion>&& due)
+{
+    std::map<std::string, std::vector<Completion>> byCallback;
+    for (auto& c : due)
+    {
+        byCallback[c.CallbackUri].push_back(std::move(c));
+    }
+
+    for (auto& group : byCallback)
+    {
+        auto& completions = group.second;
+        std::string uri;
+
+        try
+        {
+            uri = this->resolveUri(group.first);
+        }
+        catch (const std::exception& ex)
+        {
+            for (auto& c : completions) { this->Retry(std::move(c), ex.what()); }
+            continue;
+        }
+
+        Logger::Debug("Reporting {0} task completions to {1}", completions.size(), uri);
+
+        if (this->batching && completions.size() > 1)
+        {
+            if (this->SendBatch(uri, completions))
+            {
+                for (const auto& c : completions) { this->Acknowledged(c); }
+                continue;
+            }
+
+            // retried one by one.
+            this->DropClient(uri);
+            for (auto& c : completions) { this->Retry(std::move(c), "the batch failed"); }
+            continue;
+        }
+
+        auto results = this->SendEach(uri, completions);
+
+        bool anyFailed = false;
+        for (size_t i = 0; i < completions.size(); i++)
+        {
+            if (results[i])
+            {
+                this->Acknowledged(completions[i]);
+            }
+            else
+            {
+                anyFailed = true;
+                this->Retry(std::move(completions[i]), "the request failed");
+            }
+        }
+
+        if (anyFailed) { this->DropClient(uri); }
+    }
+}
+
+bool CompletionDispatcher::SendBatch(const std::string& uri, const std::vector<Completion>& completions)
+{
+    size_t size = 2;
+    for (const auto& c : completions) { size += c.Body.size() + 1; }
+
+    std::string body;
+    body.reserve(size);
+    body.push_back('[');
+    for (const auto& c : completions)
+    {
+        if (body.size() > 1) { body.push_back(','); }
+        body.append(c.Body);
+    }
+
+    body.push_back(']');
+
+    try
+    {
+        auto request = HttpHelper::GetJsonHttpRequest(methods::POST, body);
+        auto response = this->GetClient(uri)->request(*request).get();
+        Logger::Info("Callback to {0} with {1} task completions, response code {2}", uri, completions.size(), response.status_code());
+
+        return response.status_code() == status_codes::OK;
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::Error("Exception when sending back {0} task results to {1}. {2}", completions.size(), uri, ex.what());
+        return false;
+    }
+}
+
+std::vector<bool> CompletionDispatcher::SendEach(const std::string& uri, const std::vector<Completion>& completions)
+{
+    auto client = this->GetClient(uri);
+
+    // all of them are in flight before the first response is waited.
+    std::vector<pplx::task<http_response>> responses;
+    for (const auto& c : completions)
+    {
+        Logger::Debug(c.JobId, c.TaskId, c.RequeueCount, "Callback to {0} with {1}", uri, c.Body);
+
+        try
+        {
+            responses.push_back(client->request(*HttpHelper::GetJsonHttpRequest(methods::POST, c.Body)));
+        }
+        catch (const std::exception& ex)
+        {
+            // an empty task throws when waited, which fails this completion only.
+            Logger::Error(c.JobId, c.TaskId, c.RequeueCount, "Exception when sending back task result. {0}", ex.what());
+            responses.push_back(pplx::task<http_response>());
+        }
+    }
+
+    std::vector<bool> results;
+    for (size_t i = 0; i < completions.size(); i++)
+    {
+        const auto& c = completions[i];
+
+        try
+        {
+            auto response = responses[i].get();
+            Logger::Info(c.JobId, c.TaskId, c.RequeueCount,
+                "Callback to {0} response code {1}", uri, response.status_code());
+
+            results.push_back(response.status_code() == status_codes::OK);
+        }
+        catch (const std::exception& ex)
+        {
+            Logger::Error(c.JobId, c.TaskId, c.RequeueCount,
+                "Exception when sending back task result. {0}", ex.what());
+
+            results.push_back(false);
+        }
+    }
+
+    return results;
+}
+
+void CompletionDispatcher::Acknowledged(const Completion& completion)
+{
+    TaskTracer::Mark(completion.JobId, completion.TaskId, completion.RequeueCount, TracePhase::CompletionAcknowledged);
+    TaskTracer::Complete(completion.JobId, completion.TaskId, completion.RequeueCount);
+
+    if (this->outbox)
+    {
+        this->outbox->Acknowledge(GetKey(completion));
+    }
+
+    // the scheduler is reachable again.
+    this->Replay();
+}
+
+void CompletionDispatcher::Replay()
+{
+    if (this->parked.empty()) { return; }
+
+    Logger::Info("Replaying {0} task completions from the outbox", this->parked.size());
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (auto& c : this->parked)
+    {
+        c.Attempts = 0;
+        c.NotBefore = Clock::now();
+        this->completions.push_back(std::move(c));
+    }
+
+    this->parked.clear();
+}
+
+std::string CompletionDispatcher::GetKey(const Completion& completion)
+{
+    return String::Join(".", completion.JobId, completion.TaskId, completion.RequeueCount);
+}
+
+void CompletionDispatcher::Retry(Completion&& completion, const std::string& reason)
+{
+    completion.Attempts++;
+
+    if (completion.Attempts > this->MaxRetries)
+    {
+        Logger::Error(completion.JobId, completion.TaskId, completion.RequeueCount,
+            "Failed to report the task completion after {0} attempts, {1}", completion.Attempts, reason);
+
+        TaskTracer::Complete(completion.JobId, completion.TaskId, completion.RequeueCount);
+        this->onFailed();
+
+        if (this->outbox)
+        {
+            // still journaled, kept until the scheduler acknowledges another completion.
+            this->parked.push_back(std::move(completion));
+        }
+
+        return;
+    }
+
+    auto backoff = std::chrono::milliseconds(this->InitialBackoffMs << (completion.Attempts - 1));
+    Logger::Warn(completion.JobId, completion.TaskId, completion.RequeueCount,
+        "Retry reporting the task completion in {0}ms, {1}", backoff.count(), reason);
+
+    completion.NotBefore = Clock::now() + backoff;
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->completions.push_back(std::move(completion));
+}
+
+std::shared_ptr<HttpClientPool::Client> CompletionDispatcher::GetClient(const std::string& uri)
+{
+    return HttpHelper::GetHttpClient(uri, HttpClientPool::Priority::Control);
+}
+
+void CompletionDispatcher::DropClient(const std::string& uri)
+{
+    // the next attempt connects again.
+    HttpClientPool::GetInstance().Reset(uri);
+}
@@ -0,0 +1,97 @@
+#ifndef COMPLETIONDISPATCHER_H
+#define COMPLETIONDISPATCHER_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <pthread.h>
+#include <cpprest/http_client.h>
+
+#include "HttpClientPool.h"
+#include "../utils/Journal.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Sends the task completion events on its own thread over the pooled clients,
+        /// so the connection to the scheduler is kept between the completions.
+        /// The completions arriving within the coalesce window are sent together, as one array
+        /// when the server accepts batches, otherwise as concurrent requests on the same client.
+        /// A failed completion is retried alone with backoff, the failed callback is only
+        /// called when its retries are exhausted.
+        /// With an outbox, the completions are journaled until acknowledged. The ones which exhausted
+        /// their retries are sent again after the next acknowledged one, and all of them after a restart.
+        class CompletionDispatcher
+        {
+            public:
+                CompletionDispatcher(
+                    std::function<std::string(const std::string&)> uriResolver,
+                    std::function<void()> failed,
+                    int coalesceMs,
+                    bool batching,
+                    std::unique_ptr<hpc::utils::Journal> outbox = nullptr);
+
+                ~CompletionDispatcher();
+
+                CompletionDispatcher(const CompletionDispatcher&) = delete;
+                CompletionDispatcher& operator=(const CompletionDispatcher&) = delete;
+
+                void Report(int jobId, int taskId, int requeueCount, std::string&& jsonBody, const std::string& callbackUri);
+
+                const int MaxRetries = 4;
+                const int InitialBackoffMs = 500;
+
+            protected:
+            private:
+                typedef std::chrono::steady_clock Clock;
+
+                struct Completion
+                {
+                    int JobId;
+                    int TaskId;
+                    int RequeueCount;
+                    std::string Body;
+                    std::string CallbackUri;
+                    int Attempts;
+                    Clock::time_point NotBefore;
+                };
+
+                static void* DispatchThread(void* arg);
+                void Dispatch(std::vector<Completion>&& completions);
+                bool SendBatch(const std::string& uri, const std::vector<Completion>& completions);
+                std::vector<bool> SendEach(const std::string& uri, const std::vector<Completion>& completions);
+                void Acknowledged(const Completion& completion);
+                void Retry(Completion&& completion, const std::string& reason);
+                void Replay();
+
+                static std::string GetKey(const Completion& completion);
+
+                std::shared_ptr<HttpClientPool::Client> GetClient(const std::string& uri);
+                void DropClient(const std::string& uri);
+
+                std::function<std::string(const std::string&)> resolveUri;
+                std::function<void()> onFailed;
+                std::chrono::milliseconds coalesceWindow;
+                bool batching;
+
+                std::unique_ptr<hpc::utils::Journal> outbox;
+
+                // accessed by the dispatch thread only.
+                std::vector<Completion> parked;
+
+                std::mutex lock;
+                std::condition_variable queued;
+                std::deque<Completion> completions;
+                bool isRunning = true;
+
+                pthread_t threadId = 0;
+        };
+    }
+}
+
+#endif // COMPLETIONDISPATCHER_H
@@ -0,0 +1,320 @@
+#include "HttpClientPool.h"
+#include "ClientSslContext.h"
+#include "NodeManagerConfig.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+
+using namespace web;
+using namespace web::http;
+using namespace web::http::client;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+const int HttpClientPool::DefaultMaxConnectionsPerEndpoint;
+const int HttpClientPool::ReservedControlConnections;
+
+namespace
+{
+    // the same request with the full uri, the http_request copies share their content.
+    http_request CopyWithUri(const http_request& request, const uri& fullUri)
+    {
+        http_request copy(request.method());
+        copy.headers() = request.headers();
+        copy.set_request_uri(fullUri);
+
+        if (request.body().is_valid())
+        {
+            copy.set_body(request.body(), request.headers().content_length(), request.headers().content_type());
+        }
+
+        return copy;
+    }
+}
+
+HttpClientPool& HttpClientPool::GetInstance()
+{
+    static HttpClientPool pool;
+    return pool;
+}
+
+HttpClientPool::HttpClientPool() :
+    maxConnectionsPerEndpoint(DefaultMaxConnectionsPerEndpoint),
+    waitTimeoutMs(GetRequestTimeoutSeconds() * 1000)
+{
+    try
+    {
+        this->maxConnectionsPerEndpoint = NodeManagerConfig::GetHttpMaxConnectionsPerEndpoint();
+    }
+    catch (...)
+    {
+        Logger::Info("HttpMaxConnectionsPerEndpoint not specified or invalid, use the default value {0}.", this->maxConnectionsPerEndpoint);
+    }
+}
+
+std::shared_ptr<HttpClientPool::Client> HttpClientPool::GetClient(const std::string& uri, Priority priority)
+{
+    web::uri u(uri);
+    return std::make_shared<Client>(this->GetEndpoint(u), u.resource().to_string(), priority);
+}
+
+void HttpClientPool::Reset(const std::string& uri)
+{
+    this->GetEndpoint(web::uri(uri))->Reset();
+}
+
+std::shared_ptr<HttpClientPool::Endpoint> HttpClientPool::GetEndpoint(const web::uri& uri)
+{
+    std::string key = GetEndpointKey(uri);
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto& endpoint = this->endpoints[key];
+    if (!endpoint)
+    {
+        Logger::Debug("Create the http endpoint {0}", key);
+        endpoint = std::make_shared<Endpoint>(key, this->maxConnectionsPerEndpoint, this->waitTimeoutMs);
+    }
+
+    return endpoint;
+}
+
+std::string HttpClientPool::GetEndpointKey(const web::uri& uri)
+{
+    return uri.port() > 0 ?
+        String::Join("", uri.scheme(), "://", uri.host(), ":", uri.port()) :
+        String::Join("", uri.scheme(), "://", uri.host());
+}
+
+json::value HttpClientPool::ToJson() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    std::vector<json::value> endpoints;
+    for (const auto& e : this->endpoints)
+    {
+        endpoints.push_back(e.second->ToJson());
+    }
+
+    return json::value::array(endpoints);
+}
+
+http_client_config HttpClientPool::GetClientConfig()
+{
+    http_client_config config;
+
+    config.set_validate_certificates(false);
+    config.set_ssl_context_callback([](boost::asio::ssl::context& ctx)
+    {
+        ClientSslContext::GetInstance().Configure(ctx);
+    });
+
+    utility::seconds timeout(GetRequestTimeoutSeconds());
+    config.set_timeout(timeout);
+
+    return config;
+}
+
+long HttpClientPool::GetRequestTimeoutSeconds()
+{
+    long httpRequestTimeoutSeconds = 10l;
+    try
+    {
+        httpRequestTimeoutSeconds = NodeManagerConfig::GetHttpRequestTimeoutSeconds();
+    }
+    catch (...)
+    {
+        Logger::Debug("HttpRequestTimeoutSeconds not specified or invalid, use the default value {0} seconds.", httpRequestTimeoutSeconds);
+    }
+
+    return httpRequestTimeoutSeconds;
+}
+
+pplx::task<http_response> HttpClientPool::Client::request(const http_request& request, const pplx::cancellation_token& token)
+{
+    // the request uri is relative to the uri the client is got for.
+    http_request sent = CopyWithUri(request, uri_builder(this->resource).append(request.request_uri()).to_uri());
+
+    auto endpoint = this->endpoint;
+    pplx::task_completion_event<http_response> responded;
+
+    endpoint->Acquire(this->priority, [endpoint, sent, token, responded]()
+    {
+        try
+        {
+            endpoint->GetClient()->request(sent, token).then([endpoint, responded](pplx::task<http_response> t)
+            {
+                try
+                {
+                    // the connection goes back to the client when the body is read.
+                    t.get().content_ready().then([endpoint, responded](pplx::task<http_response> content)
+                    {
+                        endpoint->Release();
+
+                        try
+                        {
+                            responded.set(content.get());
+                        }
+                        catch (...)
+                        {
+                            responded.set_exception(std::current_exception());
+                        }
+                    });
+                }
+                catch (...)
+                {
+                    endpoint->Release();
+                    responded.set_exception(std::current_exception());
+                }
+            });
+        }
+        catch (...)
+        {
+            endpoint->Release();
+            responded.set_exception(std::current_exception());
+        }
+    },
+    [responded]()
+    {
+        responded.set_exception(std::make_exception_ptr(
+            http_exception("No connection to the endpoint is free within the request timeout")));
+    });
+
+    return pplx::task<http_response>(responded);
+}
+
+HttpClientPool::Endpoint::Endpoint(const std::string& baseUri, int maxConnections, int waitTimeoutMs) :
+    baseUri(baseUri), maxConnections(maxConnections > 0 ? maxConnections : 1), waitTimeoutMs(waitTimeoutMs)
+{
+}
+
+int HttpClientPool::Endpoint::GetConnectionLimit(Priority priority) const
+{
+    return priority == Priority::Control ? this->maxConnections + ReservedControlConnections : this->maxConnections;
+}
+
+void HttpClientPool::Endpoint::Acquire(Priority priority, std::function<void()> send, std::function<void()> fail)
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        if (this->inFlight >= this->GetConnectionLimit(priority))
+        {
+            this->queued++;
+
+            uint64_t sequence = this->nextSequence++;
+            auto& waiter = this->waiting[(int)priority][sequence];
+            waiter.Send = std::move(send);
+            waiter.Fail = std::move(fail);
+
+            // the endpoints are kept by the pool as long as the process runs.
+            Endpoint* endpoint = this;
+            waiter.TimerId = hpc::utils::TimerWheel::GetInstance().Schedule(
+                this->waitTimeoutMs,
+                [endpoint, priority, sequence]() { endpoint->Expire(priority, sequence); });
+
+            return;
+        }
+
+        this->inFlight++;
+        this->maxInFlight = std::max(this->maxInFlight, this->inFlight);
+    }
+
+    send();
+}
+
+void HttpClientPool::Endpoint::Expire(Priority priority, uint64_t sequence)
+{
+    std::function<void()> fail;
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        auto& queue = this->waiting[(int)priority];
+        auto it = queue.find(sequence);
+        if (it == queue.end())
+        {
+            return;
+        }
+
+        fail = std::move(it->second.Fail);
+        queue.erase(it);
+        this->timedOut++;
+    }
+
+    Logger::Warn("The request to {0} waited {1}ms for a connection, failed", this->baseUri, this->waitTimeoutMs);
+    fail();
+}
+
+void HttpClientPool::Endpoint::Release()
+{
+    Waiter next;
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        // the control requests go first, the normal ones only within their cap.
+        auto& control = this->waiting[(int)Priority::Control];
+        auto& normal = this->waiting[(int)Priority::Normal];
+
+        std::map<uint64_t, Waiter>* queue =
+            !control.empty() ? &control :
+            !normal.empty() && this->inFlight <= this->maxConnections ? &normal : nullptr;
+
+        if (queue == nullptr)
+        {
+            this->inFlight--;
+            return;
+        }
+
+        // the slot is handed over to the first waiting request.
+        next = std::move(queue->begin()->second);
+        queue->erase(queue->begin());
+    }
+
+    hpc::utils::TimerWheel::GetInstance().Cancel(next.TimerId);
+    next.Send();
+}
+
+void HttpClientPool::Endpoint::Reset()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    // the requests in flight keep the old client until they finish.
+    this->client.reset();
+}
+
+std::shared_ptr<http_client> HttpClientPool::Endpoint::GetClient()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    this->requests++;
+
+    if (this->client)
+    {
+        this->reused++;
+    }
+    else
+    {
+        Logger::Debug("Create client to {0}, max connections {1}", this->baseUri, this->maxConnections);
+        this->client = std::make_shared<http_client>(this->baseUri, HttpClientPool::GetClientConfig());
+        this->created++;
+    }
+
+    return this->client;
+}
+
+json::value HttpClientPool::Endpoint::ToJson() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    json::value j;
+    j["Endpoint"] = json::value::string(this->baseUri);
+    j["Requests"] = this->requests;
+    j["Reused"] = this->reused;
+    j["ClientsCreated"] = this->created;
+    j["Queued"] = this->queued;
+    j["TimedOut"] = this->timedOut;
+    j["InFlight"] = this->inFlight;
+    j["MaxInFlight"] = this->maxInFlight;
+    return j;
+}
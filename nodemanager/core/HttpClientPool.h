@@ -0,0 +1,138 @@
+#ifndef HTTPCLIENTPOOL_H
+#define HTTPCLIENTPOOL_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <cpprest/http_client.h>
+
+#include "../utils/TimerWheel.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Keeps one cpprest client per scheme, host and port, so the keep-alive connections
+        /// of the client are shared by all the requests to the endpoint instead of
+        /// connecting and handshaking again for every request.
+        /// The requests beyond the connection cap of an endpoint wait for a finished one,
+        /// and fail when they wait longer than the request timeout.
+        /// The heartbeats and the task completions have connections reserved for them,
+        /// so they are not held up by the task output.
+        /// The connections share the ssl context and the sessions of ClientSslContext.
+        class HttpClientPool
+        {
+            public:
+                class Endpoint;
+
+                enum class Priority
+                {
+                    Normal,
+                    // heartbeats and task completions, served before the normal requests.
+                    Control,
+                };
+
+                /// Sends the requests to the uri it is got for, the same as a client created with the uri.
+                class Client
+                {
+                    public:
+                        Client(std::shared_ptr<Endpoint> endpoint, const std::string& resource, Priority priority) :
+                            endpoint(std::move(endpoint)), resource(resource), priority(priority) { }
+
+                        /// The request is sent as a copy with the full uri, it is not changed.
+                        pplx::task<web::http::http_response> request(
+                            const web::http::http_request& request,
+                            const pplx::cancellation_token& token = pplx::cancellation_token::none());
+
+                    protected:
+                    private:
+                        std::shared_ptr<Endpoint> endpoint;
+                        std::string resource;
+                        Priority priority;
+                };
+
+                class Endpoint
+                {
+                    public:
+                        Endpoint(const std::string& baseUri, int maxConnections, int waitTimeoutMs);
+
+                        /// Runs send now when a connection is free, otherwise after a request finishes,
+                        /// or runs fail when no connection is free within the wait timeout.
+                        void Acquire(Priority priority, std::function<void()> send, std::function<void()> fail);
+                        void Release();
+
+                        /// The connections are dropped, the next request connects again.
+                        void Reset();
+
+                        std::shared_ptr<web::http::client::http_client> GetClient();
+
+                        web::json::value ToJson() const;
+
+                    protected:
+                    private:
+                        struct Waiter
+                        {
+                            std::function<void()> Send;
+                            std::function<void()> Fail;
+                            hpc::utils::TimerWheel::TimerId TimerId = 0;
+                        };
+
+                        int GetConnectionLimit(Priority priority) const;
+                        void Expire(Priority priority, uint64_t sequence);
+
+                        std::string baseUri;
+                        int maxConnections;
+                        int waitTimeoutMs;
+
+                        mutable std::mutex lock;
+                        std::shared_ptr<web::http::client::http_client> client;
+
+                        // keyed by the arrival sequence, one queue per priority.
+                        std::map<uint64_t, Waiter> waiting[2];
+                        uint64_t nextSequence = 0;
+                        int inFlight = 0;
+
+                        uint64_t requests = 0;
+                        uint64_t reused = 0;
+                        uint64_t created = 0;
+                        uint64_t queued = 0;
+                        uint64_t timedOut = 0;
+                        int maxInFlight = 0;
+                };
+
+                static HttpClientPool& GetInstance();
+
+                HttpClientPool(const HttpClientPool&) = delete;
+                HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+                std::shared_ptr<Client> GetClient(const std::string& uri, Priority priority = Priority::Normal);
+                void Reset(const std::string& uri);
+
+                /// The counters of all the endpoints for the debug endpoint.
+                web::json::value ToJson() const;
+
+                static const int DefaultMaxConnectionsPerEndpoint = 8;
+                static const int ReservedControlConnections = 2;
+
+            protected:
+            private:
+                HttpClientPool();
+
+                static std::string GetEndpointKey(const web::uri& uri);
+                static web::http::client::http_client_config GetClientConfig();
+                static long GetRequestTimeoutSeconds();
+
+                std::shared_ptr<Endpoint> GetEndpoint(const web::uri& uri);
+
+                int maxConnectionsPerEndpoint;
+                int waitTimeoutMs;
+
+                mutable std::mutex lock;
+                std::map<std::string, std::shared_ptr<Endpoint>> endpoints;
+        };
+    }
+}
+
+#endif // HTTPCLIENTPOOL_H
@@ -5,6 +5,7 @@
 #include <boost/asio/ssl.hpp>
 
 #include "NodeManagerConfig.h"
+#include "HttpClientPool.h"
 
 namespace hpc
 {
@@ -35,6 +36,16 @@ namespace hpc
                     return msg;
                 }
 
+                // for the bodies serialized by JsonWriter.
+                static std::shared_ptr<http::http_request> GetJsonHttpRequest(
+                    const http::method& mtd,
+                    const std::string& body)
+                {
+                    auto msg = GetHttpRequest(mtd);
+                    msg->set_body(body, "application/json");
+                    return msg;
+                }
+
                 template <typename T>
                 static std::shared_ptr<http::http_request> GetHttpRequest(
                     const http::method& mtd,
@@ -67,48 +78,12 @@ namespace hpc
                     }
                 }
 
-                static std::shared_ptr<http::client::http_client> GetHttpClient(const std::string& uri)
+                // the clients share the connections of their endpoint, see HttpClientPool.
+                static std::shared_ptr<HttpClientPool::Client> GetHttpClient(
+                    const std::string& uri,
+                    HttpClientPool::Priority priority = HttpClientPool::Priority::Normal)
                 {
-                    http::client::http_client_config config;
-
-                    config.set_validate_certificates(false);
-                    config.set_ssl_context_callback([](context& ctx)
-                    {
-                        if (NodeManagerConfig::GetUseDefaultCA())
-                        {
-                            ctx.set_default_verify_paths();
-                        }
-
-                        auto verifyPath = NodeManagerConfig::GetTrustedCAPath();
-                        if (!verifyPath.empty())
-                        {
-                            ctx.add_verify_path(verifyPath);
-                        }
-
-                        auto verifyFile = NodeManagerConfig::GetTrustedCAFile();
-                        if (!verifyFile.empty())
-                        {
-                            ctx.load_verify_file(verifyFile);
-                        }
-                    });
-
-                    long httpRequestTimeoutSeconds = 10l;
-                    try
-                    {
-                        httpRequestTimeoutSeconds = NodeManagerConfig::GetHttpRequestTimeoutSeconds();
-                    }
-                    catch (...)
-                    {
-                        Logger::Debug("HttpRequestTimeoutSeconds not specified or invalid, use the default value {0} seconds.", httpRequestTimeoutSeconds);
-                    }
-
-                    utility::seconds timeout(httpRequestTimeoutSeconds);
-                    config.set_timeout(timeout);
-                    Logger::Debug(
-                        "Create client to {0}, configure: timeout {1} seconds, chuck size {2}",
-                        uri, config.timeout().count(), config.chunksize());
-
-                    return std::make_shared<http::client::http_client>(uri, config);
+                    return HttpClientPool::GetInstance().GetClient(uri, priority);
                 }
 
                 static bool FindCallbackUri(http::http_request& request, std::string& uri)
@@ -17,7 +17,7 @@ int HttpReporter::Report()
 
         if (this->cts.get_token().is_canceled()) return -1;
         auto jsonBody = this->valueFetcher();
-        if (jsonBody.is_null())
+        if (jsonBody.empty())
         {
             Logger::Error("Skipped reporting to {0} because json is null", uri);
             return -1;
@@ -25,16 +25,30 @@ int HttpReporter::Report()
 
         Logger::Debug("---------> Report to {0} with {1}", uri, jsonBody);
 
-        auto client = HttpHelper::GetHttpClient(uri);
+        // the heartbeats are not held up by the task output to the same head node.
+        auto client = HttpHelper::GetHttpClient(uri, HttpClientPool::Priority::Control);
 
-        auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
+        auto request = HttpHelper::GetJsonHttpRequest(methods::POST, jsonBody);
 
         http_response response = client->request(*request, this->cts.get_token()).get();
 
         auto str = response.extract_string().get();
-        std::istringstream iss(str);
+        json::value responseJson;
         int milliseconds = 30000;
-        iss >> milliseconds;
+
+        if (!str.empty() && str[0] == '{')
+        {
+            responseJson = json::value::parse(str);
+            if (responseJson.has_field("Interval") && responseJson.at("Interval").is_number())
+            {
+                milliseconds = responseJson.at("Interval").as_integer();
+            }
+        }
+        else
+        {
+            std::istringstream iss(str);
+            iss >> milliseconds;
+        }
 
         if (milliseconds > 0)
         {
@@ -45,6 +59,11 @@ int HttpReporter::Report()
 
         if (response.status_code() == http::status_codes::OK)
         {
+            if (this->onSuccess)
+            {
+                this->onSuccess(responseJson);
+            }
+
             return 0;
         }
         else
@@ -13,7 +13,8 @@ namespace hpc
     {
         using namespace web;
 
-        class HttpReporter : public Reporter<json::value>
+        // reports the json body returned by the fetcher, an empty body skips the report.
+        class HttpReporter : public Reporter<std::string>
         {
             public:
                 HttpReporter(
@@ -21,10 +22,11 @@ namespace hpc
                     std::function<std::string(pplx::cancellation_token)> getUri,
                     int hold,
                     int interval,
-                    std::function<json::value()> fetcher,
+                    std::function<std::string()> fetcher,
                     std::function<void(int)> onErrorFunc, 
-                    int retryFactor = 2)
-                : Reporter<json::value>(reporterName, getUri, hold, interval, fetcher, onErrorFunc, retryFactor)
+                    int retryFactor = 2,
+                    std::function<void(const json::value&)> onSuccessFunc = nullptr)
+                : Reporter<std::string>(reporterName, getUri, hold, interval, fetcher, onErrorFunc, retryFactor), onSuccess(onSuccessFunc)
                 {
                 }
 
@@ -38,6 +40,8 @@ namespace hpc
 
             protected:
             private:
+                // with the response json, or null when the response is the plain interval.
+                std::function<void(const json::value&)> onSuccess;
         };
     }
 }
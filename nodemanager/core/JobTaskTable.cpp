@@ -2,7 +2,7 @@
 #include "../utils/WriterLock.h"
 #include "../utils/ReaderLock.h"
 #include "../utils/System.h"
-#include <math.h>
+#include <algorithm>
 
 using namespace hpc::core;
 using namespace web;
@@ -11,70 +11,183 @@ using namespace hpc::utils;
 
 JobTaskTable* JobTaskTable::instance = nullptr;
 
-json::value JobTaskTable::ToJson()
+JobTaskTable::JobTaskTable() : lock(PTHREAD_RWLOCK_INITIALIZER)
 {
-    ReaderLock readerLock(&this->lock);
-    auto j = this->nodeInfo.ToJson();
-    return std::move(j);
+    int sockets;
+    System::CPU(this->cores, sockets);
+    this->coreTasks.assign(this->cores, 0);
+
+    JobTaskTable::instance = this;
 }
 
-int JobTaskTable::GetTaskCount()
+void JobTaskTable::WriteJson(JsonWriter& writer, bool delta)
 {
     ReaderLock readerLock(&this->lock);
-    int taskCount = 0;
+    std::lock_guard<std::mutex> guard(this->heartbeatLock);
 
-    for_each(this->nodeInfo.Jobs.begin(), this->nodeInfo.Jobs.end(),
-        [&taskCount] (auto& i) { taskCount += i.second->Tasks.size(); });
+    for (const auto& job : this->nodeInfo.Jobs)
+    {
+        for (const auto& task : job.second->Tasks)
+        {
+            size_t hash = task.second->GetReportedHash();
+            if (task.second->Version == 0 || hash != task.second->ReportedHash)
+            {
+                task.second->ReportedHash = hash;
+                task.second->Version = ++this->version;
+            }
+        }
+    }
 
-    return taskCount;
-}
+    bool full = !delta || this->nodeInfo.JustStarted || this->fullSnapshotNeeded;
 
-int JobTaskTable::GetCoresInUse()
-{
-    ReaderLock readerLock(&this->lock);
+    this->pendingSequence = ++this->sequence;
+    this->pendingVersion = this->version;
+    this->pendingFull = full;
 
-    bool allUsed = false;
-    int cores, sockets;
-    System::CPU(cores, sockets);
+    writer.StartObject();
 
-    std::vector<uint64_t> coresMask(ceil((float)cores / 64), 0);
-    for_each(this->nodeInfo.Jobs.begin(), this->nodeInfo.Jobs.end(), [&coresMask, &allUsed] (auto& job)
+    if (full)
     {
-        for_each(job.second->Tasks.begin(), job.second->Tasks.end(), [&coresMask, &allUsed] (auto& task)
+        this->nodeInfo.WriteJsonFields(writer);
+    }
+    else
+    {
+        this->nodeInfo.WriteDeltaJsonFields(writer, this->ackedVersion);
+        writer.Field("BaseSequence", this->ackedSequence);
+
+        // the server applies the removals before the jobs, a task may be removed and started again.
+        writer.Key("RemovedJobs").StartArray();
+        for (const auto& r : this->removed)
         {
-            if (task.second->Affinity.empty())
+            if (std::get<0>(r) > this->ackedVersion && std::get<2>(r) < 0)
             {
-                allUsed = true;
+                writer.Value(std::get<1>(r));
             }
-            else
+        }
+
+        writer.EndArray();
+
+        writer.Key("RemovedTasks").StartArray();
+        for (const auto& r : this->removed)
+        {
+            if (std::get<0>(r) > this->ackedVersion && std::get<2>(r) >= 0)
             {
-                for (size_t i = 0; i < coresMask.size() && i < task.second->Affinity.size(); i++)
-                {
-                    coresMask[i] |= task.second->Affinity[i];
-                }
+                writer.StartObject().Field("JobId", std::get<1>(r)).Field("TaskId", std::get<2>(r)).EndObject();
             }
-        });
-    });
+        }
+
+        writer.EndArray();
+    }
+
+    if (delta)
+    {
+        writer.Field("Sequence", this->pendingSequence);
+        writer.Field("IsDelta", !full);
+    }
+
+    writer.EndObject();
+}
+
+void JobTaskTable::AcknowledgeHeartbeat(const json::value& response)
+{
+    WriterLock writerLock(&this->lock);
+    std::lock_guard<std::mutex> guard(this->heartbeatLock);
+
+    uint64_t acked = this->pendingSequence;
+
+    if (response.is_object())
+    {
+        if (response.has_field("AckSequence") && response.at("AckSequence").is_number())
+        {
+            acked = response.at("AckSequence").as_number().to_uint64();
+        }
+
+        if (response.has_field("RequestFullSnapshot") && response.at("RequestFullSnapshot").is_boolean() &&
+            response.at("RequestFullSnapshot").as_bool())
+        {
+            Logger::Info("Full heartbeat snapshot requested by the server");
+            this->fullSnapshotNeeded = true;
+            return;
+        }
+    }
+
+    if (acked == 0 || acked != this->pendingSequence)
+    {
+        return;
+    }
+
+    this->ackedSequence = acked;
+    this->ackedVersion = this->pendingVersion;
+    this->pendingSequence = 0;
+
+    if (this->pendingFull)
+    {
+        this->fullSnapshotNeeded = false;
+    }
+
+    this->removed.erase(
+        std::remove_if(this->removed.begin(), this->removed.end(), [this](const auto& r) { return std::get<0>(r) <= this->ackedVersion; }),
+        this->removed.end());
+}
+
+void JobTaskTable::TrackRemoved(int jobId, int taskId)
+{
+    // without acknowledgements, a full snapshot replaces the removals.
+    if (this->removed.size() >= this->MaxRemovedEntries)
+    {
+        this->removed.clear();
+        this->fullSnapshotNeeded = true;
+    }
+
+    this->removed.emplace_back(++this->version, jobId, taskId);
+}
+
+void JobTaskTable::AddCores(const std::vector<uint64_t>& affinity)
+{
+    this->tasks++;
 
-    if (allUsed)
+    if (affinity.empty())
     {
-        return cores;
+        this->unboundTasks++;
+        return;
     }
 
-    int used = 0;
-    uint64_t bit = 1;
-    for (int i = 0; i < cores; i++)
+    for (int i = 0; i < this->cores && (size_t)(i / 64) < affinity.size(); i++)
     {
-        if (coresMask[i / 64] & (bit << i % 64))
+        if ((affinity[i / 64] & ((uint64_t)1 << i % 64)) && this->coreTasks[i]++ == 0)
         {
-            used++;
+            this->busyCores++;
         }
     }
+}
+
+void JobTaskTable::ReleaseCores(const std::vector<uint64_t>& affinity)
+{
+    this->tasks--;
+
+    if (affinity.empty())
+    {
+        this->unboundTasks--;
+        return;
+    }
 
-    return used;
+    for (int i = 0; i < this->cores && (size_t)(i / 64) < affinity.size(); i++)
+    {
+        if ((affinity[i / 64] & ((uint64_t)1 << i % 64)) && --this->coreTasks[i] == 0)
+        {
+            this->busyCores--;
+        }
+    }
 }
 
-std::shared_ptr<TaskInfo> JobTaskTable::AddJobAndTask(int jobId, int taskId, bool& isNewEntry)
+void JobTaskTable::UpdateCounts()
+{
+    this->jobCount.store(this->nodeInfo.Jobs.size(), std::memory_order_relaxed);
+    this->taskCount.store(this->tasks, std::memory_order_relaxed);
+    this->coresInUse.store(this->unboundTasks > 0 ? this->cores : this->busyCores, std::memory_order_relaxed);
+}
+
+std::shared_ptr<TaskInfo> JobTaskTable::AddJobAndTask(int jobId, int taskId, const std::vector<uint64_t>& affinity, bool& isNewEntry)
 {
     WriterLock writerLock(&this->lock);
 
@@ -102,8 +215,13 @@ std::shared_ptr<TaskInfo> JobTaskTable::AddJobAndTask(int jobId, int taskId, boo
     {
         task = t->second;
         isNewEntry = false;
+        this->ReleaseCores(task->Affinity);
     }
 
+    task->Affinity = affinity;
+    this->AddCores(task->Affinity);
+    this->UpdateCounts();
+
     return task;
 }
 
@@ -152,6 +270,14 @@ std::shared_ptr<JobInfo> JobTaskTable::RemoveJob(int jobId)
     {
         job = j->second;
         this->nodeInfo.Jobs.erase(j);
+
+        for (const auto& t : job->Tasks)
+        {
+            this->ReleaseCores(t.second->Affinity);
+        }
+
+        this->UpdateCounts();
+        this->TrackRemoved(jobId, -1);
     }
 
     return job;
@@ -170,7 +296,10 @@ void JobTaskTable::RemoveTask(int jobId, int taskId, uint64_t attemptId)
         if (t != j->second->Tasks.end() &&
             t->second->GetAttemptId() == attemptId)
         {
+            this->ReleaseCores(t->second->Affinity);
             j->second->Tasks.erase(t);
+            this->UpdateCounts();
+            this->TrackRemoved(jobId, taskId);
         }
     }
 }
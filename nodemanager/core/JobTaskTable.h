@@ -2,6 +2,9 @@
 #define JOBTASKTABLE_H
 
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <tuple>
 #include <cpprest/json.h>
 
 #include "../data/TaskInfo.h"
@@ -16,10 +19,7 @@ namespace hpc
         class JobTaskTable
         {
             public:
-                JobTaskTable() : lock(PTHREAD_RWLOCK_INITIALIZER)
-                {
-                    JobTaskTable::instance = this;
-                }
+                JobTaskTable();
 
                 ~JobTaskTable()
                 {
@@ -27,23 +27,28 @@ namespace hpc
                     JobTaskTable::instance = nullptr;
                 }
 
-                web::json::value ToJson();
+                // the delta only has the tasks changed since the last acknowledged heartbeat,
+                // a full snapshot is sent after the start, a resync or when the server asks for it.
+                void WriteJson(hpc::utils::JsonWriter& writer, bool delta = false);
+
+                // with the heartbeat response, which is the interval or an object with
+                // AckSequence and RequestFullSnapshot.
+                void AcknowledgeHeartbeat(const web::json::value& response);
              //   web::json::value GetTaskJson(int jobId, int taskId) const;
 
-                std::shared_ptr<hpc::data::TaskInfo> AddJobAndTask(int jobId, int taskId, bool& isNewEntry);
+                std::shared_ptr<hpc::data::TaskInfo> AddJobAndTask(int jobId, int taskId, const std::vector<uint64_t>& affinity, bool& isNewEntry);
                 std::shared_ptr<hpc::data::JobInfo> RemoveJob(int jobId);
                 void RemoveTask(int jobId, int taskId, uint64_t attemptId);
                 std::shared_ptr<hpc::data::TaskInfo> GetTask(int jobId, int taskId);
                 std::vector<std::shared_ptr<hpc::data::TaskInfo>> GetAllTasks();
-                int GetJobCount()
-                {
-                    ReaderLock readerLock(&this->lock);
-                    return this->nodeInfo.Jobs.size();
-                }
-
-                int GetTaskCount();
+                // maintained by the add and remove calls, read by the metric collectors without the lock.
+                int GetJobCount() const { return this->jobCount.load(std::memory_order_relaxed); }
+                int GetTaskCount() const { return this->taskCount.load(std::memory_order_relaxed); }
+                int GetCoresInUse() const { return this->coresInUse.load(std::memory_order_relaxed); }
 
-                int GetCoresInUse();
+                // logical cpus bound to more than one running task, set by the executor.
+                int GetOverlappingCores() const { return this->overlappingCores; }
+                void SetOverlappingCores(int cores) { this->overlappingCores = cores; }
 
                 void RequestResync()
                 {
@@ -55,8 +60,42 @@ namespace hpc
 
             protected:
             private:
+                // caller holds the writer lock.
+                void AddCores(const std::vector<uint64_t>& affinity);
+                void ReleaseCores(const std::vector<uint64_t>& affinity);
+                void UpdateCounts();
+                void TrackRemoved(int jobId, int taskId);
+
                 pthread_rwlock_t lock;
                 hpc::data::NodeInfo nodeInfo;
+                std::atomic<int> overlappingCores { 0 };
+
+                // running tasks on each logical cpu, a task without affinity uses all of them.
+                int cores = 0;
+                std::vector<int> coreTasks;
+                int busyCores = 0;
+                int unboundTasks = 0;
+                int tasks = 0;
+
+                std::atomic<int> jobCount { 0 };
+                std::atomic<int> taskCount { 0 };
+                std::atomic<int> coresInUse { 0 };
+
+                // the heartbeat sequences, changed under the writer lock or the reader lock with heartbeatLock.
+                std::mutex heartbeatLock;
+                uint64_t version = 0;
+                uint64_t sequence = 0;
+                uint64_t pendingSequence = 0;
+                uint64_t pendingVersion = 0;
+                bool pendingFull = false;
+                uint64_t ackedSequence = 0;
+                uint64_t ackedVersion = 0;
+                bool fullSnapshotNeeded = true;
+
+                // version, job id, task id or -1 for the whole job.
+                std::vector<std::tuple<uint64_t, int, int>> removed;
+
+                const size_t MaxRemovedEntries = 4096;
 
                 static JobTaskTable* instance;
         };
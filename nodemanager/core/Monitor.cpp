@@ -18,6 +18,8 @@ using namespace hpc::data;
 using namespace hpc::arguments;
 using namespace boost::phoenix::arg_names;
 
+const std::vector<std::string> Monitor::PressureResources = { "cpu", "memory", "io" };
+
 Monitor::Monitor(const std::string& nodeName, const std::string& netName, int interval)
     : name(nodeName), networkName(netName), lock(PTHREAD_RWLOCK_INITIALIZER), intervalSeconds(interval),
     isCollected(false)
@@ -118,6 +120,30 @@ Monitor::Monitor(const std::string& nodeName, const std::string& netName, int in
         return runningTasks;
     });
 
+    this->collectors["\\Node Manager\\Number of Overlapping Cores"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+    {
+        float overlappingCores = 0.0f;
+        auto* table = JobTaskTable::GetInstance();
+        if (table != nullptr)
+        {
+            overlappingCores = table->GetOverlappingCores();
+        }
+
+        return overlappingCores;
+    });
+
+    this->collectors["\\Pressure\\Some Stall (%)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+    {
+        auto it = this->pressureSome.find(instanceName);
+        return it == this->pressureSome.end() ? 0.0f : it->second;
+    }, [] (const std::string& instanceFilter) { return GetFilteredInstanceNames(PressureResources, instanceFilter); });
+
+    this->collectors["\\Pressure\\Full Stall (%)"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
+    {
+        auto it = this->pressureFull.find(instanceName);
+        return it == this->pressureFull.end() ? 0.0f : it->second;
+    }, [] (const std::string& instanceFilter) { return GetFilteredInstanceNames(PressureResources, instanceFilter); });
+
     this->collectors["\\LogicalDisk\\% Free Space"] = std::make_shared<MetricCollectorBase>([this] (const std::string& instanceName)
     {
         if (instanceName == "_Total" || instanceName.empty())
@@ -447,67 +473,66 @@ std::vector<std::vector<unsigned char>> Monitor::GetMonitorPacketData()
     return std::move(packets);
 }
 
-json::value Monitor::GetRegisterInfo()
+bool Monitor::WriteRegisterInfo(JsonWriter& writer)
 {
     ReaderLock lock(&this->lock);
 
     if (!this->isCollected)
     {
-        return json::value::null();
+        return false;
     }
 
-    json::value j;
-    j["NodeName"] = json::value::string(this->name);
-    j["Time"] = json::value::string(this->metricTime);
+    writer.StartObject();
+    writer.Field("NodeName", this->name);
+    writer.Field("Time", this->metricTime);
 
-    j["IpAddress"] = json::value::string(this->ipAddress);
-    j["CoreCount"] = this->coreCount;
-    j["SocketCount"] = this->socketCount;
-    j["MemoryMegabytes"] = this->totalMemoryMb;
-    j["DistroInfo"] = json::value::string(this->distroInfo);
+    writer.Field("IpAddress", this->ipAddress);
+    writer.Field("CoreCount", this->coreCount);
+    writer.Field("SocketCount", this->socketCount);
+    writer.Field("MemoryMegabytes", this->totalMemoryMb);
+    writer.Field("DistroInfo", this->distroInfo);
 
-    std::vector<json::value> networkValues;
+    writer.Key("NetworksInfo").StartArray();
 
     for (const auto& info : this->networkInfo)
     {
-        json::value v;
-        v["Name"] = json::value::string(std::get<0>(info));
-        v["MacAddress"] = json::value::string(std::get<1>(info));
-        v["IpV4"] = json::value::string(std::get<2>(info));
-        v["IpV6"] = json::value::string(std::get<3>(info));
-        v["IsIB"] = std::get<4>(info);
-
-        networkValues.push_back(v);
+        writer.StartObject();
+        writer.Field("Name", std::get<0>(info));
+        writer.Field("MacAddress", std::get<1>(info));
+        writer.Field("IpV4", std::get<2>(info));
+        writer.Field("IpV6", std::get<3>(info));
+        writer.Field("IsIB", std::get<4>(info));
+        writer.EndObject();
     }
 
-    j["NetworksInfo"] = json::value::array(networkValues);
+    writer.EndArray();
 
-    std::vector<json::value> gpuValues;
+    writer.Key("GpuInfo").StartArray();
 
     for (const auto& info : this->gpuInfo.GpuInfos)
     {
-        json::value v;
-        v["Name"] = json::value::string(info.Name);
-        v["Uuid"] = json::value::string(info.Uuid);
-        v["PciBusDevice"] = json::value::string(info.GetPciBusDevice());
-        v["PciBusId"] = json::value::string(info.PciBusId);
-        v["TotalMemory"] = info.TotalMemoryMB;
-        v["MaxSMClock"] = info.MaxSMClock;
-
-        gpuValues.push_back(v);
+        writer.StartObject();
+        writer.Field("Name", info.Name);
+        writer.Field("Uuid", info.Uuid);
+        writer.Field("PciBusDevice", info.GetPciBusDevice());
+        writer.Field("PciBusId", info.PciBusId);
+        writer.Field("TotalMemory", info.TotalMemoryMB);
+        writer.Field("MaxSMClock", info.MaxSMClock);
+        writer.EndObject();
     }
 
-    j["GpuInfo"] = json::value::array(gpuValues);
+    writer.EndArray();
     
     if (!this->azureInstanceMetadata.empty())
     {
-        j["AzureInstanceMetadata"] = json::value::string(this->azureInstanceMetadata);
+        writer.Field("AzureInstanceMetadata", this->azureInstanceMetadata);
     }
 
-    j["CcpVersion"] = json::value::string(Version::GetVersion());
-    j["CustomProperties"] = json::value::string("");
+    writer.Field("CcpVersion", Version::GetVersion());
+    writer.Field("CustomProperties", "");
+    writer.EndObject();
 
-    return std::move(j);
+    return true;
 }
 
 void Monitor::Run()
@@ -541,6 +566,17 @@ void Monitor::Run()
         System::Vmstat(pagesPerSec, contextSwitchesPerSec);
         System::Iostat(bytesPerSecond);
 
+        std::map<std::string, float> pressureSome, pressureFull;
+        for (const auto& resource : PressureResources)
+        {
+            float some, full;
+            if (0 == System::Pressure(resource, some, full))
+            {
+                pressureSome[resource] = some;
+                pressureFull[resource] = full;
+            }
+        }
+
         // network usage
         auto networkUsage = System::GetNetworkUsage();
         for (const auto & pair : networkUsage)
@@ -604,6 +640,8 @@ void Monitor::Run()
             this->pagesPerSec = pagesPerSec;
             this->contextSwitchesPerSec = contextSwitchesPerSec;
             this->bytesPerSecond = bytesPerSecond;
+            this->pressureSome = std::move(pressureSome);
+            this->pressureFull = std::move(pressureFull);
 
             if (this->gpuInitRet == 0)
             {
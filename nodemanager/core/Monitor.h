@@ -8,6 +8,7 @@
 #include <boost/uuid/uuid.hpp>
 
 #include "../utils/System.h"
+#include "../utils/JsonWriter.h"
 #include "../data/MonitoringPacket.h"
 #include "../arguments/MetricCounter.h"
 #include "../arguments/MetricCountersConfig.h"
@@ -31,7 +32,8 @@ namespace hpc
                 ~Monitor();
 
                 std::vector<std::vector<unsigned char>> GetMonitorPacketData();
-                json::value GetRegisterInfo();
+                // false when the node info is not collected yet.
+                bool WriteRegisterInfo(hpc::utils::JsonWriter& writer);
 
                 void SetNodeUuid(const uuid& id);
                 void ApplyMetricConfig(hpc::arguments::MetricCountersConfig&& config, pplx::cancellation_token token);
@@ -74,6 +76,10 @@ namespace hpc
                 float pagesPerSec = 0.0f;
                 float contextSwitchesPerSec = 0.0f;
                 float bytesPerSecond = 0.0f;
+                // the avg10 of /proc/pressure by resource name.
+                std::map<std::string, float> pressureSome;
+                std::map<std::string, float> pressureFull;
+                static const std::vector<std::string> PressureResources;
                 pthread_t threadId = 0;
 
                 std::string azureInstanceMetadata;
@@ -54,6 +54,16 @@ typedef std::map<std::string, int> map_string_int_t;
                 AddConfigurationItem(std::string, HostsFileUri);
                 AddConfigurationItem(std::string, AzureInstanceMetaDataUri);
                 AddConfigurationItem(long, HttpRequestTimeoutSeconds);
+                AddConfigurationItem(int, HttpMaxConnectionsPerEndpoint);
+                AddConfigurationItem(std::string, AffinityMode);
+                AddConfigurationItem(long, StartupTraceThresholdMs);
+                AddConfigurationItem(int, StatisticsSampleInterval);
+                AddConfigurationItem(bool, HeartbeatDelta);
+                AddConfigurationItem(int, TaskCompletionCoalesceMs);
+                AddConfigurationItem(bool, TaskCompletionBatching);
+                AddConfigurationItem(std::string, CompletionOutboxFile);
+                AddConfigurationItem(int, CompletionOutboxSizeMb);
+                AddConfigurationItem(std::string, StateJournalFile);
 
                 static std::string ResolveRegisterUri(pplx::cancellation_token token)
                 {
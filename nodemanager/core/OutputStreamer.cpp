@@ -0,0 +1,172 @@
+#include <cpprest/http_client.h>
+
+#include "OutputStreamer.h"
+#include "HttpHelper.h"
+#include "../utils/Logger.h"
+#include "../utils/System.h"
+#include "../data/OutputData.h"
+
+using namespace web::http;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+const size_t OutputStreamer::MaxBatchBytes;
+const size_t OutputStreamer::MaxBufferedBytes;
+const int OutputStreamer::CoalesceMs;
+
+OutputStreamer::OutputStreamer(int jobId, int taskId, int requeueCount, const std::string& uri) :
+    jobId(jobId), taskId(taskId), requeueCount(requeueCount), uri(uri), writer(MaxBatchBytes + 256)
+{
+    pthread_create(&this->threadId, nullptr, SendingThread, this);
+}
+
+OutputStreamer::~OutputStreamer()
+{
+    this->Close();
+}
+
+void OutputStreamer::Write(const char* data, size_t length)
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+
+    // backpressure, the head node is behind.
+    this->changed.wait(guard, [this]() { return this->buffered.size() < MaxBufferedBytes; });
+
+    bool wasEmpty = this->buffered.empty();
+    if (wasEmpty)
+    {
+        this->firstBuffered = Clock::now();
+    }
+
+    this->buffered.append(data, length);
+
+    // the sender waits for the first bytes to start the window, then for a full batch.
+    if (wasEmpty || this->buffered.size() >= MaxBatchBytes)
+    {
+        this->changed.notify_all();
+    }
+}
+
+void OutputStreamer::Close()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->closed = true;
+    }
+
+    this->changed.notify_all();
+
+    if (this->threadId != 0)
+    {
+        pthread_join(this->threadId, nullptr);
+        this->threadId = 0;
+    }
+}
+
+void* OutputStreamer::SendingThread(void* arg)
+{
+    OutputStreamer* const s = static_cast<OutputStreamer*>(arg);
+    std::unique_lock<std::mutex> guard(s->lock);
+
+    while (true)
+    {
+        while (!s->closed && s->buffered.size() < MaxBatchBytes)
+        {
+            if (s->buffered.empty())
+            {
+                s->changed.wait(guard);
+            }
+            else if (s->changed.wait_until(guard, s->firstBuffered + std::chrono::milliseconds(CoalesceMs)) == std::cv_status::timeout)
+            {
+                break;
+            }
+        }
+
+        if (s->closed && s->buffered.empty())
+        {
+            break;
+        }
+
+        size_t length = GetBatchLength(s->buffered, s->closed);
+        if (length == 0)
+        {
+            // only a cut utf-8 sequence, the rest of it is waited for within the window,
+            // the bytes are sent as they are when it is not completed by then.
+            auto deadline = s->firstBuffered + std::chrono::milliseconds(CoalesceMs);
+            if (Clock::now() < deadline)
+            {
+                s->changed.wait_until(guard, deadline);
+                continue;
+            }
+
+            length = s->buffered.size();
+        }
+
+        std::string content = s->buffered.substr(0, length);
+        s->buffered.erase(0, length);
+        s->firstBuffered = Clock::now();
+        s->changed.notify_all();
+
+        guard.unlock();
+        s->Send(content, false);
+        guard.lock();
+    }
+
+    guard.unlock();
+    s->Send(std::string(), true);
+
+    pthread_exit(nullptr);
+}
+
+size_t OutputStreamer::GetBatchLength(const std::string& buffer, bool all)
+{
+    size_t length = std::min(buffer.size(), MaxBatchBytes);
+    if (all && length == buffer.size())
+    {
+        return length;
+    }
+
+    // step back over the continuation bytes to the lead byte of the last sequence.
+    size_t lead = length;
+    while (lead > 0 && length - lead < 4 && ((unsigned char)buffer[lead - 1] & 0xC0) == 0x80)
+    {
+        lead--;
+    }
+
+    if (lead == 0)
+    {
+        return length;
+    }
+
+    unsigned char c = buffer[lead - 1];
+    size_t sequence = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+
+    return length - (lead - 1) < sequence ? lead - 1 : length;
+}
+
+void OutputStreamer::Send(const std::string& content, bool eof)
+{
+    try
+    {
+        OutputData od(System::GetNodeName(), this->order++, content);
+        od.Eof = eof;
+
+        this->writer.Clear();
+        od.WriteJson(this->writer);
+
+        Logger::Debug(this->jobId, this->taskId, this->requeueCount,
+            "Callback to {0} with {1} bytes, order {2}, eof {3}", this->uri, content.size(), od.Order, eof);
+
+        auto client = HttpHelper::GetHttpClient(this->uri);
+        auto request = HttpHelper::GetJsonHttpRequest(methods::POST, this->writer.GetString());
+        http_response response = client->request(*request).get();
+
+        Logger::Info(this->jobId, this->taskId, this->requeueCount,
+            "Callback to {0} response code {1}", this->uri, response.status_code());
+    }
+    catch (const std::exception& ex)
+    {
+        Logger::Error(this->jobId, this->taskId, this->requeueCount,
+            "Exception when sending back output. {0}", ex.what());
+    }
+}
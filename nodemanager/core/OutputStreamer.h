@@ -0,0 +1,70 @@
+#ifndef OUTPUTSTREAMER_H
+#define OUTPUTSTREAMER_H
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <condition_variable>
+#include <pthread.h>
+
+#include "../utils/JsonWriter.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Sends the output of a streaming task to the head node on its own thread.
+        /// The output is coalesced until a batch is full or the coalesce window elapses,
+        /// and the batches are sent one at a time in order over the pooled client.
+        /// The writer only waits when the buffered output reaches the limit, which happens
+        /// when the head node takes the output slower than the task produces it.
+        class OutputStreamer
+        {
+            public:
+                OutputStreamer(int jobId, int taskId, int requeueCount, const std::string& uri);
+                ~OutputStreamer();
+
+                OutputStreamer(const OutputStreamer&) = delete;
+                OutputStreamer& operator=(const OutputStreamer&) = delete;
+
+                void Write(const char* data, size_t length);
+
+                /// Sends the rest of the output and the eof, returns when they are sent.
+                void Close();
+
+                /// The length of the next batch without a utf-8 sequence cut at its end,
+                /// the whole buffer when all is set and it fits in a batch.
+                static size_t GetBatchLength(const std::string& buffer, bool all);
+
+                static const size_t MaxBatchBytes = 64 * 1024;
+                static const size_t MaxBufferedBytes = 4 * 1024 * 1024;
+                static const int CoalesceMs = 100;
+
+            protected:
+            private:
+                typedef std::chrono::steady_clock Clock;
+
+                static void* SendingThread(void* arg);
+                void Send(const std::string& content, bool eof);
+
+                const int jobId;
+                const int taskId;
+                const int requeueCount;
+                const std::string uri;
+
+                // accessed by the sending thread only.
+                int order = 0;
+                hpc::utils::JsonWriter writer;
+
+                std::mutex lock;
+                std::condition_variable changed;
+                std::string buffered;
+                Clock::time_point firstBuffered;
+                bool closed = false;
+
+                pthread_t threadId = 0;
+        };
+    }
+}
+
+#endif // OUTPUTSTREAMER_H
@@ -1,6 +1,13 @@
 #include <memory.h>
 #include <sys/wait.h>
 #include <sys/resource.h>
+#include <fcntl.h>
+#include <cctype>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <poll.h>
 #include <fstream>
 #include <cpprest/http_client.h>
 #include <boost/algorithm/string/predicate.hpp>
@@ -11,8 +18,12 @@
 #include "../utils/String.h"
 #include "../common/ErrorCodes.h"
 #include "../utils/WriterLock.h"
-#include "../data/OutputData.h"
+#include "../utils/ReaderLock.h"
+#include "../utils/CpuTopology.h"
+#include "../utils/CGroup.h"
 #include "HttpHelper.h"
+#include "ProcessTreeTracker.h"
+#include "OutputStreamer.h"
 
 using namespace hpc::core;
 using namespace hpc::utils;
@@ -20,27 +31,39 @@ using namespace hpc::common;
 using namespace hpc::data;
 using namespace http;
 
+// the same as CGroupSubSys in common.sh
+const std::vector<std::string> Process::CGroupSubSystems = { "cpuacct", "cpuset", "memory", "freezer" };
+
 Process::Process(
     int jobId,
     int taskId,
     int requeueCount,
     const std::string& taskExecutionName,
-    const std::string& cmdLine,
-    const std::string& standardOut,
-    const std::string& standardErr,
-    const std::string& standardIn,
-    const std::string& workDir,
+    std::string cmdLine,
+    std::string standardOut,
+    std::string standardErr,
+    std::string standardIn,
+    std::string workDir,
     const std::string& user,
     bool dumpStdoutToExecutionMessage,
     std::vector<uint64_t>&& cpuAffinity,
     std::map<std::string, std::string>&& envi,
     const std::function<Callback> completed) :
     jobId(jobId), taskId(taskId), requeueCount(requeueCount), taskExecutionId(String::Join("_", taskExecutionName, taskId, requeueCount)),
-    commandLine(cmdLine), stdOutFile(standardOut), stdErrFile(standardErr), stdInFile(standardIn),
-    workDirectory(workDir), userName(user.empty() ? "root" : user), dumpStdout(dumpStdoutToExecutionMessage),
-    affinity(cpuAffinity), environments(envi), callback(completed), processId(0)
+    cgroup(String::Join("_", "nmgroup", taskExecutionId)),
+    commandLine(std::move(cmdLine)), stdOutFile(std::move(standardOut)), stdErrFile(std::move(standardErr)), stdInFile(std::move(standardIn)),
+    workDirectory(std::move(workDir)), userName(user.empty() ? "root" : user), dumpStdout(dumpStdoutToExecutionMessage),
+    affinity(std::move(cpuAffinity)), environments(std::move(envi)), callback(completed), processId(0)
 {
     this->streamOutput = StartWithHttpOrHttps(stdOutFile);
+    this->traceStartup = taskExecutionName == "Task";
+    this->cpuSet = this->GetAffinityCpus();
+
+    auto dockerImageIt = this->environments.find("CCP_DOCKER_IMAGE");
+    this->dockerTask = dockerImageIt != this->environments.end() && !dockerImageIt->second.empty();
+    auto disableCgroupIt = this->environments.find("CCP_DISABLE_CGROUP");
+    this->cgroupDisabled = disableCgroupIt != this->environments.end() && disableCgroupIt->second == "1";
+    this->trackProcessTree = this->cgroupDisabled || !System::IsCGroupInstalled();
 
     Logger::Debug(this->jobId, this->taskId, this->requeueCount, "{0}, stream ? {1}", stdOutFile, this->streamOutput);
 }
@@ -53,10 +76,10 @@ Process::~Process()
     pthread_rwlock_destroy(&this->lock);
 }
 
-void Process::Cleanup()
+void Process::Cleanup(const std::vector<std::string>& keptTaskExecutionIds)
 {
     std::string output;
-    System::ExecuteCommandOut(output, "/bin/bash", "CleanupAllTasks.sh");
+    System::ExecuteCommandOut(output, "/bin/bash", "CleanupAllTasks.sh", String::Join<' '>(keptTaskExecutionIds));
     Logger::Info("Cleanup zombie result: {0}", output);
 }
 
@@ -70,6 +93,90 @@ pplx::task<std::pair<pid_t, pthread_t>> Process::Start(std::shared_ptr<Process>
     return pplx::task<std::pair<pid_t, pthread_t>>(this->started);
 }
 
+void Process::WriteState(JsonWriter& writer) const
+{
+    writer.StartObject();
+    writer.Field("Pid", (int)this->processId);
+    writer.Field("StartTime", this->processStartTime);
+    writer.Field("TaskFolder", this->taskFolder);
+    writer.Field("StdOutFile", this->stdOutFile);
+    writer.Field("StdErrFile", this->stdErrFile);
+    writer.Field("DumpStdout", this->dumpStdout);
+    writer.Field("DirectExec", this->directExec);
+    writer.Field("DockerTask", this->dockerTask);
+    writer.Field("CgroupDisabled", this->cgroupDisabled);
+    writer.Field("TrackProcessTree", this->trackProcessTree);
+    writer.Field("StreamOutput", this->streamOutput);
+
+    writer.Key("CpuSet").StartArray();
+    for (int cpu : this->cpuSet) { writer.Value(cpu); }
+    writer.EndArray();
+
+    writer.Key("ExtraCGroups").StartArray();
+    for (const auto& controller : this->extraCGroups) { writer.Value(controller); }
+    writer.EndArray();
+
+    writer.EndObject();
+}
+
+void Process::ReadState(JsonReader& reader)
+{
+    std::string key;
+
+    reader.StartObject();
+    while (reader.NextKey(key))
+    {
+        if (key == "Pid") { this->processId = reader.ReadInt(); }
+        else if (key == "StartTime") { this->processStartTime = reader.ReadUInt64(); }
+        else if (key == "TaskFolder") { reader.ReadString(this->taskFolder); }
+        else if (key == "StdOutFile") { reader.ReadString(this->stdOutFile); }
+        else if (key == "StdErrFile") { reader.ReadString(this->stdErrFile); }
+        else if (key == "DumpStdout") { this->dumpStdout = reader.ReadBool(); }
+        else if (key == "DirectExec") { this->directExec = reader.ReadBool(); }
+        else if (key == "DockerTask") { this->dockerTask = reader.ReadBool(); }
+        else if (key == "CgroupDisabled") { this->cgroupDisabled = reader.ReadBool(); }
+        else if (key == "TrackProcessTree") { this->trackProcessTree = reader.ReadBool(); }
+        else if (key == "StreamOutput") { this->streamOutput = reader.ReadBool(); }
+        else if (key == "CpuSet")
+        {
+            this->cpuSet.clear();
+            reader.StartArray();
+            while (reader.NextElement()) { this->cpuSet.push_back(reader.ReadInt()); }
+        }
+        else if (key == "ExtraCGroups")
+        {
+            this->extraCGroups.clear();
+            reader.StartArray();
+            while (reader.NextElement())
+            {
+                std::string controller;
+                reader.ReadString(controller);
+                this->extraCGroups.push_back(std::move(controller));
+            }
+        }
+        else
+        {
+            reader.Skip();
+        }
+    }
+}
+
+bool Process::IsAlive() const
+{
+    return this->processId > 0 && this->processStartTime != 0 &&
+        System::GetProcessStartTime(this->processId) == this->processStartTime;
+}
+
+pplx::task<std::pair<pid_t, pthread_t>> Process::Adopt(std::shared_ptr<Process> self)
+{
+    this->SetSelfPtr(self);
+    pthread_create(&this->threadId, nullptr, AdoptThread, this);
+
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Created adopt thread {0} for process {1}", this->threadId, this->processId);
+
+    return pplx::task<std::pair<pid_t, pthread_t>>(this->started);
+}
+
 void Process::Kill(int forcedExitCode, bool forced)
 {
     if (forcedExitCode != 0x0FFFFFFF)
@@ -80,44 +187,120 @@ void Process::Kill(int forcedExitCode, bool forced)
 
     if (!this->ended)
     {
-        this->ExecuteCommand("/bin/bash", "EndTask.sh", this->taskExecutionId, this->processId, forced ? "1" : "0", this->taskFolder);
+        this->Terminate(forced);
     }
 }
 
-const ProcessStatistics& Process::GetStatisticsFromCGroup()
+void Process::Terminate(bool forced)
 {
-    std::string stat;
-    System::ExecuteCommandOut(stat, "/bin/bash", "Statistics.sh", this->taskExecutionId, this->taskFolder);
+    if (this->trackProcessTree)
+    {
+        ProcessTreeTracker::GetInstance().Kill(this->taskExecutionId, forced ? SIGKILL : SIGINT);
+        return;
+    }
+
+    std::string groupName = this->GetTaskGroupName();
+    if (groupName.empty())
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount, "No cgroup found to terminate the task.");
+        return;
+    }
+
+    CGroup group(groupName);
+    if (forced && group.Kill() == 0)
+    {
+        return;
+    }
+
+    // freeze the group so that no process escapes by forking while being signaled.
+    int ret = group.Freeze(true, this->FreezeTimeoutMs);
+    if (ret != 0)
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Failed to freeze cgroup {0}, ret {1}", groupName, ret);
+    }
+
+    group.Signal(forced ? SIGKILL : SIGINT);
+
+    ret = group.Freeze(false, this->FreezeTimeoutMs);
+    if (ret != 0)
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Failed to thaw cgroup {0}, ret {1}", groupName, ret);
+    }
+}
 
-    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Statistics: {0}", stat);
+bool Process::WaitForExit(int timeoutMs)
+{
+    if (this->trackProcessTree)
+    {
+        return ProcessTreeTracker::GetInstance().WaitEmpty(this->taskExecutionId, timeoutMs);
+    }
 
-    std::istringstream statIn(stat);
+    std::string groupName = this->GetTaskGroupName();
+    return groupName.empty() || CGroup(groupName).WaitEmpty(timeoutMs);
+}
 
+ProcessStatistics Process::GetStatisticsFromCGroup()
+{
     WriterLock writerLock(&this->lock);
-    
-    this->statistics.UserTimeMs = 0;
-    statIn >> this->statistics.UserTimeMs;
-    this->statistics.UserTimeMs *= 10;
 
-    this->statistics.KernelTimeMs = 0;
-    statIn >> this->statistics.KernelTimeMs;
-    this->statistics.KernelTimeMs *= 10;
+    if (!this->statsReader && !this->cgroupDisabled && System::IsCGroupInstalled())
+    {
+        std::string groupName = this->GetTaskGroupName();
 
-    this->statistics.WorkingSetKb = 0;
-    statIn >> this->statistics.WorkingSetKb;
-    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "WorkingSet {0}", this->statistics.WorkingSetKb);
-    this->statistics.WorkingSetKb /= 1024;
+        // the files are resolved once, so wait for the group to be created.
+        struct stat st;
+        if (!groupName.empty() && stat(CGroup(groupName).GetPath("cpuacct").c_str(), &st) == 0)
+        {
+            this->statsReader.reset(new CGroupStatsReader(CGroup(groupName)));
+        }
+    }
 
-    this->statistics.ProcessIds.clear();
-    int id;
-    while (statIn >> id)
+    if (this->statsReader)
+    {
+        this->statsReader->Read(this->statistics);
+    }
+    else if (!this->trackProcessTree || !ProcessTreeTracker::GetInstance().GetStatistics(this->taskExecutionId, this->statistics))
     {
-        this->statistics.ProcessIds.push_back(id);
+        this->statistics.UserTimeMs = 0;
+        this->statistics.KernelTimeMs = 0;
+        this->statistics.WorkingSetKb = 0;
+        this->statistics.ProcessIds.clear();
     }
 
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Statistics: user {0}ms, kernel {1}ms, working set {2}KB, {3} processes",
+        this->statistics.UserTimeMs, this->statistics.KernelTimeMs, this->statistics.WorkingSetKb, this->statistics.ProcessIds.size());
+
+    this->ReadNumaStat();
+
+    // copied under the lock, the aggregator and the ending threads read it concurrently.
     return this->statistics;
 }
 
+std::string Process::GetTaskGroupName() const
+{
+    if (!this->dockerTask)
+    {
+        return this->cgroup.GetName();
+    }
+
+    // the same as GetCGroupNameOfDockerTask in common.sh
+    std::ifstream fs(this->taskFolder + "/containerId", std::ios::in);
+    std::string containerId;
+    if (!(fs >> containerId))
+    {
+        return std::string();
+    }
+
+    std::string cgroupfsName = "docker/" + containerId;
+    struct stat st;
+    if (stat(CGroup(cgroupfsName).GetProcsFile("cpuset").c_str(), &st) == 0)
+    {
+        return cgroupfsName;
+    }
+
+    return "system.slice/docker-" + containerId + ".scope";
+}
+
 pplx::task<void> Process::OnCompleted()
 {
     return pplx::task<void>(this->completed);
@@ -129,10 +312,16 @@ void Process::OnCompletedInternal()
     {
         this->completed.set();
 
+        ProcessStatistics statistics;
+        {
+            ReaderLock readerLock(&this->lock);
+            statistics = this->statistics;
+        }
+
         this->callback(
             this->exitCode,
             this->message.str(),
-            this->statistics);
+            statistics);
     }
     catch (const std::exception& ex)
     {
@@ -148,12 +337,16 @@ void* Process::ForkThread(void* arg)
 {
     Process* const p = static_cast<Process* const>(arg);
     std::string path;
-    auto dockerImageIt = p->environments.find("CCP_DOCKER_IMAGE");
-    bool isDockerTask = dockerImageIt != p->environments.end() && !dockerImageIt->second.empty();
-    auto disableCgroupIt = p->environments.find("CCP_DISABLE_CGROUP");
-    bool disableCgroup = disableCgroupIt != p->environments.end() && disableCgroupIt->second == "1";
+    bool isDockerTask = p->dockerTask;
+    bool disableCgroup = p->cgroupDisabled;
 
 Start:
+    {
+        // the group is re-created for every attempt.
+        WriterLock writerLock(&p->lock);
+        p->statsReader.reset();
+    }
+
     int ret = p->CreateTaskFolder();
     if (ret != 0)
     {
@@ -164,7 +357,16 @@ Start:
         goto Final;
     }
 
-    path = p->BuildScript();
+    p->Trace(TracePhase::TaskFolderCreated);
+
+    p->cgroupTasksFiles.clear();
+    p->extraCGroups.clear();
+
+    // Launch the command line directly when nothing in the start info needs the
+    // shell to interpret it, otherwise fall back to the generated scripts.
+    p->directExec = !isDockerTask && p->CanDirectExec() && p->PrepareDirectExec(!disableCgroup);
+
+    path = p->directExec ? p->taskFolder : p->BuildScript();
     if (path.empty())
     {
         p->message << "Error when build script." << std::endl;
@@ -203,11 +405,30 @@ Start:
         }
     }
 
-    if (0 != p->ExecuteCommand("/bin/bash", "PrepareTask.sh", p->taskExecutionId, p->GetAffinity(), p->taskFolder, p->userName))
+    if (0 != p->ExecuteCommand("/bin/bash", "PrepareTask.sh", p->taskExecutionId, p->GetAffinity(), p->taskFolder, p->userName, p->PrepareMemoryNodes(!isDockerTask && !disableCgroup)))
     {
         goto Final;
     }
 
+    if (!isDockerTask && !disableCgroup && System::IsCGroupInstalled())
+    {
+        ret = p->ApplyResourceLimits();
+        if (ret != 0)
+        {
+            p->message << "Task " << p->taskId << ": failed to apply resource limits, errno " << ret << std::endl;
+            p->SetExitCode((int)ErrorCodes::ApplyResourceLimitsError);
+            goto Final;
+        }
+    }
+
+    p->Trace(TracePhase::TaskPrepared);
+
+    if (-1 == pipe2(p->execPipe, O_CLOEXEC))
+    {
+        Logger::Warn(p->jobId, p->taskId, p->requeueCount, "Error when create exec pipe, errno {0}", errno);
+        p->execPipe[0] = p->execPipe[1] = -1;
+    }
+
     if (-1 == pipe(p->stdoutPipe))
     {
         p->message << "Error when create stdout pipe." << std::endl;
@@ -235,37 +456,33 @@ Start:
 
     if (p->processId == 0)
     {
-        p->Run(path);
+        if (p->execPipe[0] != -1) { close(p->execPipe[0]); }
+
+        if (p->directExec)
+        {
+            p->RunDirect();
+        }
+        else
+        {
+            p->Run(path);
+        }
     }
     else
     {
         assert(p->processId > 0);
+        p->Trace(TracePhase::Forked);
+        p->processStartTime = System::GetProcessStartTime(p->processId);
+        if (p->trackProcessTree)
+        {
+            ProcessTreeTracker::GetInstance().Track(p->taskExecutionId, p->processId);
+        }
+
         p->started.set(std::pair<pid_t, pthread_t>(p->processId, p->threadId));
         p->Monitor();
     }
 
 Final:
-    p->ExecuteCommandNoCapture("/bin/bash", "EndTask.sh", p->taskExecutionId, p->processId, "1", p->taskFolder);
-    p->GetStatisticsFromCGroup();
-
-    ret = p->ExecuteCommandNoCapture("/bin/bash", "CleanupTask.sh", p->taskExecutionId, p->processId, p->taskFolder);
-
-    // Only clean up the folder when success.
-    if (p->exitCode == 0)
-    {
-        p->ExecuteCommandNoCapture("rm -rf", p->taskFolder);
-    }
-
-    if (p->outputThreadId != 0)
-    {
-        int joinret = pthread_join(p->outputThreadId, nullptr);
-        if (joinret != 0)
-        {
-            Logger::Error(p->jobId, p->taskId, p->requeueCount, "Join the output thread id {0}, ret = {1}", p->outputThreadId, joinret);
-        }
-
-        p->outputThreadId = 0;
-    }
+    ret = p->Finalize();
 
     // TODO: Add logic to precisely define 253 error.
     if ((p->exitCode == 82 && ret == 96) || p->exitCode == 253)
@@ -273,88 +490,207 @@ Final:
         p->exitCodeSet = false;
         p->exitCode = (int)hpc::common::ErrorCodes::DefaultExitCode;
         Logger::Error(p->jobId, p->taskId, p->requeueCount, "Exit Code {0} Reset exit code and retry to fork()", p->exitCode);
+
+        // the journaled state may still point to the folder of this attempt, its exit code is not the task's.
+        unlink((p->taskFolder + "/exit_code").c_str());
         goto Start;
     }
 
-    p->ended = true;
-
-    auto tmp = p->stdErr.str();
-    if (!tmp.empty()) { p->message << tmp; }
-
-    p->OnCompletedInternal();
-
-    p->ResetSelfPtr();
+    p->Complete();
 
     pthread_detach(pthread_self());
     pthread_exit(nullptr);
 }
 
-void* Process::ReadPipeThread(void* p)
+void* Process::AdoptThread(void* arg)
 {
-    Logger::Info("Started reading pipe thread");
-    auto* process = static_cast<Process*>(p);
+    Process* const p = static_cast<Process* const>(arg);
 
-    const std::string& uri = process->stdOutFile;
-    close(process->stdoutPipe[1]);
+    if (p->IsAlive())
+    {
+        if (p->trackProcessTree)
+        {
+            ProcessTreeTracker::GetInstance().Track(p->taskExecutionId, p->processId);
+        }
+
+        p->started.set(std::pair<pid_t, pthread_t>(p->processId, p->threadId));
 
-    int bytesRead = 0;
-    char buffer[1024];
-    int order = 0;
-    while ((bytesRead = read(process->stdoutPipe[0], buffer, sizeof(buffer) - 1)) > 0)
+        if (!p->CanAdopt())
+        {
+            Logger::Warn(p->jobId, p->taskId, p->requeueCount, "Process {0} cannot be adopted, terminating it", p->processId);
+            p->message << "Task " << p->taskId << " cannot be resumed after the node manager restarted." << std::endl;
+            p->SetExitCode((int)ErrorCodes::TaskAdoptionError);
+            p->Terminate(true);
+        }
+
+        p->WaitAdopted();
+    }
+    else
     {
-        buffer[bytesRead] = '\0';
-        auto readStr = String::Join("", buffer);
+        Logger::Info(p->jobId, p->taskId, p->requeueCount, "Process {0} exited while the agent was down", p->processId);
+        p->started.set(std::pair<pid_t, pthread_t>(p->processId, p->threadId));
+    }
 
-        Logger::Debug("read {0} bytes, streamOutput {1}", bytesRead, process->streamOutput);
-        if (process->streamOutput)
+    if (!p->exitCodeSet)
+    {
+        // written by the exit trap of StartTask.sh, a direct exec process leaves nothing.
+        std::ifstream fs(p->taskFolder + "/exit_code", std::ios::in);
+        int exitCode;
+        if (fs >> exitCode)
         {
-            // send out readStr
-            process->SendbackOutput(uri, readStr, order++);
+            Logger::Info(p->jobId, p->taskId, p->requeueCount, "Process {0}: exit code {1}", p->processId, exitCode);
+            p->SetExitCode(exitCode);
+            p->AppendOutputTail();
         }
         else
         {
-            process->stdErr << buffer;
+            Logger::Warn(p->jobId, p->taskId, p->requeueCount, "Process {0}: exit code is lost with the previous agent", p->processId);
+            p->message << "Process " << p->processId << " exited while the node manager was restarting, the exit code is unknown." << std::endl;
+            p->SetExitCode((int)ErrorCodes::TaskAdoptionError);
         }
     }
 
-    Logger::Debug("read end. treamOutput {0}", process->streamOutput);
-    if (process->streamOutput)
+    p->Finalize();
+    p->Complete();
+
+    pthread_detach(pthread_self());
+    pthread_exit(nullptr);
+}
+
+void Process::WaitAdopted()
+{
+    // the process is not a child of this agent, so it cannot be waited by wait4.
+#ifdef SYS_pidfd_open
+    int fd = syscall(SYS_pidfd_open, this->processId, 0);
+    if (fd >= 0)
     {
-        process->SendbackOutput(uri, std::string(), order++);
+        // the pid might be reused between the check and the open.
+        if (this->IsAlive())
+        {
+            pollfd pfd = { fd, POLLIN, 0 };
+            while (poll(&pfd, 1, -1) == -1 && errno == EINTR) { }
+        }
+
+        close(fd);
+        this->Trace(TracePhase::Exited);
+        return;
     }
 
-    close(process->stdoutPipe[0]);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "pidfd_open for process {0} error {1}, polling it", this->processId, errno);
+#endif
 
-    pthread_exit(nullptr);
+    while (this->IsAlive())
+    {
+        usleep(AdoptPollIntervalMs * 1000);
+    }
+
+    this->Trace(TracePhase::Exited);
 }
 
-void Process::SendbackOutput(const std::string& uri, const std::string& output, int order) const
+int Process::Finalize()
 {
-    try
+    for (int& fd : this->execPipe)
+    {
+        if (fd != -1) { close(fd); fd = -1; }
+    }
+
+    this->Terminate(true);
+    this->GetStatisticsFromCGroup();
+    if (!this->dockerTask && !this->cgroupDisabled && System::IsCGroupInstalled())
     {
-        OutputData od(System::GetNodeName(), order, output);
+        this->ReadLimitCounters();
+    }
+
+    this->Trace(TracePhase::StatisticsCollected);
+    ProcessTreeTracker::GetInstance().Untrack(this->taskExecutionId);
+
+    int ret = this->ExecuteCommandNoCapture("/bin/bash", "CleanupTask.sh", this->taskExecutionId, this->processId, this->taskFolder);
+
+    for (const auto& controller : this->extraCGroups)
+    {
+        this->cgroup.Remove(controller);
+    }
+
+    this->Trace(TracePhase::CleanedUp);
+
+    // Only clean up the folder when success.
+    if (this->exitCode == 0)
+    {
+        this->ExecuteCommandNoCapture("rm -rf", this->taskFolder);
+    }
+
+    if (this->outputThreadId != 0)
+    {
+        int joinret = pthread_join(this->outputThreadId, nullptr);
+        if (joinret != 0)
+        {
+            Logger::Error(this->jobId, this->taskId, this->requeueCount, "Join the output thread id {0}, ret = {1}", this->outputThreadId, joinret);
+        }
+
+        this->outputThreadId = 0;
+    }
+
+    return ret;
+}
+
+void Process::Complete()
+{
+    this->ended = true;
+
+    auto tmp = this->stdErr.str();
+    if (!tmp.empty()) { this->message << tmp; }
+
+    this->OnCompletedInternal();
+
+    this->ResetSelfPtr();
+}
+
+void* Process::ReadPipeThread(void* p)
+{
+    Logger::Info("Started reading pipe thread");
+    auto* process = static_cast<Process*>(p);
 
-        if (output.empty()) { od.Eof = true; }
+    close(process->stdoutPipe[1]);
+
+    // the output is sent by the streamer, so the pipe is drained at the pace of the task.
+    std::unique_ptr<OutputStreamer> streamer;
+    if (process->streamOutput)
+    {
+        streamer.reset(new OutputStreamer(process->jobId, process->taskId, process->requeueCount, process->stdOutFile));
+    }
 
-        auto jsonBody = od.ToJson();
-        if (!jsonBody.is_null())
+    std::vector<char> buffer(PipeBufferSize);
+    ssize_t bytesRead;
+    bool firstOutput = true;
+    while ((bytesRead = read(process->stdoutPipe[0], &buffer[0], buffer.size())) != 0)
+    {
+        if (bytesRead < 0)
         {
-            Logger::Debug(this->jobId, this->taskId, this->requeueCount,
-                "Callback to {0} with {1}", uri, jsonBody);
+            if (errno == EINTR) { continue; }
+            break;
+        }
 
-            auto client = HttpHelper::GetHttpClient(uri);
-            auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
-            http_response response = client->request(*request).get();
+        if (firstOutput) { process->Trace(TracePhase::FirstOutput); firstOutput = false; }
 
-            Logger::Info(this->jobId, this->taskId, this->requeueCount,
-                "Callback to {0} response code {1}", uri, response.status_code());
+        if (streamer)
+        {
+            streamer->Write(&buffer[0], bytesRead);
+        }
+        else
+        {
+            process->stdErr.write(&buffer[0], bytesRead);
         }
     }
-    catch (const std::exception& ex)
+
+    Logger::Debug("read end. streamOutput {0}", process->streamOutput);
+    if (streamer)
     {
-        Logger::Error(this->jobId, this->taskId, this->requeueCount,
-            "Exception when sending back output. {0}", ex.what());
+        streamer->Close();
     }
+
+    close(process->stdoutPipe[0]);
+
+    pthread_exit(nullptr);
 }
 
 void Process::Monitor()
@@ -364,10 +700,26 @@ void Process::Monitor()
 
     pthread_create(&this->outputThreadId, nullptr, Process::ReadPipeThread, this);
 
+    if (this->execPipe[1] != -1)
+    {
+        close(this->execPipe[1]);
+        this->execPipe[1] = -1;
+
+        char signal;
+        ssize_t ret;
+        while ((ret = read(this->execPipe[0], &signal, 1)) > 0 || (ret == -1 && errno == EINTR))
+        {
+            if (ret > 0 && signal == 'T') { this->Trace(TracePhase::MutualTrustChecked); }
+        }
+
+        this->Trace(TracePhase::Executed);
+    }
+
     int status;
     rusage usage;
     assert(this->processId > 0);
     pid_t waitedPid = wait4(this->processId, &status, 0, &usage);
+    this->Trace(TracePhase::Exited);
     assert(this->processId > 0);
     if (waitedPid == -1)
     {
@@ -394,29 +746,14 @@ void Process::Monitor()
             "Process {0}: exit code {1}", this->processId, WEXITSTATUS(status));
         this->SetExitCode(WEXITSTATUS(status));
 
-        if (!this->streamOutput)
+        // same as the 'after' probe of run_dir_in_out.sh, retry if the task folder is gone.
+        if (this->directExec && this->exitCode == 0 && access(this->taskFolder.c_str(), F_OK) != 0)
         {
-            std::string output;
-        
-            int ret = 0;
-            if (this->dumpStdout)
-            {
-                ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdOutFile);
-                if (ret == 0)
-                {
-                    this->message << "STDOUT: " << output << std::endl;
-                }
-            }
-
-            if (this->stdOutFile != this->stdErrFile)
-            {
-                ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdErrFile);
-                if (ret == 0)
-                {
-                    this->message << "STDERR: " << output << std::endl;
-                }
-            }
+            Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Task folder {0} is not accessible after run, errno {1}", this->taskFolder, errno);
+            this->SetExitCode(253);
         }
+
+        this->AppendOutputTail();
     }
     else
     {
@@ -441,8 +778,39 @@ void Process::Monitor()
     Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Process {0}: Monitor ended", this->processId);
 }
 
+void Process::AppendOutputTail()
+{
+    if (this->streamOutput)
+    {
+        return;
+    }
+
+    std::string output;
+
+    int ret = 0;
+    if (this->dumpStdout)
+    {
+        ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdOutFile);
+        if (ret == 0)
+        {
+            this->message << "STDOUT: " << output << std::endl;
+        }
+    }
+
+    if (this->stdOutFile != this->stdErrFile)
+    {
+        ret = System::ExecuteCommandOut(output, "head -c 1500", this->stdErrFile);
+        if (ret == 0)
+        {
+            this->message << "STDERR: " << output << std::endl;
+        }
+    }
+}
+
 void Process::Run(const std::string& path)
 {
+    if (this->trackProcessTree) { setsid(); }
+
     if (this->streamOutput)
     {
         // in clusrun case, only monitor stdout, because stderr will be redirected
@@ -459,6 +827,10 @@ void Process::Run(const std::string& path)
     close(this->stdoutPipe[0]);
     close(this->stdoutPipe[1]);
 
+    // only the groups of the resource limits, cgexec in StartTask.sh joins the rest.
+    this->JoinCGroups();
+    this->ApplyMemoryPolicy();
+
     std::vector<char> pathBuffer(path.cbegin(), path.cend());
     pathBuffer.push_back('\0');
 
@@ -486,21 +858,46 @@ void Process::Run(const std::string& path)
 
 std::string Process::GetAffinity()
 {
-    int cores, sockets;
-    System::CPU(cores, sockets);
-
-    std::vector<int> aff;
-    if (!this->affinity.empty() && cores > 0)
+    if (this->cpuSet.size() > 0)
     {
-		int coreId = 0;
-		std::set<int> coreIds;
-		for (uint64_t n : this->affinity)
-		{
-			for (uint64_t mask = 1; mask; mask <<= 1, coreId++)
-			{
-				if (mask & n)
+        return String::Join<','>(this->cpuSet);
+    }
+    else
+    {
+        int cores, sockets;
+        System::CPU(cores, sockets);
+        return String::Join("-", "0", cores - 1);
+    }
+}
+
+std::vector<int> Process::GetAffinityCpus()
+{
+    auto modeIt = this->environments.find("CCP_AFFINITY_MODE");
+    std::string mode = modeIt != this->environments.end() ? modeIt->second : NodeManagerConfig::GetAffinityMode();
+
+    // the scheduler core n is mapped to the n-th logical cpu in the order of the mode.
+    std::vector<int> order = CpuTopology::GetInstance().GetCpuOrder(CpuTopology::ParseAffinityMode(mode));
+    if (order.empty())
+    {
+        int cores, sockets;
+        System::CPU(cores, sockets);
+        for (int i = 0; i < cores; i++) { order.push_back(i); }
+    }
+
+    int cores = order.size();
+
+    std::vector<int> aff;
+    if (!this->affinity.empty() && cores > 0)
+    {
+		int coreId = 0;
+		std::set<int> coreIds;
+		for (uint64_t n : this->affinity)
+		{
+			for (uint64_t mask = 1; mask; mask <<= 1, coreId++)
+			{
+				if (mask & n)
 				{
-					coreIds.insert(coreId % cores);
+					coreIds.insert(order[coreId % cores]);
 				}
 			}
 		}
@@ -508,13 +905,105 @@ std::string Process::GetAffinity()
 		aff.assign(coreIds.begin(), coreIds.end());
     }
 
-    if (aff.size() > 0)
+    return aff;
+}
+
+std::string Process::PrepareMemoryNodes(bool useCgroup)
+{
+    const auto& topology = CpuTopology::GetInstance();
+
+    auto policyIt = this->environments.find("CCP_NUMA_POLICY");
+    std::string policy = policyIt == this->environments.end() ? "local" : boost::algorithm::to_lower_copy(policyIt->second);
+
+    std::set<int> nodes;
+    if (policy != "none" && !this->affinity.empty())
     {
-        return String::Join<','>(aff);
+        nodes = topology.GetNumaNodes(this->cpuSet);
     }
-    else
+
+    if (nodes.empty())
     {
-        return String::Join("-", "0", cores - 1);
+        for (int i = 0; i < topology.GetNumaNodeCount(); i++) { nodes.insert(i); }
+    }
+
+    this->memoryNodes = nodes;
+    this->memoryPolicyMask.clear();
+
+    if (policy == "interleave" && nodes.size() > 1)
+    {
+        const size_t bits = sizeof(unsigned long) * 8;
+        this->memoryPolicyMask.resize(*nodes.rbegin() / bits + 1, 0);
+        for (int n : nodes) { this->memoryPolicyMask[n / bits] |= 1ul << (n % bits); }
+    }
+
+    this->numaStatFile.clear();
+    if (useCgroup && System::IsCGroupInstalled())
+    {
+        auto groupPath = this->cgroup.GetPath("memory");
+        if (!groupPath.empty())
+        {
+            this->numaStatFile = groupPath + "/memory.numa_stat";
+        }
+    }
+
+    auto mems = CpuTopology::ToList(nodes);
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "NUMA policy {0}, mems {1}", policy, mems);
+
+    return mems;
+}
+
+void Process::ApplyMemoryPolicy() const
+{
+    // runs in the forked child, the policy is inherited by sudo and the task.
+    if (!this->memoryPolicyMask.empty())
+    {
+        const int MpolInterleave = 3;
+        syscall(SYS_set_mempolicy, MpolInterleave, this->memoryPolicyMask.data(), this->memoryPolicyMask.size() * sizeof(unsigned long) * 8 + 1);
+    }
+}
+
+void Process::ReadNumaStat()
+{
+    if (this->numaStatFile.empty()) return;
+
+    // v1: the first line is total=<pages> N0=<pages> N1=<pages> ...
+    // v2: anon and file lines are <name> N0=<bytes> N1=<bytes> ...
+    bool unified = this->cgroup.IsUnified("memory");
+    uint64_t pageSize = unified ? sysconf(_SC_PAGESIZE) : 1;
+
+    std::ifstream fs(this->numaStatFile, std::ios::in);
+    std::string line;
+
+    this->statistics.NumaLocalPages = 0;
+    this->statistics.NumaRemotePages = 0;
+
+    while (getline(fs, line))
+    {
+        auto items = String::Split(line, ' ');
+        if (items.empty()) continue;
+
+        bool counted = unified ? (items[0] == "anon" || items[0] == "file") : boost::algorithm::starts_with(items[0], "total=");
+        if (!counted) continue;
+
+        for (const auto& item : items)
+        {
+            if (item.size() < 2 || item[0] != 'N') continue;
+
+            auto kv = String::Split(item.substr(1), '=');
+            if (kv.size() != 2) continue;
+
+            uint64_t pages = String::ConvertTo<uint64_t>(kv[1]) / pageSize;
+            if (this->memoryNodes.count(String::ConvertTo<int>(kv[0])))
+            {
+                this->statistics.NumaLocalPages += pages;
+            }
+            else
+            {
+                this->statistics.NumaRemotePages += pages;
+            }
+        }
+
+        if (!unified) break;
     }
 }
 
@@ -554,10 +1043,7 @@ std::string Process::BuildScript()
     std::string workDirectory = this->workDirectory.empty() ? "~" : this->workDirectory;
     fs << "cd " << workDirectory << " || exit $?" << std::endl << std::endl;
 
-    if (this->stdOutFile.empty()) this->stdOutFile = this->taskFolder + "/stdout.txt";
-    else if (!boost::algorithm::starts_with(this->stdOutFile, "/") && !StartWithHttpOrHttps(this->stdOutFile)) this->stdOutFile = workDirectory + "/" + this->stdOutFile;
-    if (this->stdErrFile.empty()) this->stdErrFile = this->taskFolder + "/stderr.txt";
-    else if (!boost::algorithm::starts_with(this->stdErrFile, "/") && !StartWithHttpOrHttps(this->stdErrFile)) this->stdErrFile = workDirectory + "/" + this->stdErrFile;
+    this->ResolveOutputFiles(workDirectory);
 
     // before
     fs << "echo before >" << this->taskFolder << "/before1.txt 2>" << this->taskFolder << "/before2.txt";
@@ -601,6 +1087,516 @@ std::string Process::BuildScript()
     return std::move(runDirInOut);
 }
 
+void Process::ResolveOutputFiles(const std::string& workDir)
+{
+    if (this->stdOutFile.empty()) this->stdOutFile = this->taskFolder + "/stdout.txt";
+    else if (!boost::algorithm::starts_with(this->stdOutFile, "/") && !StartWithHttpOrHttps(this->stdOutFile)) this->stdOutFile = workDir + "/" + this->stdOutFile;
+    if (this->stdErrFile.empty()) this->stdErrFile = this->taskFolder + "/stderr.txt";
+    else if (!boost::algorithm::starts_with(this->stdErrFile, "/") && !StartWithHttpOrHttps(this->stdErrFile)) this->stdErrFile = workDir + "/" + this->stdErrFile;
+}
+
+std::string Process::ExpandHomeDir(const std::string& path) const
+{
+    if (path == "~" || boost::algorithm::starts_with(path, "~/"))
+    {
+        return this->homeDirectory + path.substr(1);
+    }
+
+    return path;
+}
+
+bool Process::CanDirectExec() const
+{
+    // Paths which need expansion by bash (variables, globs, quotes, ~user)
+    // still go through run_dir_in_out.sh to keep the same semantics.
+    auto isPlain = [](const std::string& path)
+    {
+        for (size_t i = 0; i < path.size(); i++)
+        {
+            char c = path[i];
+            if (std::isalnum(c) || std::strchr("/._-+,:@%=", c) != nullptr) continue;
+            if (c == '~' && i == 0 && (path.size() == 1 || path[1] == '/')) continue;
+            return false;
+        }
+
+        return true;
+    };
+
+    return
+        isPlain(this->workDirectory) &&
+        (this->streamOutput || isPlain(this->stdOutFile)) &&
+        isPlain(this->stdErrFile) &&
+        isPlain(this->stdInFile);
+}
+
+bool Process::PrepareDirectExec(bool useCgroup)
+{
+    struct passwd pwd;
+    struct passwd* result = nullptr;
+    std::vector<char> buffer(16384);
+    int ret = getpwnam_r(this->userName.c_str(), &pwd, &buffer[0], buffer.size(), &result);
+    if (ret != 0 || result == nullptr)
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Cannot find user {0}, ret {1}, fall back to script launch", this->userName, ret);
+        return false;
+    }
+
+    this->userId = pwd.pw_uid;
+    this->groupId = pwd.pw_gid;
+    this->homeDirectory = pwd.pw_dir;
+
+    int groupCount = 64;
+    this->userGroups.resize(groupCount);
+    if (getgrouplist(pwd.pw_name, pwd.pw_gid, &this->userGroups[0], &groupCount) == -1)
+    {
+        this->userGroups.resize(groupCount);
+        getgrouplist(pwd.pw_name, pwd.pw_gid, &this->userGroups[0], &groupCount);
+    }
+
+    this->userGroups.resize(groupCount);
+
+    this->runDirectory = this->workDirectory.empty() ? this->homeDirectory : this->ExpandHomeDir(this->workDirectory);
+    this->ResolveOutputFiles(this->runDirectory);
+
+    if (useCgroup && System::IsCGroupInstalled())
+    {
+        for (auto subsystem : CGroupSubSystems)
+        {
+            auto procsFile = this->cgroup.GetProcsFile(subsystem);
+            if (procsFile.empty())
+            {
+                Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Cannot find cgroup subsystem {0}, fall back to script launch", subsystem);
+                return false;
+            }
+
+            this->AddCGroupToJoin(procsFile);
+        }
+    }
+
+    // WaitForTrust.sh only does something when the task spans more than one node.
+    auto nodesIt = this->environments.find("CCP_NODES");
+    this->testMutualTrust = nodesIt != this->environments.end() && String::Split(String::Trim(nodesIt->second), ' ').size() >= 4;
+    if (this->testMutualTrust)
+    {
+        if (0 != this->ExecuteCommand("cp", "TestMutualTrust.sh", "WaitForTrust.sh", this->taskFolder))
+        {
+            return false;
+        }
+
+        this->trustArgs = { "/bin/bash", this->taskFolder + "/TestMutualTrust.sh", this->taskExecutionId, this->taskFolder, this->userName };
+    }
+
+    // the same hostfile as StartTask.sh generates for the MPI applications.
+    std::string hostFile = this->taskFolder + "/mpi_hostfile";
+    if (0 != this->WriteMpiHostFile(hostFile))
+    {
+        Logger::Warn(this->jobId, this->taskId, this->requeueCount, "Cannot write {0}, fall back to script launch", hostFile);
+        return false;
+    }
+
+    this->mpiHostFile = hostFile;
+
+    auto pathIt = this->environments.find("PATH");
+    const char* currentPath = getenv("PATH");
+    std::string path = pathIt != this->environments.end() ? pathIt->second : (currentPath ? currentPath : "");
+
+    // the exit code is read from the file when the task is adopted by a restarted node manager,
+    // the same trap as StartTask.sh sets.
+    std::string script = "trap 'echo $? > " + this->taskFolder + "/exit_code' EXIT\n" + this->commandLine;
+
+    auto switchUserIt = this->environments.find("CCP_SWITCH_USER");
+    if (switchUserIt != this->environments.end() && switchUserIt->second == "1")
+    {
+        this->execArgs = { "su", this->userName, "-m", "-s", "/bin/bash", "-c", script };
+    }
+    else
+    {
+        this->execArgs = { "sudo", "-H", "-E", "-u", this->userName, "env", "PATH=" + path, "/bin/bash", "-c", script };
+    }
+
+    auto toArgv = [](const std::vector<std::string>& args, std::vector<char*>& argv)
+    {
+        argv.clear();
+        for (const auto& a : args) { argv.push_back(const_cast<char*>(a.c_str())); }
+        argv.push_back(nullptr);
+    };
+
+    toArgv(this->execArgs, this->execArgv);
+    toArgv(this->trustArgs, this->trustArgv);
+    this->execEnvironment = this->PrepareEnvironment();
+
+    Logger::Debug(this->jobId, this->taskId, this->requeueCount, "Direct exec in {0}, stdout {1}, stderr {2}, cgroups {3}",
+        this->runDirectory, this->stdOutFile, this->stdErrFile, this->cgroupTasksFiles.size());
+
+    return true;
+}
+
+int Process::WriteMpiHostFile(const std::string& fileName) const
+{
+    // CCP_NODES_CORES is the node count followed by the node name and core count pairs.
+    std::vector<std::string> tokens;
+    auto nodesCoresIt = this->environments.find("CCP_NODES_CORES");
+    if (nodesCoresIt != this->environments.end())
+    {
+        for (auto& t : String::Split(nodesCoresIt->second, ' '))
+        {
+            if (!t.empty()) { tokens.push_back(t); }
+        }
+    }
+
+    auto formatIt = this->environments.find("CCP_MPI_HOSTFILE_FORMAT");
+    std::string format = formatIt != this->environments.end() ? formatIt->second : "";
+
+    // 1 for Intel MPI, 2 for Open MPI, 3 for MPICH, otherwise the node names only.
+    std::string separator =
+        format == "1" ? ":" :
+        format == "2" ? " slots=" :
+        format == "3" ? " " : "";
+
+    std::ostringstream hostFile;
+    for (size_t i = 1; i < tokens.size(); i += 2)
+    {
+        hostFile << tokens[i];
+        if (!separator.empty() && i + 1 < tokens.size())
+        {
+            hostFile << separator << tokens[i + 1];
+        }
+
+        hostFile << std::endl;
+    }
+
+    return System::WriteStringToFile(fileName, hostFile.str());
+}
+
+namespace
+{
+    // Only async-signal-safe calls, these run in the forked child.
+    void WriteChildError(const char* what, const std::string& target, int err)
+    {
+        const char* reason = strerror(err);
+        for (const char* part : { what, " ", target.c_str(), ": ", reason, "\n" })
+        {
+            ssize_t written = write(2, part, strlen(part));
+            (void)written;
+        }
+    }
+
+    int OpenAsFd(const std::string& file, int flags, int fd)
+    {
+        int opened = open(file.c_str(), flags, 0666);
+        if (opened < 0) return -1;
+        if (opened != fd)
+        {
+            dup2(opened, fd);
+            close(opened);
+        }
+
+        return fd;
+    }
+}
+
+void Process::JoinCGroups() const
+{
+    for (const auto& procsFile : this->cgroupTasksFiles)
+    {
+        int fd = open(procsFile.c_str(), O_WRONLY);
+        if (fd < 0 || write(fd, "0", 1) != 1)
+        {
+            int err = errno;
+            WriteChildError("Failed to join cgroup", procsFile, err);
+            _exit(err);
+        }
+
+        close(fd);
+    }
+}
+
+void Process::AddCGroupToJoin(const std::string& procsFile)
+{
+    if (std::find(this->cgroupTasksFiles.cbegin(), this->cgroupTasksFiles.cend(), procsFile) == this->cgroupTasksFiles.cend())
+    {
+        this->cgroupTasksFiles.push_back(procsFile);
+    }
+}
+
+int Process::ApplyResourceLimits()
+{
+    auto env = [this](const char* name)
+    {
+        auto it = this->environments.find(name);
+        return it == this->environments.end() ? std::string() : String::Trim(it->second);
+    };
+
+    // controller, v1 file, v2 file, value
+    std::vector<std::tuple<std::string, std::string, std::string, std::string>> knobs;
+
+    auto memoryLimitMb = env("CCP_MEMORY_LIMIT_MB");
+    if (!memoryLimitMb.empty())
+    {
+        auto bytes = std::to_string(String::ConvertTo<uint64_t>(memoryLimitMb) * 1024 * 1024);
+        knobs.emplace_back("memory", "memory.limit_in_bytes", "memory.max", bytes);
+    }
+
+    auto memoryHighMb = env("CCP_MEMORY_HIGH_MB");
+    if (!memoryHighMb.empty())
+    {
+        auto bytes = std::to_string(String::ConvertTo<uint64_t>(memoryHighMb) * 1024 * 1024);
+        knobs.emplace_back("memory", "memory.soft_limit_in_bytes", "memory.high", bytes);
+    }
+
+    auto pidsMax = env("CCP_PIDS_MAX");
+    if (!pidsMax.empty())
+    {
+        knobs.emplace_back("pids", "pids.max", "pids.max", pidsMax);
+    }
+
+    auto cpuQuotaPercent = env("CCP_CPU_QUOTA_PERCENT");
+    if (!cpuQuotaPercent.empty())
+    {
+        // 100 percent is one cpu in a 100ms period.
+        const int period = 100000;
+        auto quota = std::to_string(String::ConvertTo<uint64_t>(cpuQuotaPercent) * period / 100);
+        if (this->cgroup.IsUnified("cpu"))
+        {
+            knobs.emplace_back("cpu", "", "cpu.max", String::Join(" ", quota, period));
+        }
+        else
+        {
+            knobs.emplace_back("cpu", "cpu.cfs_period_us", "", std::to_string(period));
+            knobs.emplace_back("cpu", "cpu.cfs_quota_us", "", quota);
+        }
+    }
+
+    auto ioWeight = env("CCP_IO_WEIGHT");
+    if (!ioWeight.empty())
+    {
+        // 1-10000 on v2, blkio.weight only takes 10-1000.
+        int weight = String::ConvertTo<int>(ioWeight);
+        knobs.emplace_back("io", "", "io.weight", String::Join(" ", "default", weight));
+        knobs.emplace_back("blkio", "blkio.weight", "", std::to_string(std::min(std::max(weight, 10), 1000)));
+    }
+
+    // io.max syntax, devices separated by ';', e.g. "8:0 rbps=1048576 wbps=1048576"
+    for (const auto& device : String::Split(env("CCP_IO_MAX"), ';'))
+    {
+        auto items = String::Split(String::Trim(device), ' ');
+        if (items.size() < 2) continue;
+
+        knobs.emplace_back("io", "", "io.max", String::Trim(device));
+
+        std::map<std::string, std::string> v1Files =
+        {
+            { "rbps", "blkio.throttle.read_bps_device" },
+            { "wbps", "blkio.throttle.write_bps_device" },
+            { "riops", "blkio.throttle.read_iops_device" },
+            { "wiops", "blkio.throttle.write_iops_device" },
+        };
+
+        for (size_t i = 1; i < items.size(); i++)
+        {
+            auto kv = String::Split(items[i], '=');
+            auto file = kv.size() == 2 ? v1Files.find(kv[0]) : v1Files.end();
+            if (file != v1Files.end())
+            {
+                knobs.emplace_back("blkio", file->second, "", String::Join(" ", items[0], kv[1]));
+            }
+        }
+    }
+
+    std::set<std::string> groupPaths;
+    for (auto subsystem : CGroupSubSystems) { groupPaths.insert(this->cgroup.GetPath(subsystem)); }
+
+    for (const auto& knob : knobs)
+    {
+        const auto& controller = std::get<0>(knob);
+        bool unified = false;
+        if (CGroup::GetMountPoint(controller, &unified).empty()) continue;
+
+        const auto& file = unified ? std::get<2>(knob) : std::get<1>(knob);
+        if (file.empty()) continue;
+
+        // hierarchies other than the ones created by PrepareTask.sh.
+        auto groupPath = this->cgroup.GetPath(controller);
+        if (groupPaths.find(groupPath) == groupPaths.end())
+        {
+            int ret = this->cgroup.Create(controller);
+            if (ret != 0) return ret;
+
+            groupPaths.insert(groupPath);
+            this->extraCGroups.push_back(controller);
+            this->AddCGroupToJoin(this->cgroup.GetProcsFile(controller));
+        }
+
+        int ret = this->cgroup.Write(controller, file, std::get<3>(knob));
+        if (ret != 0) return ret;
+
+        Logger::Info(this->jobId, this->taskId, this->requeueCount, "Set {0}/{1} to {2}", groupPath, file, std::get<3>(knob));
+    }
+
+    // the v1 blkio hierarchy is joined for the I/O accounting even without a limit.
+    bool blkioUnified = false;
+    if (!CGroup::GetMountPoint("blkio", &blkioUnified).empty() && !blkioUnified &&
+        groupPaths.find(this->cgroup.GetPath("blkio")) == groupPaths.end())
+    {
+        if (this->cgroup.Create("blkio") == 0)
+        {
+            this->extraCGroups.push_back("blkio");
+            this->AddCGroupToJoin(this->cgroup.GetProcsFile("blkio"));
+        }
+    }
+
+    return 0;
+}
+
+void Process::ReadLimitCounters()
+{
+    std::string content;
+    WriterLock writerLock(&this->lock);
+
+    // oom_kill is in memory.events on v2 and memory.oom_control on v1.
+    bool unified = this->cgroup.IsUnified("memory");
+    if (this->cgroup.Read("memory", unified ? "memory.events" : "memory.oom_control", content))
+    {
+        this->statistics.OomKillCount = CGroup::ReadKey(content, "oom_kill");
+    }
+
+    if (this->cgroup.Read("cpu", "cpu.stat", content))
+    {
+        this->statistics.ThrottledCount = CGroup::ReadKey(content, "nr_throttled");
+    }
+
+    if (this->statistics.OomKillCount > 0)
+    {
+        this->message << "Task " << this->taskId << ": " << this->statistics.OomKillCount << " process(es) killed by the OOM killer." << std::endl;
+    }
+
+    if (this->statistics.ThrottledCount > 0)
+    {
+        this->message << "Task " << this->taskId << ": cpu throttled in " << this->statistics.ThrottledCount << " period(s)." << std::endl;
+    }
+}
+
+void Process::RunDirect()
+{
+    // a new session, so that the processes reparented to init can be found by the session id.
+    if (this->trackProcessTree) { setsid(); }
+
+    if (this->streamOutput)
+    {
+        dup2(this->stdoutPipe[1], 1);
+    }
+    else
+    {
+        dup2(this->stdoutPipe[1], 2);
+    }
+
+    close(this->stdoutPipe[0]);
+    close(this->stdoutPipe[1]);
+
+    // equivalent of cgexec -g cpuacct,cpuset,memory,freezer:nmgroup_<id>
+    this->JoinCGroups();
+    this->ApplyMemoryPolicy();
+
+    auto envi = const_cast<char* const*>(this->execEnvironment.get());
+
+    if (this->testMutualTrust)
+    {
+        pid_t trustPid = fork();
+        if (trustPid == 0)
+        {
+            execve(this->trustArgv[0], &this->trustArgv[0], envi);
+            _exit(errno);
+        }
+
+        int status = 0;
+        if (trustPid < 0 || waitpid(trustPid, &status, 0) != trustPid)
+        {
+            int err = errno;
+            WriteChildError("Failed to run", this->trustArgs[1], err);
+            _exit(err);
+        }
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+        }
+
+        if (this->execPipe[1] != -1)
+        {
+            ssize_t written = write(this->execPipe[1], "T", 1);
+            (void)written;
+        }
+    }
+
+    // Do the file system work as the task user, so the permission checks and
+    // the owner of the created output files are the same as the script launch.
+    bool switchUser = this->userId != 0;
+    if (switchUser &&
+        (setgroups(this->userGroups.size(), this->userGroups.data()) != 0 ||
+         setegid(this->groupId) != 0 ||
+         seteuid(this->userId) != 0))
+    {
+        int err = errno;
+        WriteChildError("Failed to switch to user", this->userName, err);
+        _exit(err);
+    }
+
+    if (chdir(this->runDirectory.c_str()) != 0)
+    {
+        WriteChildError("cd:", this->runDirectory, errno);
+        _exit(1);
+    }
+
+    // the 'before' probe of run_dir_in_out.sh, 253 makes the ForkThread retry.
+    if (faccessat(AT_FDCWD, this->taskFolder.c_str(), W_OK | X_OK, AT_EACCESS) != 0)
+    {
+        WriteChildError("Task folder not writable", this->taskFolder, errno);
+        _exit(253);
+    }
+
+    const int outFlags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (this->streamOutput)
+    {
+        dup2(1, 2);
+    }
+    else
+    {
+        if (OpenAsFd(this->stdOutFile, outFlags, 1) < 0)
+        {
+            WriteChildError("Cannot open", this->stdOutFile, errno);
+            _exit(1);
+        }
+
+        if (this->stdOutFile == this->stdErrFile)
+        {
+            dup2(1, 2);
+        }
+        else if (OpenAsFd(this->stdErrFile, outFlags, 2) < 0)
+        {
+            WriteChildError("Cannot open", this->stdErrFile, errno);
+            _exit(1);
+        }
+    }
+
+    if (!this->stdInFile.empty() && OpenAsFd(this->stdInFile, O_RDONLY, 0) < 0)
+    {
+        WriteChildError("Cannot open", this->stdInFile, errno);
+        _exit(1);
+    }
+
+    if (switchUser && (seteuid(0) != 0 || setegid(0) != 0))
+    {
+        int err = errno;
+        WriteChildError("Failed to switch back from user", this->userName, err);
+        _exit(err);
+    }
+
+    execvpe(this->execArgv[0], &this->execArgv[0], envi);
+
+    WriteChildError("Failed to exec", this->execArgs[0], errno);
+    _exit(errno);
+}
+
 std::unique_ptr<const char* []> Process::PrepareEnvironment()
 {
     this->environmentsBuffer.clear();
@@ -619,7 +1615,19 @@ std::unique_ptr<const char* []> Process::PrepareEnvironment()
         std::back_inserter(this->environmentsBuffer),
         [](const auto& v) { return String::Join("=", v.first, v.second); });
 
-    auto envi = std::unique_ptr<const char* []>(new const char*[this->environments.size() + 1]);
+    if (!this->mpiHostFile.empty())
+    {
+        // overrides the one from the head node, as StartTask.sh does.
+        this->environmentsBuffer.erase(
+            std::remove_if(
+                this->environmentsBuffer.begin(),
+                this->environmentsBuffer.end(),
+                [](const auto& e) { return e.compare(0, 17, "CCP_MPI_HOSTFILE=") == 0; }),
+            this->environmentsBuffer.end());
+        this->environmentsBuffer.push_back(std::string("CCP_MPI_HOSTFILE=") + this->mpiHostFile);
+    }
+
+    auto envi = std::unique_ptr<const char* []>(new const char*[this->environmentsBuffer.size() + 1]);
     int p = 0;
     for_each(
         this->environmentsBuffer.cbegin(),
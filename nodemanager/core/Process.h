@@ -5,6 +5,7 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <set>
 #include <memory>
 #include <unistd.h>
 #include <sys/signal.h>
@@ -16,8 +17,14 @@
 #include "../utils/String.h"
 #include "../utils/Logger.h"
 #include "../utils/System.h"
+#include "../utils/CGroup.h"
+#include "../utils/JsonWriter.h"
+#include "../utils/JsonReader.h"
 #include "../common/ErrorCodes.h"
 #include "../data/ProcessStatistics.h"
+#include "../data/TaskTrace.h"
+#include "TaskTracer.h"
+#include "CGroupStatsReader.h"
 
 using namespace hpc::utils;
 
@@ -38,11 +45,11 @@ namespace hpc
                     int taskId,
                     int requeueCount,
                     const std::string& taskExecutionName,
-                    const std::string& cmdLine,
-                    const std::string& standardOut,
-                    const std::string& standardErr,
-                    const std::string& standardIn,
-                    const std::string& workDir,
+                    std::string cmdLine,
+                    std::string standardOut,
+                    std::string standardErr,
+                    std::string standardIn,
+                    std::string workDir,
                     const std::string& user,
                     bool dumpStdoutToExecutionMessage,
                     std::vector<uint64_t>&& cpuAffinity,
@@ -54,10 +61,27 @@ namespace hpc
                 virtual ~Process();
 
                 pplx::task<std::pair<pid_t, pthread_t>> Start(std::shared_ptr<Process> self);
+
+                /// The state needed to adopt the started process after an agent restart.
+                void WriteState(hpc::utils::JsonWriter& writer) const;
+                void ReadState(hpc::utils::JsonReader& reader);
+
+                /// Takes over the process restored by ReadState, it completes when the process exits,
+                /// or right away when it has exited already, with the exit code StartTask.sh left.
+                /// A task which cannot be adopted is terminated and completed with TaskAdoptionError.
+                pplx::task<std::pair<pid_t, pthread_t>> Adopt(std::shared_ptr<Process> self);
+                bool IsAlive() const;
                 void Kill(int forcedExitCode = 0x0FFFFFFF, bool forced = true);
-                const hpc::data::ProcessStatistics& GetStatisticsFromCGroup();
 
-                static void Cleanup();
+                /// Waits until no process of the task is left, false when the timeout elapses.
+                bool WaitForExit(int timeoutMs);
+                hpc::data::ProcessStatistics GetStatisticsFromCGroup();
+
+                /// Cleans up the tasks left by the previous agent, except the adopted ones.
+                static void Cleanup(const std::vector<std::string>& keptTaskExecutionIds = std::vector<std::string>());
+
+                const std::string& GetTaskExecutionId() const { return this->taskExecutionId; }
+                const std::string& GetUserName() const { return this->userName; }
 
                 pplx::task<void> OnCompleted();
 
@@ -69,6 +93,9 @@ namespace hpc
 
                 std::string PeekOutput();
 
+                // the logical cpus the task is bound to, empty when no affinity is specified.
+                const std::vector<int>& GetCpuSet() const { return this->cpuSet; }
+
             protected:
             private:
                 static bool StartWithHttpOrHttps(const std::string& path)
@@ -76,6 +103,11 @@ namespace hpc
                     return boost::algorithm::starts_with(path, "http://") || boost::algorithm::starts_with(path, "https://");
                 }
 
+                void Trace(hpc::data::TracePhase phase) const
+                {
+                    if (this->traceStartup) { TaskTracer::Mark(this->jobId, this->taskId, this->requeueCount, phase); }
+                }
+
                 void SetExitCode(int exitCode)
                 {
                     this->exitCode = exitCode;
@@ -117,13 +149,42 @@ namespace hpc
                 }
 
                 static void* ForkThread(void*);
+                static void* AdoptThread(void*);
+
+                // the output of a streaming task goes to a pipe of the previous agent,
+                // and a docker task is left to its container.
+                bool CanAdopt() const { return !this->streamOutput && !this->dockerTask; }
+                void WaitAdopted();
+                int Finalize();
+                void Complete();
+
+                static const std::vector<std::string> CGroupSubSystems;
+                static const int FreezeTimeoutMs = 2000;
+                static const int AdoptPollIntervalMs = 1000;
+                static const size_t PipeBufferSize = 64 * 1024;
 
                 std::string GetAffinity();
+                std::vector<int> GetAffinityCpus();
+                std::string PrepareMemoryNodes(bool useCgroup);
+                void ApplyMemoryPolicy() const;
+                void ReadNumaStat();
+                std::string GetTaskGroupName() const;
+                void Terminate(bool forced);
+                int ApplyResourceLimits();
+                void ReadLimitCounters();
+                void AddCGroupToJoin(const std::string& procsFile);
+                void JoinCGroups() const;
 
                 void Run(const std::string& path);
+                bool CanDirectExec() const;
+                bool PrepareDirectExec(bool useCgroup);
+                void RunDirect();
+                void ResolveOutputFiles(const std::string& workDir);
+                std::string ExpandHomeDir(const std::string& path) const;
+                int WriteMpiHostFile(const std::string& fileName) const;
                 static void* ReadPipeThread(void* p);
-                void SendbackOutput(const std::string& uri, const std::string& output, int order) const;
                 void Monitor();
+                void AppendOutputTail();
                 std::string BuildScript();
                 std::unique_ptr<const char* []> PrepareEnvironment();
                 void OnCompletedInternal();
@@ -135,6 +196,7 @@ namespace hpc
                 bool exitCodeSet = false;
 
                 hpc::data::ProcessStatistics statistics;
+                std::unique_ptr<CGroupStatsReader> statsReader;
 
                 std::string taskFolder;
 
@@ -142,6 +204,7 @@ namespace hpc
                 const int taskId;
                 const int requeueCount;
                 const std::string taskExecutionId;
+                const hpc::utils::CGroup cgroup;
                 const std::string commandLine;
                 std::string stdOutFile;
                 std::string stdErrFile;
@@ -150,10 +213,40 @@ namespace hpc
                 const std::string userName;
                 bool dumpStdout = false;
                 const std::vector<uint64_t> affinity;
+                std::vector<int> cpuSet;
                 const std::map<std::string, std::string> environments;
                 std::vector<std::string> environmentsBuffer;
+                bool dockerTask = false;
+                bool cgroupDisabled = false;
+                // cgroup-less tasks are tracked by the /proc process tree.
+                bool trackProcessTree = false;
                 bool streamOutput = false;
+                bool traceStartup = false;
                 int stdoutPipe[2];
+                // close-on-exec, the child writes 'T' after the mutual trust check, EOF means exec.
+                int execPipe[2] = { -1, -1 };
+
+                // direct exec launch, prepared in the parent so that the forked child
+                // only does chdir, open, dup2 and exec.
+                bool directExec = false;
+                bool testMutualTrust = false;
+                uid_t userId = 0;
+                gid_t groupId = 0;
+                std::vector<gid_t> userGroups;
+                std::string homeDirectory;
+                std::string runDirectory;
+                std::vector<std::string> cgroupTasksFiles;
+                std::vector<std::string> extraCGroups;
+                std::vector<std::string> execArgs;
+                std::vector<std::string> trustArgs;
+                std::string mpiHostFile;
+                std::vector<char*> execArgv;
+                std::vector<char*> trustArgv;
+                std::unique_ptr<const char* []> execEnvironment;
+
+                std::set<int> memoryNodes;
+                std::vector<unsigned long> memoryPolicyMask;
+                std::string numaStatFile;
 
                 const std::function<Callback> callback;
 
@@ -162,6 +255,7 @@ namespace hpc
                 pthread_t threadId = 0;
                 pthread_t outputThreadId = 0;
                 pid_t processId;
+                uint64_t processStartTime = 0;
                 bool ended = false;
 
                 pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
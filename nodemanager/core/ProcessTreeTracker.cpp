@@ -0,0 +1,337 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <chrono>
+#include <set>
+#include <algorithm>
+#include <cstring>
+
+#include "ProcessTreeTracker.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::data;
+
+ProcessTreeTracker& ProcessTreeTracker::GetInstance()
+{
+    static ProcessTreeTracker instance;
+    return instance;
+}
+
+ProcessTreeTracker::ProcessTreeTracker() : buffer(1024)
+{
+    int result = pthread_create(&this->threadId, nullptr, ScanningThread, this);
+    if (result != 0)
+    {
+        Logger::Error("Create process tree scanning thread result {0}, errno {1}", result, errno);
+        this->threadId = 0;
+    }
+}
+
+ProcessTreeTracker::~ProcessTreeTracker()
+{
+    this->isRunning = false;
+    if (this->threadId != 0)
+    {
+        pthread_join(this->threadId, nullptr);
+    }
+}
+
+void ProcessTreeTracker::Track(const std::string& key, pid_t rootPid)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    TaskTree tree;
+    tree.Root = rootPid;
+
+    ProcStat stat;
+    tree.RootStartTime = this->ReadProcStat(rootPid, stat) ? stat.StartTime : 0;
+    tree.Members[rootPid] = tree.RootStartTime;
+
+    this->tasks[key] = std::move(tree);
+}
+
+void ProcessTreeTracker::Untrack(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->tasks.erase(key);
+}
+
+bool ProcessTreeTracker::GetStatistics(const std::string& key, ProcessStatistics& stat)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto it = this->tasks.find(key);
+    if (it == this->tasks.end()) return false;
+
+    stat.UserTimeMs = it->second.Stat.UserTimeMs;
+    stat.KernelTimeMs = it->second.Stat.KernelTimeMs;
+    stat.WorkingSetKb = it->second.Stat.WorkingSetKb;
+    stat.RssKb = it->second.Stat.RssKb;
+    stat.ProcessIds = it->second.Stat.ProcessIds;
+
+    return true;
+}
+
+int ProcessTreeTracker::Kill(const std::string& key, int sig)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto it = this->tasks.find(key);
+    if (it == this->tasks.end()) return ESRCH;
+
+    // SIGSTOP the tree and rescan until it stops growing, the same as freezing a cgroup.
+    std::set<pid_t> stopped;
+    const int MaxRounds = 5;
+    for (int round = 0; round < MaxRounds; round++)
+    {
+        this->Scan();
+
+        bool found = false;
+        for (pid_t pid : it->second.Stat.ProcessIds)
+        {
+            if (stopped.insert(pid).second)
+            {
+                kill(pid, SIGSTOP);
+                found = true;
+            }
+        }
+
+        if (!found) break;
+    }
+
+    for (pid_t pid : stopped)
+    {
+        if (kill(pid, sig) != 0 && errno != ESRCH)
+        {
+            Logger::Warn("Failed to send signal {0} to {1} of {2}, errno {3}", sig, pid, key, errno);
+        }
+
+        if (sig != SIGKILL)
+        {
+            kill(pid, SIGCONT);
+        }
+    }
+
+    Logger::Info("Sent signal {0} to {1} processes of {2}", sig, stopped.size(), key);
+
+    return 0;
+}
+
+bool ProcessTreeTracker::WaitEmpty(const std::string& key, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    int intervalMs = 1;
+
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+
+            auto it = this->tasks.find(key);
+            if (it == this->tasks.end()) return true;
+
+            this->Scan();
+            if (it->second.Stat.ProcessIds.empty()) return true;
+        }
+
+        int remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remainingMs <= 0) return false;
+
+        usleep(std::min(intervalMs, remainingMs) * 1000);
+        intervalMs = std::min(intervalMs * 2, 50);
+    }
+}
+
+void* ProcessTreeTracker::ScanningThread(void* arg)
+{
+    ProcessTreeTracker* const t = static_cast<ProcessTreeTracker* const>(arg);
+
+    while (t->isRunning)
+    {
+        {
+            std::lock_guard<std::mutex> guard(t->lock);
+            if (!t->tasks.empty())
+            {
+                t->Scan();
+            }
+        }
+
+        for (int i = 0; i < ScanIntervalSeconds && t->isRunning; i++)
+        {
+            sleep(1);
+        }
+    }
+
+    return nullptr;
+}
+
+bool ProcessTreeTracker::ReadProcStat(pid_t pid, ProcStat& stat)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    ssize_t len = read(fd, &this->buffer[0], this->buffer.size() - 1);
+    close(fd);
+    if (len <= 0) return false;
+
+    this->buffer[len] = '\0';
+
+    // pid (comm) state ppid pgrp session ..., the comm may have spaces and parentheses.
+    const char* p = strrchr(&this->buffer[0], ')');
+    if (p == nullptr) return false;
+
+    char state;
+    int ppid, pgrp, session;
+    unsigned long utime, stime;
+    long cutime, cstime, rss;
+    unsigned long long starttime;
+
+    int count = sscanf(p + 2,
+        "%c %d %d %d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld %*d %*d %*d %*d %llu %*u %ld",
+        &state, &ppid, &pgrp, &session, &utime, &stime, &cutime, &cstime, &starttime, &rss);
+    if (count != 10) return false;
+
+    stat.Pid = pid;
+    stat.ParentPid = ppid;
+    stat.Session = session;
+    stat.UserTicks = utime;
+    stat.SystemTicks = stime;
+    stat.ChildrenUserTicks = cutime;
+    stat.ChildrenSystemTicks = cstime;
+    stat.StartTime = starttime;
+    stat.RssPages = rss;
+    stat.Zombie = state == 'Z';
+
+    return true;
+}
+
+void ProcessTreeTracker::Scan()
+{
+    this->processes.clear();
+
+    DIR* dir = opendir("/proc");
+    if (dir == nullptr)
+    {
+        Logger::Error("Failed to open /proc, errno {0}", errno);
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        char* end;
+        pid_t pid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0) continue;
+
+        // zombies are already dead, waiting to be reaped.
+        ProcStat stat;
+        if (this->ReadProcStat(pid, stat) && !stat.Zombie)
+        {
+            this->processes.push_back(stat);
+        }
+    }
+
+    closedir(dir);
+
+    // the live roots, a root pid reused by another process is not a root any more.
+    std::map<pid_t, TaskTree*> roots;
+    std::map<pid_t, ProcStat*> byPid;
+    for (auto& p : this->processes) { byPid[p.Pid] = &p; }
+
+    for (auto& t : this->tasks)
+    {
+        auto root = byPid.find(t.second.Root);
+        if (root != byPid.end() && (t.second.RootStartTime == 0 || root->second->StartTime == t.second.RootStartTime))
+        {
+            roots[t.second.Root] = &t.second;
+        }
+    }
+
+    // link every process to its parent, stopping at the task roots, init and kthreadd.
+    this->trees.Clear();
+    this->trees.Reserve(this->processes.size());
+    for (const auto& p : this->processes)
+    {
+        if (p.ParentPid > 2 && roots.find(p.Pid) == roots.end())
+        {
+            this->trees.AddPair(p.Pid, p.ParentPid);
+        }
+    }
+
+    std::map<TaskTree*, std::vector<const ProcStat*>> members;
+    for (const auto& p : this->processes)
+    {
+        TaskTree* owner = nullptr;
+
+        auto top = roots.find(this->trees.FindParent(p.Pid));
+        if (top != roots.end())
+        {
+            owner = top->second;
+        }
+        else
+        {
+            for (auto& t : this->tasks)
+            {
+                auto member = t.second.Members.find(p.Pid);
+                bool known = member != t.second.Members.end() && member->second == p.StartTime;
+                bool inSession = p.Session == t.second.Root && p.StartTime >= t.second.RootStartTime;
+                if (known || inSession)
+                {
+                    owner = &t.second;
+                    break;
+                }
+            }
+        }
+
+        if (owner != nullptr)
+        {
+            members[owner].push_back(&p);
+        }
+    }
+
+    static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    static const long pageSizeKb = sysconf(_SC_PAGESIZE) / 1024;
+
+    for (auto& t : this->tasks)
+    {
+        auto& tree = t.second;
+        const auto& live = members[&tree];
+
+        // the cpu time of the members gone since the last scan is lost,
+        // except the children the task process waited for.
+        std::map<pid_t, uint64_t> current;
+        uint64_t userTicks = 0, systemTicks = 0, rssPages = 0;
+        tree.Stat.ProcessIds.clear();
+
+        for (const auto* p : live)
+        {
+            current[p->Pid] = p->StartTime;
+            userTicks += p->UserTicks;
+            systemTicks += p->SystemTicks;
+            rssPages += p->RssPages;
+            tree.Stat.ProcessIds.push_back(p->Pid);
+
+            if (p->Pid == tree.Root)
+            {
+                tree.ReapedUserTicks = p->ChildrenUserTicks;
+                tree.ReapedSystemTicks = p->ChildrenSystemTicks;
+            }
+        }
+
+        tree.Members = std::move(current);
+        tree.PeakRssPages = std::max(tree.PeakRssPages, rssPages);
+
+        // never goes back when a member exits.
+        tree.Stat.UserTimeMs = std::max<uint64_t>(tree.Stat.UserTimeMs, (userTicks + tree.ReapedUserTicks) * 1000 / ticksPerSecond);
+        tree.Stat.KernelTimeMs = std::max<uint64_t>(tree.Stat.KernelTimeMs, (systemTicks + tree.ReapedSystemTicks) * 1000 / ticksPerSecond);
+
+        tree.Stat.RssKb = rssPages * pageSizeKb;
+        tree.Stat.WorkingSetKb = tree.PeakRssPages * pageSizeKb;
+    }
+}
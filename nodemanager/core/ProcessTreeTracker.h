@@ -0,0 +1,96 @@
+#ifndef PROCESSTREETRACKER_H
+#define PROCESSTREETRACKER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "../utils/UnionFindSet.h"
+#include "../data/ProcessStatistics.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Tracks the process trees of the tasks running without a cgroup by scanning /proc.
+        /// A process belongs to a task when it descends from the task process, or when it is
+        /// in the session of the task process and started after it, which catches the
+        /// processes reparented to init.
+        class ProcessTreeTracker
+        {
+            public:
+                static ProcessTreeTracker& GetInstance();
+
+                ~ProcessTreeTracker();
+
+                ProcessTreeTracker(const ProcessTreeTracker&) = delete;
+                ProcessTreeTracker& operator=(const ProcessTreeTracker&) = delete;
+
+                /// The root process calls setsid so that its session id is its pid.
+                void Track(const std::string& key, pid_t rootPid);
+                void Untrack(const std::string& key);
+
+                /// The statistics of the latest scan.
+                bool GetStatistics(const std::string& key, hpc::data::ProcessStatistics& stat);
+
+                /// Stops the whole tree until no new process shows up, then sends the signal.
+                int Kill(const std::string& key, int sig);
+
+                /// Waits until no process of the task is left, false when the timeout elapses.
+                bool WaitEmpty(const std::string& key, int timeoutMs);
+
+                static const int ScanIntervalSeconds = 2;
+
+            protected:
+            private:
+                ProcessTreeTracker();
+
+                struct ProcStat
+                {
+                    pid_t Pid;
+                    pid_t ParentPid;
+                    pid_t Session;
+                    uint64_t UserTicks;
+                    uint64_t SystemTicks;
+                    uint64_t ChildrenUserTicks;
+                    uint64_t ChildrenSystemTicks;
+                    uint64_t StartTime;
+                    uint64_t RssPages;
+                    bool Zombie;
+                };
+
+                struct TaskTree
+                {
+                    pid_t Root;
+                    uint64_t RootStartTime;
+                    // pid and start time of the processes attributed by the previous scans.
+                    std::map<pid_t, uint64_t> Members;
+                    uint64_t ReapedUserTicks = 0;
+                    uint64_t ReapedSystemTicks = 0;
+                    uint64_t PeakRssPages = 0;
+                    hpc::data::ProcessStatistics Stat;
+                };
+
+                static void* ScanningThread(void* arg);
+
+                /// Must be called with the lock held.
+                void Scan();
+                bool ReadProcStat(pid_t pid, ProcStat& stat);
+
+                std::map<std::string, TaskTree> tasks;
+                std::vector<ProcStat> processes;
+                hpc::utils::UnionFindSet trees;
+                std::vector<char> buffer;
+
+                std::mutex lock;
+                pthread_t threadId = 0;
+                std::atomic<bool> isRunning { true };
+        };
+    }
+}
+
+#endif // PROCESSTREETRACKER_H
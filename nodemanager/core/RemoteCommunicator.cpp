@@ -4,10 +4,15 @@
 #include "RemoteCommunicator.h"
 #include "../utils/String.h"
 #include "../utils/System.h"
+#include "../utils/LockStatistics.h"
+#include "../utils/JsonReader.h"
 #include "../arguments/StartJobAndTaskArgs.h"
+#include "../arguments/StartTaskArgs.h"
 #include "../common/ErrorCodes.h"
 #include "NodeManagerConfig.h"
 #include "HttpHelper.h"
+#include "ClientSslContext.h"
+#include "TaskTracer.h"
 #include "../filters/FilterException.h"
 #include "../arguments/MetricCountersConfig.h"
 
@@ -19,6 +24,7 @@ using namespace hpc::core;
 using namespace hpc::common;
 using namespace web::http::experimental::listener;
 using namespace hpc::filters;
+using namespace hpc::data;
 
 RemoteCommunicator::RemoteCommunicator(IRemoteExecutor& exec, const http_listener_config& config, const std::string& uri) :
     listeningUri(uri), isListening(false), localNodeName(System::GetNodeName()), executor(exec),
@@ -35,8 +41,8 @@ RemoteCommunicator::RemoteCommunicator(IRemoteExecutor& exec, const http_listene
             [this](auto request) { this->HandleGet(request); });
     }
 
-    this->processors["startjobandtask"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->StartJobAndTask(std::move(j), std::move(c)); };
-    this->processors["starttask"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->StartTask(std::move(j), std::move(c)); };
+    this->bodyProcessors["startjobandtask"] = [this] (auto&& b, auto&& c) mutable -> pplx::task<json::value> { return this->StartJobAndTask(std::move(b), std::move(c)); };
+    this->bodyProcessors["starttask"] = [this] (auto&& b, auto&& c) mutable -> pplx::task<json::value> { return this->StartTask(std::move(b), std::move(c)); };
     this->processors["endjob"] = [this] (auto&& j, auto&& c) mutable -> pplx::task<json::value> { return this->EndJob(std::move(j), std::move(c)); };
     this->processors["endtask"] = [this] (auto&& j, auto&& c) { return this->EndTask(std::move(j), std::move(c)); };
     this->processors["ping"] = [this] (auto&& j, auto&& c) { return this->Ping(std::move(j), std::move(c)); };
@@ -95,7 +101,27 @@ void RemoteCommunicator::HandleGet(http_request request)
     Logger::Info("Request (GET): Uri {0}", uri);
 
     json::value body;
-    body["status"] = json::value::string("node manager working");
+    if (uri.find("startuptrace") != std::string::npos)
+    {
+        body = TaskTracer::HistogramsToJson();
+    }
+    else if (uri.find("lockstats") != std::string::npos)
+    {
+        body = LockStatistics::ToJson();
+    }
+    else if (uri.find("httpclients") != std::string::npos)
+    {
+        body = HttpClientPool::GetInstance().ToJson();
+    }
+    else if (uri.find("tlssessions") != std::string::npos)
+    {
+        body = ClientSslContext::GetInstance().ToJson();
+    }
+    else
+    {
+        body["status"] = json::value::string("node manager working");
+    }
+
     request.reply(status_codes::OK, body).then([this](auto t) { this->IsError(t); });
 }
 
@@ -196,20 +222,38 @@ void RemoteCommunicator::HandlePost(http_request request)
         return;
     }
 
+    auto bodyProcessor = this->bodyProcessors.find(methodName);
     auto processor = this->processors.find(methodName);
 
-    if (processor != this->processors.end())
+    if (bodyProcessor != this->bodyProcessors.end() || processor != this->processors.end())
     {
-        request.extract_json().then(
-        [processor, callback = std::move(callbackUri)] (pplx::task<json::value> t)
+        pplx::task<json::value> result;
+
+        if (bodyProcessor != this->bodyProcessors.end())
         {
-            auto j = t.get();
-         //   Logger::Debug("Json: {0}", j.serialize());
-            auto uri = callback;
+            result = request.extract_string().then(
+            [bodyProcessor, callback = std::move(callbackUri)] (pplx::task<std::string> t)
+            {
+                auto body = t.get();
+                auto uri = callback;
+
+                return bodyProcessor->second(std::move(body), std::move(uri));
+            });
+        }
+        else
+        {
+            result = request.extract_json().then(
+            [processor, callback = std::move(callbackUri)] (pplx::task<json::value> t)
+            {
+                auto j = t.get();
+             //   Logger::Debug("Json: {0}", j.serialize());
+                auto uri = callback;
 
-            return processor->second(std::move(j), std::move(uri));
-        })
-        .then([request] (pplx::task<json::value> t)
+                return processor->second(std::move(j), std::move(uri));
+            });
+        }
+
+        result.then([request] (pplx::task<json::value> t)
         {
             try
             {
@@ -243,29 +287,61 @@ void RemoteCommunicator::HandlePost(http_request request)
     }
 }
 
-pplx::task<json::value> RemoteCommunicator::StartJobAndTask(json::value&& val, std::string&& callbackUri)
+pplx::task<json::value> RemoteCommunicator::StartJobAndTask(std::string&& body, std::string&& callbackUri)
 {
-    auto args = StartJobAndTaskArgs::FromJson(val);
+    JsonReader reader(body);
+    auto args = StartJobAndTaskArgs::FromJson(reader);
+    reader.End();
+    TaskTracer::Mark(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, TracePhase::RequestReceived);
+
+    if (!this->filter.HasJobStartFilter())
+    {
+        return this->executor.StartJobAndTask(std::move(args), std::move(callbackUri));
+    }
 
-    return this->filter.OnJobStart(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, val).then(
-    [this, callback = std::move(callbackUri)](pplx::task<json::value> t)
+    TaskTracer::Mark(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, TracePhase::FilterStarted);
+
+    return this->filter.OnJobStart(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, body).then(
+    [this, callback = std::move(callbackUri), jobId = args.JobId, taskId = args.TaskId, requeueCount = args.StartInfo.TaskRequeueCount](pplx::task<std::string> t)
     {
-        auto filteredJson = t.get();
+        auto filteredBody = t.get();
+        TaskTracer::Mark(jobId, taskId, requeueCount, TracePhase::FilterEnded);
+
+        JsonReader filteredReader(filteredBody);
+        auto filteredArgs = StartJobAndTaskArgs::FromJson(filteredReader);
+        filteredReader.End();
+
         auto uri = callback;
-        return this->executor.StartJobAndTask(StartJobAndTaskArgs::FromJson(filteredJson), std::move(uri));
+        return this->executor.StartJobAndTask(std::move(filteredArgs), std::move(uri));
     });
 }
 
-pplx::task<json::value> RemoteCommunicator::StartTask(json::value&& val, std::string&& callbackUri)
+pplx::task<json::value> RemoteCommunicator::StartTask(std::string&& body, std::string&& callbackUri)
 {
-    auto args = StartTaskArgs::FromJson(val);
+    JsonReader reader(body);
+    auto args = StartTaskArgs::FromJson(reader);
+    reader.End();
+    TaskTracer::Mark(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, TracePhase::RequestReceived);
 
-    return this->filter.OnTaskStart(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, val).then(
-    [this, callback = std::move(callbackUri)](pplx::task<json::value> t)
+    if (!this->filter.HasTaskStartFilter())
     {
-        auto filteredJson = t.get();
+        return this->executor.StartTask(std::move(args), std::move(callbackUri));
+    }
+
+    TaskTracer::Mark(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, TracePhase::FilterStarted);
+
+    return this->filter.OnTaskStart(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, body).then(
+    [this, callback = std::move(callbackUri), jobId = args.JobId, taskId = args.TaskId, requeueCount = args.StartInfo.TaskRequeueCount](pplx::task<std::string> t)
+    {
+        auto filteredBody = t.get();
+        TaskTracer::Mark(jobId, taskId, requeueCount, TracePhase::FilterEnded);
+
+        JsonReader filteredReader(filteredBody);
+        auto filteredArgs = StartTaskArgs::FromJson(filteredReader);
+        filteredReader.End();
+
         auto uri = callback;
-        return this->executor.StartTask(StartTaskArgs::FromJson(filteredJson), std::move(uri));
+        return this->executor.StartTask(std::move(filteredArgs), std::move(uri));
     });
 }
 
@@ -55,8 +55,8 @@ namespace hpc
                     return IsError(t, errorMessage);
                 }
 
-                pplx::task<json::value> StartJobAndTask(json::value&& val, std::string&&);
-                pplx::task<json::value> StartTask(json::value&& val, std::string&&);
+                pplx::task<json::value> StartJobAndTask(std::string&& body, std::string&&);
+                pplx::task<json::value> StartTask(std::string&& body, std::string&&);
                 pplx::task<json::value> EndJob(json::value&& val, std::string&&);
                 pplx::task<json::value> EndTask(json::value&& val, std::string&&);
                 pplx::task<json::value> Ping(json::value&& val, std::string&&);
@@ -72,6 +72,9 @@ namespace hpc
 
                 std::map<std::string, std::function<pplx::task<json::value>(json::value&&, std::string&&)>> processors;
 
+                // the start requests are read from the body without building a json value.
+                std::map<std::string, std::function<pplx::task<json::value>(std::string&&, std::string&&)>> bodyProcessors;
+
                 IRemoteExecutor& executor;
 
                 web::http::experimental::listener::http_listener listener;
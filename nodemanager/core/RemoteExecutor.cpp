@@ -1,5 +1,6 @@
 #include <cpprest/http_client.h>
 #include <memory>
+#include <chrono>
 #include <boost/uuid/string_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/algorithm/string.hpp>
@@ -8,10 +9,14 @@
 #include "RemoteExecutor.h"
 #include "HttpReporter.h"
 #include "UdpReporter.h"
+#include "TaskTracer.h"
 #include "../utils/WriterLock.h"
 #include "../utils/ReaderLock.h"
 #include "../utils/Logger.h"
 #include "../utils/System.h"
+#include "../utils/JsonWriter.h"
+#include "../utils/JsonReader.h"
+#include "../utils/Journal.h"
 #include "../common/ErrorCodes.h"
 #include "../data/ProcessStatistics.h"
 #include "NodeManagerConfig.h"
@@ -26,8 +31,13 @@ using namespace hpc::data;
 using namespace hpc::common;
 
 RemoteExecutor::RemoteExecutor(const std::string& networkName)
-    : monitor(System::GetNodeName(), networkName, MetricReportInterval), lock(PTHREAD_RWLOCK_INITIALIZER)
+    : monitor(System::GetNodeName(), networkName, MetricReportInterval),
+    lock(PTHREAD_RWLOCK_INITIALIZER), processesLock(PTHREAD_RWLOCK_INITIALIZER), usersLock(PTHREAD_RWLOCK_INITIALIZER),
+    lockStatistics("RemoteExecutor.lock"), processesLockStatistics("RemoteExecutor.processesLock"), usersLockStatistics("RemoteExecutor.usersLock")
 {
+    this->StartStatisticsAggregator();
+    this->StartCompletionDispatcher();
+    this->RecoverTasks();
     this->StartRegister();
     this->StartHeartbeat();
     this->StartMetric();
@@ -36,64 +46,98 @@ RemoteExecutor::RemoteExecutor(const std::string& networkName)
 
 pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& args, std::string&& callbackUri)
 {
+    this->ProvisionUser(args);
+
+    TaskTracer::Mark(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, TracePhase::UserProvisioned);
+
+    return this->StartTask(StartTaskArgs(args.JobId, args.TaskId, std::move(args.StartInfo)), std::move(callbackUri));
+}
+
+void RemoteExecutor::ProvisionUser(StartJobAndTaskArgs& args)
+{
+    const auto& envi = args.StartInfo.EnvironmentVariables;
+    auto isAdminIt = envi.find("CCP_ISADMIN");
+    bool isAdmin = isAdminIt != envi.end() && isAdminIt->second == "1";
+    auto mapAdminUserIt = envi.find("CCP_MAP_ADMIN_USER");
+    bool mapAdminUser = mapAdminUserIt != envi.end() && mapAdminUserIt->second == "1";
+    
+    const std::string WindowsSystemUser = "NT AUTHORITY\\SYSTEM";
+    bool mapAdminToRoot = isAdmin && !mapAdminUser;
+    bool mapAdminToUser = isAdmin && mapAdminUser;
+    bool isWindowsSystemAccount = boost::iequals(args.UserName, WindowsSystemUser);
+
+    std::string userName;
+
+    // Use root user in 3 scenarios:
+    // 1. This is old image, username is empty, we use root.
+    // 2. User is Windows or HPC Administrator and CCP_MAP_ADMIN_USER is not set
+    // 3. User is Windows local system account, which is mapped to Linux root user.
+    bool createUser = !(args.UserName.empty() || mapAdminToRoot || isWindowsSystemAccount);
+    if (!createUser)
+    {
+        userName = "root";
+    }
+    else
     {
-        WriterLock writerLock(&this->lock);
+        auto preserveDomainIt = envi.find("CCP_PRESERVE_DOMAIN");
+        bool preserveDomain = preserveDomainIt != envi.end() && preserveDomainIt->second == "1";
+        userName = preserveDomain ? args.UserName : String::GetUserName(args.UserName);
+        if (userName == "root") { userName = "hpc_faked_root"; }
+    }
+
+    // Set SSH keys in 3 scenarios:
+    // 1. User is not a Windows or HPC Administrator.
+    // 2. User is Windows or HPC Administrator and it is mapped to non-root user in Linux.
+    // 3. User is Windows local system account, which is mapped to Linux root user.
+    bool setKeys = !isAdmin || mapAdminToUser || isWindowsSystemAccount;
 
-        const auto& envi = args.StartInfo.EnvironmentVariables;
-        auto isAdminIt = envi.find("CCP_ISADMIN");
-        bool isAdmin = isAdminIt != envi.end() && isAdminIt->second == "1";
-        auto mapAdminUserIt = envi.find("CCP_MAP_ADMIN_USER");
-        bool mapAdminUser = mapAdminUserIt != envi.end() && mapAdminUserIt->second == "1";
-        
-        const std::string WindowsSystemUser = "NT AUTHORITY\\SYSTEM";
-        bool mapAdminToRoot = isAdmin && !mapAdminUser;
-        bool mapAdminToUser = isAdmin && mapAdminUser;
-        bool isWindowsSystemAccount = boost::iequals(args.UserName, WindowsSystemUser);
+    std::string keysFingerprint = System::GetKeyFingerprint(String::Join("\n", args.PrivateKey, args.PublicKey));
 
-        std::string userName;
-        bool existed;
+    // only the tasks of the same user wait here, other users are provisioned in parallel.
+    auto provisioning = this->GetUserProvisioning(userName);
+    std::lock_guard<std::mutex> provisioningGuard(provisioning->Lock);
 
-        // Use root user in 3 scenarios:
-        // 1. This is old image, username is empty, we use root.
-        // 2. User is Windows or HPC Administrator and CCP_MAP_ADMIN_USER is not set
-        // 3. User is Windows local system account, which is mapped to Linux root user.
-        if (args.UserName.empty() || mapAdminToRoot || isWindowsSystemAccount)
+    bool existed = true;
+    if (createUser)
+    {
+        // an existing user is found by getpwnam, without running useradd.
+        int ret = System::CreateUser(userName, args.Password, isAdmin);
+        existed = ret == 9;
+        if (ret != 0 && ret != 9)
         {
-            userName = "root";
-            existed = true;
+            throw std::runtime_error(
+                String::Join(" ", "Create user", userName, "failed with error code", ret));
         }
-        else
-        {
-            auto preserveDomainIt = envi.find("CCP_PRESERVE_DOMAIN");
-            bool preserveDomain = preserveDomainIt != envi.end() && preserveDomainIt->second == "1";
-            userName = preserveDomain ? args.UserName : String::GetUserName(args.UserName);
-            if (userName == "root") { userName = "hpc_faked_root"; }
-            int ret = System::CreateUser(userName, args.Password, isAdmin);
-            existed = ret == 9;
-            if (ret != 0 && ret != 9)
-            {
-                throw std::runtime_error(
-                    String::Join(" ", "Create user", userName, "failed with error code", ret));
-            }
 
-            Logger::Debug(args.JobId, args.TaskId, this->UnknowId, "Create user {0} return code: {1}.", userName, ret);
-        }
+        Logger::Debug(args.JobId, args.TaskId, this->UnknowId, "Create user {0} return code: {1}.", userName, ret);
+    }
 
-        bool privateKeyAdded = false;
-        bool publicKeyAdded = false;
-        bool authKeyAdded = false;
+    bool privateKeyAdded = false;
+    bool publicKeyAdded = false;
+    bool authKeyAdded = false;
+
+    if (setKeys)
+    {
+        if (!keysFingerprint.empty() && provisioning->KeysFingerprint == keysFingerprint)
+        {
+            Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
+                "Keys of user {0} are provisioned already, fingerprint {1}", userName, keysFingerprint);
 
-        // Set SSH keys in 3 scenarios:
-        // 1. User is not a Windows or HPC Administrator.
-        // 2. User is Windows or HPC Administrator and it is mapped to non-root user in Linux.
-        // 3. User is Windows local system account, which is mapped to Linux root user.
-        if (!isAdmin || mapAdminToUser || isWindowsSystemAccount)
+            privateKeyAdded = provisioning->PrivateKeyAdded;
+            publicKeyAdded = provisioning->PublicKeyAdded;
+            args.PublicKey = provisioning->PublicKey;
+        }
+        else
         {
+            provisioning->KeysFingerprint.clear();
+
             std::string privateKeyFile;
             privateKeyAdded = 0 == System::AddSshKey(userName, args.PrivateKey, "id_rsa", "600", privateKeyFile);
 
-            if (privateKeyAdded && args.PublicKey.empty())
+            if (privateKeyAdded && args.PublicKey.empty() &&
+                0 != System::GetSshPublicKey(args.PrivateKey, args.PublicKey))
             {
+                // not a PEM RSA key, ssh-keygen reads the other formats.
                 int ret = System::ExecuteCommandOut(args.PublicKey, "ssh-keygen -y -f ", privateKeyFile);
                 if (ret != 0)
                 {
@@ -104,250 +148,478 @@ pplx::task<json::value> RemoteExecutor::StartJobAndTask(StartJobAndTaskArgs&& ar
             std::string publicKeyFile;
             publicKeyAdded = privateKeyAdded && (0 == System::AddSshKey(userName, args.PublicKey, "id_rsa.pub", "644", publicKeyFile));
 
-            std::string userAuthKeyFile;
-            authKeyAdded = privateKeyAdded && publicKeyAdded && (0 == System::AddAuthorizedKey(userName, args.PublicKey, "600", userAuthKeyFile));
+            provisioning->KeysFingerprint = keysFingerprint;
+            provisioning->PrivateKeyAdded = privateKeyAdded;
+            provisioning->PublicKeyAdded = publicKeyAdded;
+            provisioning->PublicKey = args.PublicKey;
+        }
 
-            Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
-                "Add ssh key for user {0} result: private {1}, public {2}, auth {3}",
-                userName, privateKeyAdded, publicKeyAdded, authKeyAdded);
+        bool jobRegistered;
+        {
+            ReaderLock readerLock(&this->usersLock, &this->usersLockStatistics);
+            jobRegistered = this->jobUsers.find(args.JobId) != this->jobUsers.end();
         }
 
-        if (this->jobUsers.find(args.JobId) == this->jobUsers.end())
+        if (privateKeyAdded && publicKeyAdded && !jobRegistered)
         {
-            Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
-                "Create user: jobUsers entry added.");
+            // the line is added for the first job using the key, and removed after the last one.
+            auto& references = provisioning->AuthorizedKeyReferences[String::Trim(args.PublicKey)];
+            if (references == 0)
+            {
+                std::string userAuthKeyFile;
+                authKeyAdded = 0 == System::AddAuthorizedKey(userName, args.PublicKey, "600", userAuthKeyFile);
+            }
+            else
+            {
+                authKeyAdded = true;
+            }
 
-            this->jobUsers[args.JobId] =
-                std::tuple<std::string, bool, bool, bool, bool, std::string>(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, args.PublicKey);
+            if (authKeyAdded)
+            {
+                references++;
+            }
+            else
+            {
+                provisioning->AuthorizedKeyReferences.erase(String::Trim(args.PublicKey));
+            }
         }
 
-        auto it = this->userJobs.find(userName);
+        Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
+            "Add ssh key for user {0} result: private {1}, public {2}, auth {3}",
+            userName, privateKeyAdded, publicKeyAdded, authKeyAdded);
+    }
+
+    JobUser jobUser(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, args.PublicKey);
+
+    // registered before the provisioning lock is released, so CleanupJobUser of
+    // another job won't remove the keys this job is going to use.
+    WriterLock writerLock(&this->usersLock, &this->usersLockStatistics);
+
+    if (this->jobUsers.find(args.JobId) == this->jobUsers.end())
+    {
+        Logger::Debug(args.JobId, args.TaskId, this->UnknowId,
+            "Create user: jobUsers entry added.");
+
+        this->jobUsers[args.JobId] = jobUser;
+        this->SaveJobUser(args.JobId, jobUser);
+    }
+
+    this->userJobs[userName].insert(args.JobId);
+}
+
+std::shared_ptr<RemoteExecutor::UserProvisioning> RemoteExecutor::GetUserProvisioning(const std::string& userName)
+{
+    // the entries are kept after the jobs end, a user has only one entry to serialize on.
+    WriterLock writerLock(&this->usersLock, &this->usersLockStatistics);
+
+    auto& provisioning = this->userProvisionings[userName];
+    if (!provisioning)
+    {
+        provisioning = std::make_shared<UserProvisioning>();
+    }
+
+    return provisioning;
+}
+
+std::shared_ptr<Process> RemoteExecutor::FindProcess(uint64_t processKey)
+{
+    ReaderLock readerLock(&this->processesLock, &this->processesLockStatistics);
 
-        if (it != this->userJobs.end())
+    auto p = this->processes.find(processKey);
+    return p != this->processes.end() ? p->second : nullptr;
+}
+
+std::function<Process::Callback> RemoteExecutor::GetTaskCompletedCallback(std::shared_ptr<TaskInfo> taskInfo, std::string callbackUri)
+{
+    return [taskInfo, uri = std::move(callbackUri), this] (
+        int exitCode,
+        std::string&& message,
+        const ProcessStatistics& stat)
+    {
+        try
         {
-            it->second.insert(args.JobId);
+            std::string jsonBody;
+
+            taskInfo->CancelGraceTimer();
+
+            {
+                WriterLock writerLock(&this->lock, &this->lockStatistics);
+
+                if (taskInfo->Exited)
+                {
+                    Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+                        "Ended already by EndTask.");
+                }
+                else
+                {
+                    auto breakdown = TaskTracer::GetSlowStartupBreakdown(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount());
+                    if (!breakdown.empty())
+                    {
+                        Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "{0}", breakdown);
+                        message += breakdown + "\n";
+                    }
+
+                    taskInfo->Exited = true;
+                    taskInfo->ExitCode = exitCode;
+                    taskInfo->Message = std::move(message);
+                    taskInfo->AssignFromStat(stat);
+
+                    JsonWriter writer;
+                    taskInfo->WriteCompletionEventArgJson(writer);
+                    jsonBody = writer.GetString();
+                }
+            }
+
+            this->ReportTaskCompletion(taskInfo->JobId, taskInfo->TaskId,
+                taskInfo->GetTaskRequeueCount(), std::move(jsonBody), uri);
+
+            // this won't remove the task entry added later as attempt id doesn't match
+            this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
         }
-        else
+        catch (const std::exception& ex)
         {
-            this->userJobs[userName] = { args.JobId };
+            Logger::Error(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+                "Exception when sending back task result. {0}", ex.what());
         }
-    }
 
-    return this->StartTask(StartTaskArgs(args.JobId, args.TaskId, std::move(args.StartInfo)), std::move(callbackUri));
+        Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+            "attemptId {0}, processKey {1}, erasing process", taskInfo->GetAttemptId(), taskInfo->ProcessKey);
+
+        {
+            WriterLock processesWriterLock(&this->processesLock, &this->processesLockStatistics);
+
+            // under the same lock as SaveTaskState, so the state is never saved after this.
+            if (this->stateJournal)
+            {
+                this->stateJournal->Acknowledge(GetTaskStateKey(taskInfo->JobId, taskInfo->ProcessKey));
+            }
+
+            // Process will be deleted here.
+            this->processes.erase(taskInfo->ProcessKey);
+            this->ReportOverlappingCpusets();
+        }
+    };
 }
 
 pplx::task<json::value> RemoteExecutor::StartTask(StartTaskArgs&& args, std::string&& callbackUri)
 {
-    WriterLock writerLock(&this->lock);
+    std::shared_ptr<TaskInfo> taskInfo;
+    std::string userName = "root";
+    std::string dockerImage;
 
-    bool isNewEntry;
-    std::shared_ptr<TaskInfo> taskInfo = this->jobTaskTable.AddJobAndTask(args.JobId, args.TaskId, isNewEntry);
+    {
+        WriterLock writerLock(&this->lock, &this->lockStatistics);
 
-    taskInfo->Affinity = args.StartInfo.Affinity;
-    taskInfo->SetTaskRequeueCount(args.StartInfo.TaskRequeueCount);
+        bool isNewEntry;
+        taskInfo = this->jobTaskTable.AddJobAndTask(args.JobId, args.TaskId, args.StartInfo.Affinity, isNewEntry);
 
-    std::string userName = "root";
-    auto jobUser = this->jobUsers.find(args.JobId);
-    if (jobUser == this->jobUsers.end())
-    {
-        this->jobTaskTable.RemoveJob(args.JobId);
-        throw std::runtime_error(String::Join(" ", "Job", args.JobId, "was not started on this node."));
-    }
-    else
-    {
-        userName = std::get<0>(jobUser->second);
-    }
+        taskInfo->SetTaskRequeueCount(args.StartInfo.TaskRequeueCount);
 
-    if (args.StartInfo.CommandLine.empty())
-    {
-        Logger::Info(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, "MPI non-master task found, skip creating the process.");
-        std::string dockerImage = args.StartInfo.EnvironmentVariables["CCP_DOCKER_IMAGE"];
-        std::string isNvidiaDocker = args.StartInfo.EnvironmentVariables["CCP_DOCKER_NVIDIA"];
-        std::string additionalOption = args.StartInfo.EnvironmentVariables["CCP_DOCKER_START_OPTION"];
-        std::string skipSshSetup = args.StartInfo.EnvironmentVariables["CCP_DOCKER_SKIP_SSH_SETUP"];
-        if (!dockerImage.empty())
-        {
-            taskInfo->IsPrimaryTask = false;
-            std::string output;
-            dockerImage = String::Join(dockerImage, "\"", "\"");
-            isNvidiaDocker = String::Join(isNvidiaDocker, "\"", "\"");
-            boost::replace_all(additionalOption, "\"", "\\\"");
-            additionalOption = String::Join(additionalOption, "\"", "\"");
-            skipSshSetup = String::Join(skipSshSetup, "\"", "\"");
-            int ret = System::ExecuteCommandOut(output, "/bin/bash 2>&1", "StartMpiContainer.sh", taskInfo->TaskId, userName, dockerImage, isNvidiaDocker, additionalOption, skipSshSetup);
-            if (ret == 0)
+        bool userFound = false;
+        {
+            ReaderLock readerLock(&this->usersLock, &this->usersLockStatistics);
+            auto jobUser = this->jobUsers.find(args.JobId);
+            if (jobUser != this->jobUsers.end())
             {
-                Logger::Info(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "Start MPI container successfully.");
+                userName = std::get<0>(jobUser->second);
+                userFound = true;
             }
-            else
+        }
+
+        if (!userFound)
+        {
+            this->jobTaskTable.RemoveJob(args.JobId);
+            throw std::runtime_error(String::Join(" ", "Job", args.JobId, "was not started on this node."));
+        }
+
+        if (args.StartInfo.CommandLine.empty())
+        {
+            Logger::Info(args.JobId, args.TaskId, args.StartInfo.TaskRequeueCount, "MPI non-master task found, skip creating the process.");
+            dockerImage = args.StartInfo.EnvironmentVariables["CCP_DOCKER_IMAGE"];
+            if (!dockerImage.empty())
             {
-                Logger::Error(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "Start MPI container failed with exitcode {0}. {1}", ret, output);
+                taskInfo->IsPrimaryTask = false;
             }
         }
-    }
-    else
-    {
-        if (this->processes.find(taskInfo->ProcessKey) == this->processes.end() &&
-            isNewEntry)
-        {
-            auto process = std::shared_ptr<Process>(new Process(
-                taskInfo->JobId,
-                taskInfo->TaskId,
-                taskInfo->GetTaskRequeueCount(),
-                "Task",
-                std::move(args.StartInfo.CommandLine),
-                std::move(args.StartInfo.StdOutFile),
-                std::move(args.StartInfo.StdErrFile),
-                std::move(args.StartInfo.StdInFile),
-                std::move(args.StartInfo.WorkDirectory),
-                userName,
-                true,
-                std::move(args.StartInfo.Affinity),
-                std::move(args.StartInfo.EnvironmentVariables),
-                [taskInfo, uri = std::move(callbackUri), this] (
-                    int exitCode,
-                    std::string&& message,
-                    const ProcessStatistics& stat)
+        else
+        {
+            WriterLock processesWriterLock(&this->processesLock, &this->processesLockStatistics);
+
+            if (this->processes.find(taskInfo->ProcessKey) == this->processes.end() &&
+                isNewEntry)
+            {
+                auto process = std::shared_ptr<Process>(new Process(
+                    taskInfo->JobId,
+                    taskInfo->TaskId,
+                    taskInfo->GetTaskRequeueCount(),
+                    "Task",
+                    std::move(args.StartInfo.CommandLine),
+                    std::move(args.StartInfo.StdOutFile),
+                    std::move(args.StartInfo.StdErrFile),
+                    std::move(args.StartInfo.StdInFile),
+                    std::move(args.StartInfo.WorkDirectory),
+                    userName,
+                    true,
+                    std::move(args.StartInfo.Affinity),
+                    std::move(args.StartInfo.EnvironmentVariables),
+                    this->GetTaskCompletedCallback(taskInfo, callbackUri)));
+
+                this->processes[taskInfo->ProcessKey] = process;
+                Logger::Debug(
+                    args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
+                    "StartTask for ProcessKey {0}, process count {1}", taskInfo->ProcessKey, this->processes.size());
+
+                this->ReportOverlappingCpusets(taskInfo->ProcessKey);
+
+                process->Start(process).then([this, taskInfo, process, uri = std::move(callbackUri)] (std::pair<pid_t, pthread_t> ids)
                 {
-                    try
-                    {
-                        json::value jsonBody;
-
-                        taskInfo->CancelGracefulThread();
-
-                        {
-                            WriterLock writerLock(&this->lock);
-
-                            if (taskInfo->Exited)
-                            {
-                                Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                                    "Ended already by EndTask.");
-                            }
-                            else
-                            {
-                                taskInfo->Exited = true;
-                                taskInfo->ExitCode = exitCode;
-                                taskInfo->Message = std::move(message);
-                                taskInfo->AssignFromStat(stat);
-
-                                jsonBody = taskInfo->ToCompletionEventArgJson();
-                            }
-                        }
-
-                        this->ReportTaskCompletion(taskInfo->JobId, taskInfo->TaskId,
-                            taskInfo->GetTaskRequeueCount(), jsonBody, uri);
-
-                        // this won't remove the task entry added later as attempt id doesn't match
-                        this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
-                    }
-                    catch (const std::exception& ex)
+                    if (ids.first > 0)
                     {
-                        Logger::Error(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                            "Exception when sending back task result. {0}", ex.what());
+                        Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+                            "Process started pid {0}, tid {1}", ids.first, ids.second);
+
+                        this->SaveTaskState(*taskInfo, process, uri);
                     }
+                });
+            }
+            else
+            {
+                Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
+                    "The task has started already.");
+            }
+        }
+    }
 
-                    Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                        "attemptId {0}, processKey {1}, erasing process", taskInfo->GetAttemptId(), taskInfo->ProcessKey);
+    // the container script takes seconds, it runs without any lock.
+    if (!dockerImage.empty())
+    {
+        std::string isNvidiaDocker = args.StartInfo.EnvironmentVariables["CCP_DOCKER_NVIDIA"];
+        std::string additionalOption = args.StartInfo.EnvironmentVariables["CCP_DOCKER_START_OPTION"];
+        std::string skipSshSetup = args.StartInfo.EnvironmentVariables["CCP_DOCKER_SKIP_SSH_SETUP"];
+        std::string output;
+        dockerImage = String::Join(dockerImage, "\"", "\"");
+        isNvidiaDocker = String::Join(isNvidiaDocker, "\"", "\"");
+        boost::replace_all(additionalOption, "\"", "\\\"");
+        additionalOption = String::Join(additionalOption, "\"", "\"");
+        skipSshSetup = String::Join(skipSshSetup, "\"", "\"");
+        int ret = System::ExecuteCommandOut(output, "/bin/bash 2>&1", "StartMpiContainer.sh", taskInfo->TaskId, userName, dockerImage, isNvidiaDocker, additionalOption, skipSshSetup);
+        if (ret == 0)
+        {
+            Logger::Info(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "Start MPI container successfully.");
+        }
+        else
+        {
+            Logger::Error(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "Start MPI container failed with exitcode {0}. {1}", ret, output);
+        }
+    }
 
-                    {
-                        WriterLock writerLock(&this->lock);
+    return pplx::task_from_result(json::value());
+}
 
-                        // Process will be deleted here.
-                        this->processes.erase(taskInfo->ProcessKey);
-                    }
-                }));
+pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args)
+{
+    int jobId = args.JobId;
+    auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<JobInfo> jobInfo;
 
-            this->processes[taskInfo->ProcessKey] = process;
-            Logger::Debug(
-                args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
-                "StartTask for ProcessKey {0}, process count {1}", taskInfo->ProcessKey, this->processes.size());
+    auto ending = std::make_shared<EndingJob>();
+    ending->Executor = this;
+    ending->JobId = jobId;
+    ending->Next = 0;
+
+    {
+        WriterLock writerLock(&this->lock, &this->lockStatistics);
 
-            process->Start(process).then([this, taskInfo] (std::pair<pid_t, pthread_t> ids)
+        Logger::Info(jobId, this->UnknowId, this->UnknowId, "EndJob: starting");
+
+        jobInfo = this->jobTaskTable.RemoveJob(jobId);
+
+        if (jobInfo)
+        {
+            for (auto& taskPair : jobInfo->Tasks)
             {
-                if (ids.first > 0)
+                auto taskInfo = taskPair.second;
+
+                if (taskInfo)
                 {
-                    Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                        "Process started pid {0}, tid {1}", ids.first, ids.second);
+                    EndingTask t;
+                    t.Task = taskInfo;
+                    t.TaskId = taskPair.first;
+                    t.RequeueCount = taskInfo->GetTaskRequeueCount();
+                    t.IsPrimaryTask = taskInfo->IsPrimaryTask;
+
+                    t.TaskProcess = this->FindProcess(taskInfo->ProcessKey);
+
+                    ending->Tasks.push_back(std::move(t));
+                }
+                else
+                {
+                    Logger::Warn(jobId, taskPair.first, this->UnknowId,
+                        "EndJob: Task is already finished");
+
+                    assert(false);
                 }
-            });
+            }
         }
         else
         {
-            Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(),
-                "The task has started already.");
+            Logger::Warn(jobId, this->UnknowId, this->UnknowId, "EndJob: Job is already finished");
         }
     }
 
-    return pplx::task_from_result(json::value());
+    int parallelism = std::min<int>(this->EndJobParallelism, ending->Tasks.size());
+    ending->Running = parallelism;
+
+    for (int i = 0; i < parallelism; i++)
+    {
+        auto arg = new std::shared_ptr<EndingJob>(ending);
+        pthread_t threadId;
+
+        int ret = pthread_create(&threadId, nullptr, EndingThread, arg);
+        if (ret != 0)
+        {
+            Logger::Error(jobId, this->UnknowId, this->UnknowId, "EndJob: failed to create the ending thread, ret {0}", ret);
+            delete arg;
+
+            TerminateEndingTasks(*ending);
+        }
+    }
+
+    if (parallelism == 0)
+    {
+        ending->Terminated.set();
+    }
+
+    auto terminated = pplx::task<void>(ending->Terminated);
+
+    // the keys are removed after the processes using them are gone, it is not needed for the response.
+    terminated.then([this, jobId]() { this->CleanupJobUser(jobId); });
+
+    if (!jobInfo)
+    {
+        return pplx::task_from_result(json::value());
+    }
+
+    return terminated.then([this, jobId, jobInfo, ending, startTime]()
+    {
+        WriterLock writerLock(&this->lock, &this->lockStatistics);
+
+        for (auto& t : ending->Tasks)
+        {
+            if (t.Terminated)
+            {
+                t.Task->Exited = t.Stat.IsTerminated();
+                t.Task->ExitCode = (int)ErrorCodes::EndJobExitCode;
+                t.Task->AssignFromStat(t.Stat);
+                t.Task->CancelGraceTimer();
+            }
+        }
+
+        json::value jsonBody = jobInfo->ToJson();
+        auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+        Logger::Info(jobId, this->UnknowId, this->UnknowId, "EndJob: ended {0} tasks in {1}ms, {2}", ending->Tasks.size(), elapsedMs, jsonBody);
+
+        return jsonBody;
+    });
 }
 
-pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args)
+void* RemoteExecutor::EndingThread(void* arg)
 {
-    WriterLock writerLock(&this->lock);
+    pthread_detach(pthread_self());
 
-    Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: starting");
+    std::unique_ptr<std::shared_ptr<EndingJob>> ending(static_cast<std::shared_ptr<EndingJob>*>(arg));
+    TerminateEndingTasks(**ending);
 
-    auto jobInfo = this->jobTaskTable.RemoveJob(args.JobId);
+    return nullptr;
+}
 
-    json::value jsonBody;
+void RemoteExecutor::TerminateEndingTasks(EndingJob& ending)
+{
+    RemoteExecutor* const e = ending.Executor;
+    const int jobId = ending.JobId;
 
-    if (jobInfo)
+    for (size_t index = ending.Next++; index < ending.Tasks.size(); index = ending.Next++)
     {
-        for (auto& taskPair : jobInfo->Tasks)
-        {
-            auto taskInfo = taskPair.second;
+        auto& t = ending.Tasks[index];
+        Logger::Debug(jobId, t.TaskId, t.RequeueCount, "EndJob: Terminating task");
 
-            if (taskInfo)
+        try
+        {
+            if (!t.IsPrimaryTask)
             {
-                const auto* stat = this->TerminateTask(
-                    args.JobId, taskPair.first, taskInfo->GetTaskRequeueCount(),
-                    taskInfo->ProcessKey, (int)ErrorCodes::EndJobExitCode, true, !taskInfo->IsPrimaryTask);
-                Logger::Debug(args.JobId, taskPair.first, taskInfo->GetTaskRequeueCount(), "EndJob: Terminating task");
-                if (stat != nullptr)
-                {
-                    taskInfo->Exited = stat->IsTerminated();
-                    taskInfo->ExitCode = (int)ErrorCodes::EndJobExitCode;
-                    taskInfo->AssignFromStat(*stat);
-                    taskInfo->CancelGracefulThread();
-                }
+                e->StopMpiContainer(jobId, t.TaskId, t.RequeueCount);
+            }
+            else if (t.TaskProcess)
+            {
+                t.Stat = e->TerminateProcess(
+                    jobId, t.TaskId, t.RequeueCount, *t.TaskProcess, (int)ErrorCodes::EndJobExitCode, true);
+                t.Terminated = true;
             }
             else
             {
-                Logger::Warn(args.JobId, taskPair.first, this->UnknowId,
-                    "EndJob: Task is already finished");
-
-                assert(false);
+                Logger::Warn(jobId, t.TaskId, t.RequeueCount, "No process object found.");
             }
         }
+        catch (const std::exception& ex)
+        {
+            Logger::Error(jobId, t.TaskId, t.RequeueCount, "EndJob: Exception when terminating task, ex = {0}", ex.what());
+        }
+    }
 
-        jsonBody = jobInfo->ToJson();
-        Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: ended {0}", jsonBody);
+    // the last one reports the job terminated.
+    if (--ending.Running == 0)
+    {
+        ending.Terminated.set();
     }
-    else
+}
+
+void RemoteExecutor::CleanupJobUser(int jobId)
+{
+    std::string userName;
+
     {
-        Logger::Warn(args.JobId, this->UnknowId, this->UnknowId, "EndJob: Job is already finished");
+        ReaderLock readerLock(&this->usersLock, &this->usersLockStatistics);
+
+        auto jobUser = this->jobUsers.find(jobId);
+        if (jobUser == this->jobUsers.end())
+        {
+            return;
+        }
+
+        userName = std::get<0>(jobUser->second);
     }
 
-    auto jobUser = this->jobUsers.find(args.JobId);
+    // the keys are not removed while the same user is being provisioned for another job.
+    auto provisioning = this->GetUserProvisioning(userName);
+    std::lock_guard<std::mutex> provisioningGuard(provisioning->Lock);
+
+    JobUser endedJobUser;
+    bool cleanupUser = false;
 
-    if (jobUser != this->jobUsers.end())
     {
-        Logger::Info(args.JobId, this->UnknowId, this->UnknowId, "EndJob: Cleanup user {0}", std::get<0>(jobUser->second));
-        auto userJob = this->userJobs.find(std::get<0>(jobUser->second));
+        WriterLock writerLock(&this->usersLock, &this->usersLockStatistics);
+
+        auto jobUser = this->jobUsers.find(jobId);
+        if (jobUser == this->jobUsers.end())
+        {
+            return;
+        }
+
+        Logger::Info(jobId, this->UnknowId, this->UnknowId, "EndJob: Cleanup user {0}", userName);
+        auto userJob = this->userJobs.find(userName);
 
-        bool cleanupUser = false;
         if (userJob == this->userJobs.end())
         {
             cleanupUser = true;
         }
         else
         {
-            userJob->second.erase(args.JobId);
+            userJob->second.erase(jobId);
 
             // cleanup when no one is using the user;
             cleanupUser = userJob->second.empty();
-            Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                "EndJob: {0} jobs associated with the user {1}", userJob->second.size(), std::get<0>(jobUser->second));
+            Logger::Info(jobId, this->UnknowId, this->UnknowId,
+                "EndJob: {0} jobs associated with the user {1}", userJob->second.size(), userName);
 
             if (cleanupUser)
             {
@@ -355,68 +627,80 @@ pplx::task<json::value> RemoteExecutor::EndJob(hpc::arguments::EndJobArgs&& args
             }
         }
 
-        if (cleanupUser)
+        endedJobUser = jobUser->second;
+        this->jobUsers.erase(jobUser);
+
+        if (this->stateJournal)
         {
-            std::string userName, publicKey;
-            bool existed, privateKeyAdded, publicKeyAdded, authKeyAdded;
+            this->stateJournal->Acknowledge(GetJobUserKey(jobId));
+        }
+    }
 
-            std::tie(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, publicKey) = jobUser->second;
+    std::string publicKey;
+    bool existed, privateKeyAdded, publicKeyAdded, authKeyAdded;
 
-            // the existed could be true for the later job, so the user will be left
-            // on the node, which is by design.
-            // we just have this delete user logic for a simple way of cleanup.
-            // if delete user failed, cleanup keys as necessary.
+    std::tie(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, publicKey) = endedJobUser;
 
-            bool cleanupKeys = true;
+    if (authKeyAdded)
+    {
+        auto references = provisioning->AuthorizedKeyReferences.find(String::Trim(publicKey));
+        if (references != provisioning->AuthorizedKeyReferences.end() && --references->second == 0)
+        {
+            provisioning->AuthorizedKeyReferences.erase(references);
+
+            Logger::Info(jobId, this->UnknowId, this->UnknowId,
+                "EndJob: RemoveAuthorizedKey {0}", userName);
+
+            System::RemoveAuthorizedKey(userName, publicKey);
+        }
+    }
+
+    if (cleanupUser)
+    {
+        // the next job of the user writes the key files again.
+        provisioning->KeysFingerprint.clear();
+
+        // the existed could be true for the later job, so the user will be left
+        // on the node, which is by design.
+        // we just have this delete user logic for a simple way of cleanup.
+        // if delete user failed, cleanup keys as necessary.
 
-//            if (!existed)
+        bool cleanupKeys = true;
+
+//        if (!existed)
+//        {
+//            if (!userName.empty())
 //            {
-//                if (!userName.empty())
-//                {
-//                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-//                        "EndJob: Delete user {0}", userName);
+//                Logger::Info(jobId, this->UnknowId, this->UnknowId,
+//                    "EndJob: Delete user {0}", userName);
 //
-//                    cleanupKeys = 0 != System::DeleteUser(userName);
-//                }
+//                cleanupKeys = 0 != System::DeleteUser(userName);
 //            }
+//        }
 
-            if (cleanupKeys)
+        if (cleanupKeys)
+        {
+            if (privateKeyAdded)
             {
-                if (privateKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveSshKey id_rsa: {0}", userName);
-
-                    System::RemoveSshKey(userName, "id_rsa");
-                }
+                Logger::Info(jobId, this->UnknowId, this->UnknowId,
+                    "EndJob: RemoveSshKey id_rsa: {0}", userName);
 
-                if (publicKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveSshKey id_rsa.pub: {0}", userName);
-
-                    System::RemoveSshKey(userName, "id_rsa.pub");
-                }
+                System::RemoveSshKey(userName, "id_rsa");
+            }
 
-                if (authKeyAdded)
-                {
-                    Logger::Info(args.JobId, this->UnknowId, this->UnknowId,
-                        "EndJob: RemoveAuthorizedKey {0}", userName);
+            if (publicKeyAdded)
+            {
+                Logger::Info(jobId, this->UnknowId, this->UnknowId,
+                    "EndJob: RemoveSshKey id_rsa.pub: {0}", userName);
 
-                    System::RemoveAuthorizedKey(userName, publicKey);
-                }
+                System::RemoveSshKey(userName, "id_rsa.pub");
             }
         }
-
-        this->jobUsers.erase(jobUser);
     }
-
-    return pplx::task_from_result(jsonBody);
 }
 
 pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& args, std::string&& callbackUri)
 {
-    ReaderLock readerLock(&this->lock);
     Logger::Info(args.JobId, args.TaskId, this->UnknowId, "EndTask: starting");
 
     auto taskInfo = this->jobTaskTable.GetTask(args.JobId, args.TaskId);
@@ -425,43 +709,61 @@ pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& ar
 
     if (taskInfo)
     {
+        int requeueCount;
+        uint64_t processKey;
+        bool isPrimaryTask;
+
+        {
+            ReaderLock readerLock(&this->lock, &this->lockStatistics);
+            requeueCount = taskInfo->GetTaskRequeueCount();
+            processKey = taskInfo->ProcessKey;
+            isPrimaryTask = taskInfo->IsPrimaryTask;
+        }
+
         Logger::Debug(
-            args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
-            "EndTask for ProcessKey {0}, processes count {1}",
-            taskInfo->ProcessKey, this->processes.size());
+            args.JobId, args.TaskId, requeueCount,
+            "EndTask for ProcessKey {0}", processKey);
 
-        const auto* stat = this->TerminateTask(
-            args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
-            taskInfo->ProcessKey,
+        // terminating takes up to TerminateTimeoutMs, it is done without any lock.
+        ProcessStatistics stat;
+        bool processFound = this->TerminateTask(
+            args.JobId, args.TaskId, requeueCount,
+            processKey,
             (int)ErrorCodes::EndTaskExitCode,
             args.TaskCancelGracePeriodSeconds == 0,
-            !taskInfo->IsPrimaryTask);
+            !isPrimaryTask,
+            stat);
+
+        WriterLock writerLock(&this->lock, &this->lockStatistics);
 
         taskInfo->ExitCode = (int)ErrorCodes::EndTaskExitCode;
 
-        if (stat == nullptr || stat->IsTerminated())
+        if (!processFound || stat.IsTerminated())
         {
             this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
 
             taskInfo->Exited = true;
-            taskInfo->CancelGracefulThread();
+            taskInfo->CancelGraceTimer();
 
-            if (stat != nullptr)
+            if (processFound)
             {
-                taskInfo->AssignFromStat(*stat);
+                taskInfo->AssignFromStat(stat);
             }
         }
         else
         {
             taskInfo->Exited = false;
-            taskInfo->AssignFromStat(*stat);
-
-            // start a thread to kill the task after a period of time;
-            auto* taskIds = new std::tuple<int, int, int, uint64_t, std::string, int, RemoteExecutor*>(
-                taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), taskInfo->ProcessKey,
-                callbackUri, args.TaskCancelGracePeriodSeconds, this);
-
-            pthread_create(&taskInfo->GracefulThreadId, nullptr, RemoteExecutor::GracePeriodElapsed, taskIds);
+            taskInfo->AssignFromStat(stat);
+
+            // kill the task after the grace period.
+            int jobId = taskInfo->JobId, taskId = taskInfo->TaskId;
+            taskInfo->CancelGraceTimer();
+            taskInfo->GraceTimerId = TimerWheel::GetInstance().Schedule(
+                args.TaskCancelGracePeriodSeconds * 1000,
+                [this, jobId, taskId, requeueCount, processKey, callbackUri]()
+                {
+                    this->GracePeriodElapsed(jobId, taskId, requeueCount, processKey, callbackUri);
+                });
         }
 
         jsonBody = taskInfo->ToJson();
@@ -475,45 +777,31 @@ pplx::task<json::value> RemoteExecutor::EndTask(hpc::arguments::EndTaskArgs&& ar
     return pplx::task_from_result(jsonBody);
 }
 
-void* RemoteExecutor::GracePeriodElapsed(void* data)
+void RemoteExecutor::GracePeriodElapsed(int jobId, int taskId, int requeueCount, uint64_t processKey, const std::string& callbackUri)
 {
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, nullptr);
-
-    auto* ids = static_cast<std::tuple<int, int, int, uint64_t, std::string, int, RemoteExecutor*>*>(data);
+    Logger::Info(jobId, taskId, this->UnknowId, "GracePeriodElapsed: starting");
 
-    int jobId, taskId, requeueCount, period;
-    uint64_t processKey;
-    std::string callbackUri;
-    RemoteExecutor* e;
-    std::tie(jobId, taskId, requeueCount, processKey, callbackUri, period, e) = *ids;
+    auto taskInfo = this->jobTaskTable.GetTask(jobId, taskId);
 
-    delete ids;
-
-    sleep(period);
-
-    WriterLock writerLock(&e->lock);
-
-    Logger::Info(jobId, taskId, e->UnknowId, "GracePeriodElapsed: starting");
-
-    auto taskInfo = e->jobTaskTable.GetTask(jobId, taskId);
-
-    if (taskInfo)
+    // the timer is not cancelled synchronously, the task may be a new attempt now.
+    if (taskInfo && taskInfo->ProcessKey == processKey)
     {
-        const auto* stat = e->TerminateTask(
+        ProcessStatistics stat;
+        bool processFound = this->TerminateTask(
             jobId, taskId, requeueCount,
             processKey,
             (int)ErrorCodes::EndTaskExitCode,
             true,
-            false);
+            false,
+            stat);
 
-        if (stat != nullptr)
+        if (processFound)
         {
-            Logger::Debug(jobId, taskId, requeueCount, "remaining pids size {0}", stat->ProcessIds.size());
+            Logger::Debug(jobId, taskId, requeueCount, "remaining pids size {0}", stat.ProcessIds.size());
 
             if (NodeManagerConfig::GetDebug())
             {
-                for (int pid : stat->ProcessIds)
+                for (int pid : stat.ProcessIds)
                 {
                     std::string process;
                     std::string groupFile = "/sys/fs/cgroup/cpu,cpuacct/nmgroup_";
@@ -525,120 +813,419 @@ void* RemoteExecutor::GracePeriodElapsed(void* data)
                 }
             }
 
-            // stat == nullptr means the processKey is already removed from the map
-            // which means the main task has exited already.
-            taskInfo->Exited = true;
-            taskInfo->ExitCode = (int)ErrorCodes::EndTaskExitCode;
-            taskInfo->AssignFromStat(*stat);
-            taskInfo->ProcessIds.clear();
+            std::string jsonBody;
 
-            e->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
+            {
+                WriterLock writerLock(&this->lock, &this->lockStatistics);
+
+                // no process found means the processKey is already removed from the map
+                // which means the main task has exited already.
+                taskInfo->Exited = true;
+                taskInfo->ExitCode = (int)ErrorCodes::EndTaskExitCode;
+                taskInfo->AssignFromStat(stat);
+                taskInfo->ProcessIds.clear();
 
-            json::value jsonBody = taskInfo->ToCompletionEventArgJson();
-            Logger::Info(jobId, taskId, e->UnknowId, "EndTask: ended {0}", jsonBody);
-            e->ReportTaskCompletion(jobId, taskId, requeueCount, jsonBody, callbackUri);
+                this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
+
+                JsonWriter writer;
+                taskInfo->WriteCompletionEventArgJson(writer);
+                jsonBody = writer.GetString();
+            }
+
+            Logger::Info(jobId, taskId, this->UnknowId, "EndTask: ended {0}", jsonBody);
+            this->ReportTaskCompletion(jobId, taskId, requeueCount, std::move(jsonBody), callbackUri);
         }
     }
     else
     {
-        Logger::Warn(jobId, taskId, e->UnknowId, "EndTask: Task is already finished");
+        Logger::Warn(jobId, taskId, this->UnknowId, "EndTask: Task is already finished");
     }
-
-    pthread_exit(nullptr);
 }
 
 void RemoteExecutor::ReportTaskCompletion(
-    int jobId, int taskId, int taskRequeueCount, json::value jsonBody,
+    int jobId, int taskId, int taskRequeueCount, std::string&& jsonBody,
     const std::string& callbackUri)
 {
+    if (jsonBody.empty())
+    {
+        TaskTracer::Complete(jobId, taskId, taskRequeueCount);
+    }
+    else
+    {
+        this->completionDispatcher->Report(jobId, taskId, taskRequeueCount, std::move(jsonBody), callbackUri);
+    }
+}
+
+void RemoteExecutor::StartCompletionDispatcher()
+{
+    int coalesceMs = this->DefaultCompletionCoalesceMs;
+
     try
     {
-        if (!jsonBody.is_null())
+        coalesceMs = NodeManagerConfig::GetTaskCompletionCoalesceMs();
+    }
+    catch (...)
+    {
+        Logger::Info("TaskCompletionCoalesceMs not specified or invalid, use the default window {0}ms.", coalesceMs);
+    }
+
+    std::unique_ptr<Journal> outbox;
+    std::string outboxFile = NodeManagerConfig::GetCompletionOutboxFile();
+    if (!outboxFile.empty())
+    {
+        int outboxSizeMb = this->DefaultCompletionOutboxSizeMb;
+
+        try
+        {
+            outboxSizeMb = NodeManagerConfig::GetCompletionOutboxSizeMb();
+        }
+        catch (...)
+        {
+            Logger::Info("CompletionOutboxSizeMb not specified or invalid, use the default size {0}MB.", outboxSizeMb);
+        }
+
+        outbox = std::unique_ptr<Journal>(new Journal(outboxFile, (size_t)outboxSizeMb << 20));
+        if (!outbox->IsOpen())
+        {
+            Logger::Error("Failed to open the completion outbox {0}, the completions are kept in memory only.", outboxFile);
+            outbox.reset();
+        }
+    }
+
+    this->completionDispatcher = std::unique_ptr<CompletionDispatcher>(
+        new CompletionDispatcher(
+            [this](const std::string& callbackUri) { return NodeManagerConfig::ResolveTaskCompletedUri(callbackUri, this->cts.get_token()); },
+            [this]() { this->ResyncAndInvalidateCache(); },
+            coalesceMs,
+            NodeManagerConfig::GetTaskCompletionBatching(),
+            std::move(outbox)));
+}
+
+void RemoteExecutor::RecoverTasks()
+{
+    std::string stateFile = NodeManagerConfig::GetStateJournalFile();
+    if (!stateFile.empty())
+    {
+        this->stateJournal = std::unique_ptr<Journal>(new Journal(stateFile, (size_t)this->StateJournalSizeMb << 20));
+        if (!this->stateJournal->IsOpen())
         {
-            std::string uri = NodeManagerConfig::ResolveTaskCompletedUri(callbackUri, this->cts.get_token());
-            Logger::Debug(jobId, taskId, taskRequeueCount,
-                "Callback to {0} with {1}", uri, jsonBody);
+            Logger::Error("Failed to open the state journal {0}, the tasks won't survive a restart.", stateFile);
+            this->stateJournal.reset();
+        }
+    }
 
-            auto client = HttpHelper::GetHttpClient(uri);
-            auto request = HttpHelper::GetHttpRequest(methods::POST, jsonBody);
+    std::vector<std::string> keptTaskExecutionIds;
 
-            client->request(*request).then([jobId, taskId, taskRequeueCount, uri, this](pplx::task<http_response> t)
+    if (this->stateJournal)
+    {
+        // the job users are saved before their tasks, so they are recovered first.
+        for (const auto& record : this->stateJournal->GetPending())
+        {
+            try
             {
-                try
+                if (boost::algorithm::starts_with(record.first, "job."))
                 {
-                    auto response = t.get();
-                    Logger::Info(jobId, taskId, taskRequeueCount,
-                        "Callback to {0} response code {1}", uri, response.status_code());
-
-                    if (response.status_code() != status_codes::OK)
-                    {
-                        this->ResyncAndInvalidateCache();
-                    }
+                    this->RecoverJobUser(record.second);
                 }
-                catch (const std::exception& ex)
+                else
                 {
-                    this->ResyncAndInvalidateCache();
-                    Logger::Error(jobId, taskId, taskRequeueCount,
-                        "Exception when sending back task result. {0}", ex.what());
+                    auto process = this->RecoverTask(record.second);
+                    keptTaskExecutionIds.push_back(process->GetTaskExecutionId());
                 }
-            });
+            }
+            catch (const std::exception& ex)
+            {
+                Logger::Error("Failed to recover {0} from the state journal, ex = {1}", record.first, ex.what());
+                this->stateJournal->Acknowledge(record.first);
+            }
         }
+
+        Logger::Info("Recovered {0} tasks from the state journal {1}", keptTaskExecutionIds.size(), stateFile);
     }
-    catch (const std::exception& ex)
+
+    Logger::Info("Cleaning up zombie processes");
+    Process::Cleanup(keptTaskExecutionIds);
+}
+
+void RemoteExecutor::RecoverJobUser(const std::string& state)
+{
+    int jobId = 0;
+    std::string userName, publicKey, key;
+    bool existed = false, privateKeyAdded = false, publicKeyAdded = false, authKeyAdded = false;
+
+    JsonReader reader(state);
+    reader.StartObject();
+    while (reader.NextKey(key))
     {
-        this->ResyncAndInvalidateCache();
-        Logger::Error(jobId, taskId, taskRequeueCount,
-            "Exception when sending back task result. {0}", ex.what());
+        if (key == "JobId") { jobId = reader.ReadInt(); }
+        else if (key == "UserName") { reader.ReadString(userName); }
+        else if (key == "Existed") { existed = reader.ReadBool(); }
+        else if (key == "PrivateKeyAdded") { privateKeyAdded = reader.ReadBool(); }
+        else if (key == "PublicKeyAdded") { publicKeyAdded = reader.ReadBool(); }
+        else if (key == "AuthKeyAdded") { authKeyAdded = reader.ReadBool(); }
+        else if (key == "PublicKey") { reader.ReadString(publicKey); }
+        else { reader.Skip(); }
+    }
+
+    reader.End();
+
+    // the key files are written again by the next provisioning, as the fingerprint is not kept.
+    auto provisioning = this->GetUserProvisioning(userName);
+    if (authKeyAdded)
+    {
+        provisioning->AuthorizedKeyReferences[String::Trim(publicKey)]++;
+    }
+
+    WriterLock writerLock(&this->usersLock, &this->usersLockStatistics);
+
+    this->jobUsers[jobId] = JobUser(userName, existed, privateKeyAdded, publicKeyAdded, authKeyAdded, publicKey);
+    this->userJobs[userName].insert(jobId);
+
+    Logger::Info(jobId, this->UnknowId, this->UnknowId, "Recovered the job user {0}", userName);
+}
+
+std::shared_ptr<Process> RemoteExecutor::RecoverTask(const std::string& state)
+{
+    int jobId = 0, taskId = 0, requeueCount = 0;
+    uint64_t processKey = 0;
+    bool isPrimaryTask = true;
+    std::string userName, callbackUri, key;
+    std::vector<uint64_t> affinity;
+    std::shared_ptr<Process> process;
+
+    // the table entry is added before the process state is read, it is removed again
+    // when the record turns out to be bad, so no task is reported without a process.
+    std::shared_ptr<TaskInfo> taskInfo;
+
+    try
+    {
+        JsonReader reader(state);
+        reader.StartObject();
+        while (reader.NextKey(key))
+        {
+            if (key == "JobId") { jobId = reader.ReadInt(); }
+            else if (key == "TaskId") { taskId = reader.ReadInt(); }
+            else if (key == "TaskRequeueCount") { requeueCount = reader.ReadInt(); }
+            else if (key == "ProcessKey") { processKey = reader.ReadUInt64(); }
+            else if (key == "IsPrimaryTask") { isPrimaryTask = reader.ReadBool(); }
+            else if (key == "UserName") { reader.ReadString(userName); }
+            else if (key == "CallbackUri") { reader.ReadString(callbackUri); }
+            else if (key == "Affinity")
+            {
+                reader.StartArray();
+                while (reader.NextElement()) { affinity.push_back(reader.ReadUInt64()); }
+            }
+            else if (key == "Process")
+            {
+                // saved last, the task fields are read already.
+                WriterLock writerLock(&this->lock, &this->lockStatistics);
+
+                bool isNewEntry;
+                taskInfo = this->jobTaskTable.AddJobAndTask(jobId, taskId, affinity, isNewEntry);
+                taskInfo->SetTaskRequeueCount(requeueCount);
+                taskInfo->ProcessKey = processKey;
+                taskInfo->IsPrimaryTask = isPrimaryTask;
+
+                process = std::shared_ptr<Process>(new Process(
+                    jobId,
+                    taskId,
+                    requeueCount,
+                    "Task",
+                    std::string(),
+                    std::string(),
+                    std::string(),
+                    std::string(),
+                    std::string(),
+                    userName,
+                    true,
+                    std::vector<uint64_t>(),
+                    std::map<std::string, std::string>(),
+                    this->GetTaskCompletedCallback(taskInfo, callbackUri)));
+
+                process->ReadState(reader);
+            }
+            else
+            {
+                reader.Skip();
+            }
+        }
+
+        reader.End();
+
+        if (!process)
+        {
+            throw std::runtime_error("no process state found");
+        }
+    }
+    catch (...)
+    {
+        if (taskInfo)
+        {
+            this->jobTaskTable.RemoveTask(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetAttemptId());
+        }
+
+        throw;
+    }
+
+    {
+        WriterLock processesWriterLock(&this->processesLock, &this->processesLockStatistics);
+        this->processes[processKey] = process;
+        this->ReportOverlappingCpusets(processKey);
+    }
+
+    process->Adopt(process).then([jobId, taskId, requeueCount] (std::pair<pid_t, pthread_t> ids)
+    {
+        Logger::Info(jobId, taskId, requeueCount, "Adopted process pid {0}, tid {1}", ids.first, ids.second);
+    });
+
+    return process;
+}
+
+void RemoteExecutor::SaveJobUser(int jobId, const JobUser& jobUser)
+{
+    if (!this->stateJournal)
+    {
+        return;
+    }
+
+    JsonWriter writer(1024);
+    writer.StartObject();
+    writer.Field("JobId", jobId);
+    writer.Field("UserName", std::get<0>(jobUser));
+    writer.Field("Existed", std::get<1>(jobUser));
+    writer.Field("PrivateKeyAdded", std::get<2>(jobUser));
+    writer.Field("PublicKeyAdded", std::get<3>(jobUser));
+    writer.Field("AuthKeyAdded", std::get<4>(jobUser));
+    writer.Field("PublicKey", std::get<5>(jobUser));
+    writer.EndObject();
+
+    this->stateJournal->Append(GetJobUserKey(jobId), writer.GetString());
+}
+
+void RemoteExecutor::SaveTaskState(const TaskInfo& taskInfo, const std::shared_ptr<Process>& process, const std::string& callbackUri)
+{
+    if (!this->stateJournal)
+    {
+        return;
+    }
+
+    JsonWriter writer(1024);
+    writer.StartObject();
+    writer.Field("JobId", taskInfo.JobId);
+    writer.Field("TaskId", taskInfo.TaskId);
+    writer.Field("TaskRequeueCount", taskInfo.GetTaskRequeueCount());
+    writer.Field("ProcessKey", taskInfo.ProcessKey);
+    writer.Field("IsPrimaryTask", taskInfo.IsPrimaryTask);
+    writer.Field("UserName", process->GetUserName());
+    writer.Field("CallbackUri", callbackUri);
+
+    writer.Key("Affinity").StartArray();
+    for (uint64_t a : taskInfo.Affinity) { writer.Value(a); }
+    writer.EndArray();
+
+    writer.Key("Process");
+    process->WriteState(writer);
+    writer.EndObject();
+
+    // the completion acknowledges the state under the same lock when erasing the process,
+    // so a process which has completed already is not saved.
+    ReaderLock readerLock(&this->processesLock, &this->processesLockStatistics);
+
+    auto p = this->processes.find(taskInfo.ProcessKey);
+    if (p != this->processes.end() && p->second == process)
+    {
+        this->stateJournal->Append(GetTaskStateKey(taskInfo.JobId, taskInfo.ProcessKey), writer.GetString());
     }
 }
 
 void RemoteExecutor::StartHeartbeat()
 {
-    WriterLock writerLock(&this->lock);
+    WriterLock writerLock(&this->lock, &this->lockStatistics);
 
     this->nodeInfoReporter =
-        std::unique_ptr<Reporter<json::value>>(
+        std::unique_ptr<Reporter<std::string>>(
             new HttpReporter(
                 "HeartbeatReporter",
                 [](pplx::cancellation_token token) { return NodeManagerConfig::ResolveHeartbeatUri(token); },
                 0,
                 this->NodeInfoReportInterval,
-                [this]() { this->UpdateStatistics(); return this->jobTaskTable.ToJson(); },
+                [this, writer = JsonWriter()]() mutable
+                {
+                    this->UpdateStatistics();
+
+                    // the writer keeps its buffer between the heartbeats.
+                    writer.Clear();
+                    this->jobTaskTable.WriteJson(writer, NodeManagerConfig::GetHeartbeatDelta());
+                    return writer.GetString();
+                },
                 [this](int retryCount) {
                     NamingClient::InvalidateCache();
                     if (retryCount > 2)
                     {
                         this->jobTaskTable.RequestResync();
                     }
-                }));
+                },
+                2,
+                [this](const json::value& response) { this->jobTaskTable.AcknowledgeHeartbeat(response); }));
 
     this->nodeInfoReporter->Start();
 }
 
 void RemoteExecutor::UpdateStatistics()
 {
-    Logger::Info("Update tasks' statistics.");
-
     auto* table = JobTaskTable::GetInstance();
-    if (table != nullptr)
+    if (table != nullptr && this->statisticsAggregator)
     {
+        auto snapshot = this->statisticsAggregator->GetSnapshot();
+        Logger::Info("Update tasks' statistics from the snapshot of {0} processes.", snapshot->size());
+
         auto tasks = table->GetAllTasks();
         for (const auto& taskInfo : tasks)
         {
-            ReaderLock readerLock(&this->lock);
-            auto p = this->processes.find(taskInfo->ProcessKey);
-            if (p != this->processes.end())
+            auto stat = snapshot->find(taskInfo->ProcessKey);
+            if (stat != snapshot->end())
             {
-                taskInfo->AssignFromStat(p->second->GetStatisticsFromCGroup());
+                taskInfo->AssignFromStat(stat->second);
             }
             else
             {
-                Logger::Warn(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "No process object found when updating task statistics.");                   
+                Logger::Debug(taskInfo->JobId, taskInfo->TaskId, taskInfo->GetTaskRequeueCount(), "No statistics sampled yet for the task.");
             }
         }
     }
 }
 
+void RemoteExecutor::StartStatisticsAggregator()
+{
+    int interval = this->DefaultStatisticsSampleInterval;
+
+    try
+    {
+        interval = NodeManagerConfig::GetStatisticsSampleInterval();
+    }
+    catch (...)
+    {
+        Logger::Info("StatisticsSampleInterval not specified or invalid, use the default interval {0} seconds.", interval);
+    }
+
+    this->statisticsAggregator = std::unique_ptr<StatisticsAggregator>(
+        new StatisticsAggregator(
+            [this]()
+            {
+                StatisticsAggregator::ProcessList list;
+
+                ReaderLock readerLock(&this->processesLock, &this->processesLockStatistics);
+                list.reserve(this->processes.size());
+                for (const auto& p : this->processes)
+                {
+                    list.push_back(p);
+                }
+
+                return list;
+            },
+            interval));
+}
+
 void RemoteExecutor::StartHostsManager()
 {
     std::string hostsUri = NodeManagerConfig::GetHostsFileUri();
@@ -662,7 +1249,7 @@ void RemoteExecutor::StartHostsManager()
             interval = MinHostsFetchInterval;
         }
 
-        WriterLock writerLock(&this->lock);
+        WriterLock writerLock(&this->lock, &this->lockStatistics);
 
         this->hostsManager = std::unique_ptr<HostsManager>(new HostsManager([](pplx::cancellation_token token) { return NodeManagerConfig::ResolveHostsFileUri(token); }, interval));
         this->hostsManager->Start();
@@ -675,16 +1262,20 @@ void RemoteExecutor::StartHostsManager()
 
 void RemoteExecutor::StartRegister()
 {
-    WriterLock writerLock(&this->lock);
+    WriterLock writerLock(&this->lock, &this->lockStatistics);
 
     this->registerReporter =
-        std::unique_ptr<Reporter<json::value>>(
+        std::unique_ptr<Reporter<std::string>>(
             new HttpReporter(
                 "RegisterReporter",
                 [](pplx::cancellation_token token) { return NodeManagerConfig::ResolveRegisterUri(token); },
                 3,
                 this->RegisterInterval,
-                [this]() { return this->monitor.GetRegisterInfo(); },
+                [this, writer = JsonWriter()]() mutable
+                {
+                    writer.Clear();
+                    return this->monitor.WriteRegisterInfo(writer) ? writer.GetString() : std::string();
+                },
                 [this](int retryCount) {
                     NamingClient::InvalidateCache();
                     if (retryCount > 2)
@@ -711,7 +1302,7 @@ pplx::task<json::value> RemoteExecutor::Ping(std::string&& callbackUri)
 
 void RemoteExecutor::StartMetric()
 {
-    WriterLock writerLock(&this->lock);
+    WriterLock writerLock(&this->lock, &this->lockStatistics);
 
     std::string uri = NodeManagerConfig::GetMetricUri();
     if (!uri.empty())
@@ -761,68 +1352,105 @@ pplx::task<json::value> RemoteExecutor::MetricConfig(
     return pplx::task_from_result(json::value());
 }
 
-const ProcessStatistics* RemoteExecutor::TerminateTask(
-    int jobId, int taskId, int requeueCount,
-    uint64_t processKey, int exitCode, bool forced, bool mpiDockerTask)
+void RemoteExecutor::StopMpiContainer(int jobId, int taskId, int requeueCount)
 {
-    if (mpiDockerTask)
+    std::string output;
+    int ret = System::ExecuteCommandOut(output, "2>&1 /bin/bash", "StopMpiContainer.sh", taskId);
+    if (ret == 0)
     {
-        std::string output;
-        int ret = System::ExecuteCommandOut(output, "2>&1 /bin/bash", "StopMpiContainer.sh", taskId);
-        if (ret == 0)
-        {
-            Logger::Info(jobId, taskId, requeueCount, "Stop MPI container successfully.");
-        }
-        else
-        {
-            Logger::Error(jobId, taskId, requeueCount, "Stop MPI container failed with exitcode {0}. {1}", ret, output);
-        }
+        Logger::Info(jobId, taskId, requeueCount, "Stop MPI container successfully.");
+    }
+    else
+    {
+        Logger::Error(jobId, taskId, requeueCount, "Stop MPI container failed with exitcode {0}. {1}", ret, output);
+    }
+}
 
-        return nullptr;
+ProcessStatistics RemoteExecutor::TerminateProcess(
+    int jobId, int taskId, int requeueCount,
+    Process& process, int exitCode, bool forced) const
+{
+    Logger::Debug(jobId, taskId, requeueCount, "About to Kill the task, forced {0}.", forced);
+    auto startTime = std::chrono::steady_clock::now();
+    process.Kill(exitCode, forced);
+
+    process.WaitForExit(this->TerminateTimeoutMs);
+    auto stat = process.GetStatisticsFromCGroup();
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    if (!stat.IsTerminated())
+    {
+        Logger::Warn(jobId, taskId, requeueCount,
+            "The task didn't exit within {0}ms, process Ids {1}",
+            elapsedMs, String::Join<' '>(stat.ProcessIds));
+    }
+    else
+    {
+        Logger::Info(jobId, taskId, requeueCount, "The task is terminated in {0}ms", elapsedMs);
     }
 
-    auto p = this->processes.find(processKey);
-//    Logger::Debug(
-//        jobId, taskId, requeueCount,
-//        "TerminateTask for ProcessKey {0}, processes count {1}",
-//        processKey, this->processes.size());
-//
-//    for (auto pro : this->processes)
-//    {
-//        Logger::Debug(
-//            jobId, taskId, requeueCount,
-//            "TerminateTask process list {0}",
-//            pro.first);
-//    }
+    return stat;
+}
 
-    if (p != this->processes.end())
+bool RemoteExecutor::TerminateTask(
+    int jobId, int taskId, int requeueCount,
+    uint64_t processKey, int exitCode, bool forced, bool mpiDockerTask,
+    ProcessStatistics& stat)
+{
+    if (mpiDockerTask)
     {
-        Logger::Debug(jobId, taskId, requeueCount, "About to Kill the task, forced {0}.", forced);
-        p->second->Kill(exitCode, forced);
+        this->StopMpiContainer(jobId, taskId, requeueCount);
+        return false;
+    }
 
-        const auto* stat = &p->second->GetStatisticsFromCGroup();
+    // the process may be erased meanwhile, the reference keeps it alive.
+    auto process = this->FindProcess(processKey);
+    if (process)
+    {
+        stat = this->TerminateProcess(jobId, taskId, requeueCount, *process, exitCode, forced);
+        return true;
+    }
+    else
+    {
+        Logger::Warn(jobId, taskId, requeueCount, "No process object found.");
+        return false;
+    }
+}
 
-        int times = 10;
-        while (!stat->IsTerminated() && times-- > 0)
+void RemoteExecutor::ReportOverlappingCpusets(uint64_t startedProcessKey)
+{
+    // caller holds the processesLock.
+    std::map<int, std::vector<uint64_t>> cpuOwners;
+    for (const auto& p : this->processes)
+    {
+        for (int cpu : p.second->GetCpuSet())
         {
-            sleep(0.1);
-            stat = &p->second->GetStatisticsFromCGroup();
+            cpuOwners[cpu].push_back(p.first);
         }
+    }
+
+    int overlappingCores = 0;
+    std::map<uint64_t, std::vector<int>> sharedWithStarted;
+    for (const auto& owners : cpuOwners)
+    {
+        if (owners.second.size() < 2) continue;
 
-        if (!stat->IsTerminated())
+        overlappingCores++;
+        if (std::find(owners.second.cbegin(), owners.second.cend(), startedProcessKey) == owners.second.cend()) continue;
+
+        for (uint64_t key : owners.second)
         {
-            Logger::Warn(jobId, taskId, requeueCount,
-                "The task didn't exit within 1s, process Ids {0}",
-                String::Join<' '>(stat->ProcessIds));
+            if (key != startedProcessKey) { sharedWithStarted[key].push_back(owners.first); }
         }
-
-        return stat;
     }
-    else
+
+    for (const auto& shared : sharedWithStarted)
     {
-        Logger::Warn(jobId, taskId, requeueCount, "No process object found.");
-        return nullptr;
+        Logger::Warn("Task with process key {0} shares cpus {1} with running process key {2}",
+            startedProcessKey, String::Join<','>(shared.second), shared.first);
     }
+
+    this->jobTaskTable.SetOverlappingCores(overlappingCores);
 }
 
 void RemoteExecutor::ResyncAndInvalidateCache()
@@ -842,13 +1470,12 @@ pplx::task<json::value> RemoteExecutor::PeekTaskOutput(hpc::arguments::PeekTaskO
         if (taskInfo)
         {
             Logger::Debug(args.JobId, args.TaskId, taskInfo->GetTaskRequeueCount(),
-                "PeekTaskOutput for ProcessKey {0}, processes count {1}",
-                taskInfo->ProcessKey, this->processes.size());
+                "PeekTaskOutput for ProcessKey {0}", taskInfo->ProcessKey);
 
-            auto p = this->processes.find(taskInfo->ProcessKey);
-            if (p != this->processes.end())
+            auto process = this->FindProcess(taskInfo->ProcessKey);
+            if (process)
             {
-                output = p->second->PeekOutput();
+                output = process->PeekOutput();
             }
         }
     }
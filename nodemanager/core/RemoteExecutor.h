@@ -3,6 +3,8 @@
 
 #include <set>
 #include <map>
+#include <mutex>
+#include <atomic>
 
 #include "IRemoteExecutor.h"
 #include "JobTaskTable.h"
@@ -10,7 +12,11 @@
 #include "Process.h"
 #include "Reporter.h"
 #include "HostsManager.h"
+#include "StatisticsAggregator.h"
+#include "CompletionDispatcher.h"
 #include "../arguments/MetricCountersConfig.h"
+#include "../utils/LockStatistics.h"
+#include "../utils/Journal.h"
 #include "../data/ProcessStatistics.h"
 
 namespace hpc
@@ -25,7 +31,12 @@ namespace hpc
                 {
                     Logger::Info("Closing the Remote Executor.");
                     this->cts.cancel();
+                    this->statisticsAggregator.reset();
+                    this->completionDispatcher.reset();
+                    this->stateJournal.reset();
                     pthread_rwlock_destroy(&this->lock);
+                    pthread_rwlock_destroy(&this->processesLock);
+                    pthread_rwlock_destroy(&this->usersLock);
                     Logger::Info("Closed the Remote Executor.");
                 }
 
@@ -40,21 +51,89 @@ namespace hpc
 
             protected:
             private:
-                static void* GracePeriodElapsed(void* data);
+                typedef std::tuple<std::string, bool, bool, bool, bool, std::string> JobUser;
+
+                // one per user name, provisioning of the same user is done once at a time.
+                // the key files are written again only when the key fingerprint changes,
+                // and the authorized key lines are reference counted by the jobs using them.
+                struct UserProvisioning
+                {
+                    std::mutex Lock;
+                    std::string KeysFingerprint;
+                    bool PrivateKeyAdded = false;
+                    bool PublicKeyAdded = false;
+                    std::string PublicKey;
+                    std::map<std::string, int> AuthorizedKeyReferences;
+                };
+
+                void ProvisionUser(hpc::arguments::StartJobAndTaskArgs& args);
+                std::function<Process::Callback> GetTaskCompletedCallback(std::shared_ptr<hpc::data::TaskInfo> taskInfo, std::string callbackUri);
+                std::shared_ptr<UserProvisioning> GetUserProvisioning(const std::string& userName);
+                std::shared_ptr<Process> FindProcess(uint64_t processKey);
+
+                void GracePeriodElapsed(int jobId, int taskId, int requeueCount, uint64_t processKey, const std::string& callbackUri);
 
                 void StartRegister();
                 void StartHeartbeat();
                 void UpdateStatistics();
+                void StartStatisticsAggregator();
+                void StartCompletionDispatcher();
+
+                // the running tasks and the job users are journaled, so that a restarted
+                // agent adopts the tasks instead of killing them.
+                void RecoverTasks();
+                void RecoverJobUser(const std::string& state);
+                std::shared_ptr<Process> RecoverTask(const std::string& state);
+                void SaveJobUser(int jobId, const JobUser& jobUser);
+                void SaveTaskState(const hpc::data::TaskInfo& taskInfo, const std::shared_ptr<Process>& process, const std::string& callbackUri);
+                static std::string GetJobUserKey(int jobId) { return String::Join(".", "job", jobId); }
+                static std::string GetTaskStateKey(int jobId, uint64_t processKey) { return String::Join(".", "task", jobId, processKey); }
                 void StartMetric();
                 void StartHostsManager();
 
                 void ResyncAndInvalidateCache();
+                void ReportOverlappingCpusets(uint64_t startedProcessKey = 0);
 
-                const hpc::data::ProcessStatistics* TerminateTask(
+                bool TerminateTask(
                     int jobId, int taskId, int requeueCount,
-                    uint64_t processKey, int exitCode, bool forced, bool mpiDockerTask);
+                    uint64_t processKey, int exitCode, bool forced, bool mpiDockerTask,
+                    hpc::data::ProcessStatistics& stat);
 
-                void ReportTaskCompletion(int jobId, int taskId, int taskRequeueCount, json::value jsonBody, const std::string& callbackUri);
+                hpc::data::ProcessStatistics TerminateProcess(
+                    int jobId, int taskId, int requeueCount,
+                    Process& process, int exitCode, bool forced) const;
+
+                void StopMpiContainer(int jobId, int taskId, int requeueCount);
+                void CleanupJobUser(int jobId);
+
+                // the tasks of an ended job, detached under the lock and terminated outside of it.
+                struct EndingTask
+                {
+                    std::shared_ptr<hpc::data::TaskInfo> Task;
+                    std::shared_ptr<Process> TaskProcess;
+                    int TaskId;
+                    int RequeueCount;
+                    bool IsPrimaryTask;
+                    bool Terminated = false;
+                    hpc::data::ProcessStatistics Stat;
+                };
+
+                // the terminations wait for the processes to exit, so they run on their own
+                // threads instead of blocking the threads of the task pool.
+                struct EndingJob
+                {
+                    RemoteExecutor* Executor;
+                    int JobId;
+                    std::vector<EndingTask> Tasks;
+                    std::atomic<size_t> Next;
+                    std::atomic<int> Running;
+                    pplx::task_completion_event<void> Terminated;
+                };
+
+                static void* EndingThread(void* arg);
+                static void TerminateEndingTasks(EndingJob& ending);
+
+                void ReportTaskCompletion(int jobId, int taskId, int taskRequeueCount, std::string&& jsonBody, const std::string& callbackUri);
 
                 const int UnknowId = 999;
                 const int NodeInfoReportInterval = 30;
@@ -62,19 +141,43 @@ namespace hpc
                 const int RegisterInterval = 300;
                 const int DefaultHostsFetchInterval = 300;
                 const int MinHostsFetchInterval = 30;
+                const int DefaultStatisticsSampleInterval = 10;
+                const int TerminateTimeoutMs = 1000;
+                const int EndJobParallelism = 16;
+                const int DefaultCompletionCoalesceMs = 50;
+                const int DefaultCompletionOutboxSizeMb = 16;
+                const int StateJournalSizeMb = 16;
 
                 JobTaskTable jobTaskTable;
                 Monitor monitor;
 
-                std::unique_ptr<Reporter<json::value>> nodeInfoReporter;
-                std::unique_ptr<Reporter<json::value>> registerReporter;
+                std::unique_ptr<Reporter<std::string>> nodeInfoReporter;
+                std::unique_ptr<Reporter<std::string>> registerReporter;
                 std::unique_ptr<Reporter<std::vector<std::vector<unsigned char>>>> metricReporter;
                 std::unique_ptr<HostsManager> hostsManager;
+                std::unique_ptr<StatisticsAggregator> statisticsAggregator;
+                std::unique_ptr<CompletionDispatcher> completionDispatcher;
+                std::unique_ptr<hpc::utils::Journal> stateJournal;
 
+                // lock order: lock before usersLock and processesLock, a UserProvisioning::Lock before usersLock.
+                // none of them is held across user provisioning, process termination or callbacks.
+
+                // guarded by processesLock
                 std::map<uint64_t, std::shared_ptr<Process>> processes;
-                std::map<int, std::tuple<std::string, bool, bool, bool, bool, std::string>> jobUsers;
+
+                // guarded by usersLock
+                std::map<int, JobUser> jobUsers;
                 std::map<std::string, std::set<int>> userJobs;
+                std::map<std::string, std::shared_ptr<UserProvisioning>> userProvisionings;
+
+                // the task state transitions and the reporters.
                 pthread_rwlock_t lock;
+                pthread_rwlock_t processesLock;
+                pthread_rwlock_t usersLock;
+
+                hpc::utils::LockStatistics lockStatistics;
+                hpc::utils::LockStatistics processesLockStatistics;
+                hpc::utils::LockStatistics usersLockStatistics;
 
                 pplx::cancellation_token_source cts;
         };
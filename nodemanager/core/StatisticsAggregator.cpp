@@ -0,0 +1,77 @@
+#include "StatisticsAggregator.h"
+#include "../utils/Logger.h"
+#include "../utils/ReaderLock.h"
+#include "../utils/WriterLock.h"
+
+using namespace hpc::core;
+using namespace hpc::utils;
+using namespace hpc::data;
+
+StatisticsAggregator::StatisticsAggregator(std::function<ProcessList()> fetcher, int interval)
+    : processesFetcher(fetcher), intervalSeconds(interval), snapshot(std::make_shared<const Snapshot>())
+{
+    int result = pthread_create(&this->threadId, nullptr, SamplingThread, this);
+    if (result != 0)
+    {
+        Logger::Error("Create statistics sampling thread result {0}, errno {1}", result, errno);
+        this->threadId = 0;
+    }
+}
+
+StatisticsAggregator::~StatisticsAggregator()
+{
+    // not cancelled, the sampling thread holds process locks while reading.
+    this->isRunning = false;
+    if (this->threadId != 0)
+    {
+        pthread_join(this->threadId, nullptr);
+    }
+
+    pthread_rwlock_destroy(&this->lock);
+}
+
+std::shared_ptr<const StatisticsAggregator::Snapshot> StatisticsAggregator::GetSnapshot()
+{
+    ReaderLock readerLock(&this->lock);
+    return this->snapshot;
+}
+
+void* StatisticsAggregator::SamplingThread(void* arg)
+{
+    StatisticsAggregator* const a = static_cast<StatisticsAggregator* const>(arg);
+
+    while (a->isRunning)
+    {
+        try
+        {
+            a->Sample();
+        }
+        catch (const std::exception& ex)
+        {
+            Logger::Error("Exception happened when sampling statistics, ex = {0}", ex.what());
+        }
+
+        for (int i = 0; i < a->intervalSeconds && a->isRunning; i++)
+        {
+            sleep(1);
+        }
+    }
+
+    return nullptr;
+}
+
+void StatisticsAggregator::Sample()
+{
+    auto processes = this->processesFetcher();
+
+    auto sampled = std::make_shared<Snapshot>();
+    for (const auto& p : processes)
+    {
+        sampled->emplace(p.first, p.second->GetStatisticsFromCGroup());
+    }
+
+    Logger::Debug("Sampled statistics of {0} processes", sampled->size());
+
+    WriterLock writerLock(&this->lock);
+    this->snapshot = std::move(sampled);
+}
@@ -0,0 +1,52 @@
+#ifndef STATISTICSAGGREGATOR_H
+#define STATISTICSAGGREGATOR_H
+
+#include <map>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <pthread.h>
+
+#include "Process.h"
+#include "../data/ProcessStatistics.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Samples the statistics of all the running processes on its own thread,
+        /// and publishes them as a snapshot keyed by the process key.
+        class StatisticsAggregator
+        {
+            public:
+                typedef std::map<uint64_t, hpc::data::ProcessStatistics> Snapshot;
+                typedef std::vector<std::pair<uint64_t, std::shared_ptr<Process>>> ProcessList;
+
+                StatisticsAggregator(std::function<ProcessList()> fetcher, int interval);
+                ~StatisticsAggregator();
+
+                StatisticsAggregator(const StatisticsAggregator&) = delete;
+                StatisticsAggregator& operator=(const StatisticsAggregator&) = delete;
+
+                /// The latest snapshot, never null.
+                std::shared_ptr<const Snapshot> GetSnapshot();
+
+            protected:
+            private:
+                static void* SamplingThread(void* arg);
+                void Sample();
+
+                std::function<ProcessList()> processesFetcher;
+                int intervalSeconds;
+
+                std::shared_ptr<const Snapshot> snapshot;
+
+                pthread_t threadId = 0;
+                std::atomic<bool> isRunning { true };
+                pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+        };
+    }
+}
+
+#endif // STATISTICSAGGREGATOR_H
@@ -0,0 +1,136 @@
+#include <chrono>
+
+#include "TaskTracer.h"
+#include "NodeManagerConfig.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+using namespace web;
+
+std::mutex TaskTracer::lock;
+std::map<TaskTracer::Key, TaskTracer::Entry> TaskTracer::traces;
+std::list<TaskTracer::Key> TaskTracer::order;
+std::array<std::array<uint64_t, TaskTracer::BucketCount>, (size_t)TracePhase::Count> TaskTracer::histograms { };
+
+uint64_t TaskTracer::NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+long TaskTracer::GetThresholdMs()
+{
+    static long thresholdMs = []()
+    {
+        long ms = 5000l;
+        try
+        {
+            ms = NodeManagerConfig::GetStartupTraceThresholdMs();
+        }
+        catch (...)
+        {
+            Logger::Debug("StartupTraceThresholdMs not specified or invalid, use the default value {0} ms.", ms);
+        }
+
+        return ms;
+    }();
+
+    return thresholdMs;
+}
+
+void TaskTracer::Mark(int jobId, int taskId, int requeueCount, TracePhase phase)
+{
+    uint64_t now = NowUs();
+    std::lock_guard<std::mutex> guard(lock);
+
+    Key key(jobId, taskId, requeueCount);
+    auto it = traces.find(key);
+    if (it == traces.end())
+    {
+        // drop the oldest attempts which never completed.
+        if (traces.size() >= MaxTraces)
+        {
+            traces.erase(order.front());
+            order.pop_front();
+        }
+
+        it = traces.emplace(key, Entry()).first;
+        it->second.Order = order.insert(order.end(), key);
+    }
+
+    it->second.Trace.Mark(phase, now);
+}
+
+std::string TaskTracer::GetSlowStartupBreakdown(int jobId, int taskId, int requeueCount)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = traces.find(Key(jobId, taskId, requeueCount));
+    if (it == traces.end() || !it->second.Trace.IsMarked(TracePhase::Executed))
+    {
+        return std::string();
+    }
+
+    uint64_t startupMs = it->second.Trace.Get(TracePhase::Executed) / 1000;
+    if (startupMs <= (uint64_t)GetThresholdMs())
+    {
+        return std::string();
+    }
+
+    return String::Join("", "Task startup took ", startupMs, "ms: ", it->second.Trace.ToString());
+}
+
+void TaskTracer::Complete(int jobId, int taskId, int requeueCount)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = traces.find(Key(jobId, taskId, requeueCount));
+    if (it == traces.end()) return;
+
+    const auto& trace = it->second.Trace;
+    uint64_t previous = 0;
+    for (size_t i = 0; i < trace.OffsetsUs.size(); i++)
+    {
+        if (trace.OffsetsUs[i] == 0) continue;
+
+        uint64_t delta = trace.OffsetsUs[i] - std::min(previous, trace.OffsetsUs[i]);
+        int bucket = 0;
+        while (delta > 0 && bucket < BucketCount - 1) { delta >>= 1; bucket++; }
+
+        histograms[i][bucket]++;
+        previous = trace.OffsetsUs[i];
+    }
+
+    Logger::Debug(jobId, taskId, requeueCount, "Startup trace: {0}", trace.ToString());
+
+    order.erase(it->second.Order);
+    traces.erase(it);
+}
+
+json::value TaskTracer::HistogramsToJson()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    json::value j;
+    for (size_t i = 0; i < histograms.size(); i++)
+    {
+        json::value phase;
+        uint64_t count = 0;
+        for (int b = 0; b < BucketCount; b++)
+        {
+            if (histograms[i][b] == 0) continue;
+
+            count += histograms[i][b];
+            phase[String::Join("", "<", 1ull << b, "us")] = json::value::number(histograms[i][b]);
+        }
+
+        phase["Count"] = json::value::number(count);
+        j[TaskTrace::GetPhaseName((TracePhase)i)] = phase;
+    }
+
+    j["RunningTraces"] = json::value::number((uint64_t)traces.size());
+
+    return j;
+}
@@ -0,0 +1,59 @@
+#ifndef TASKTRACER_H
+#define TASKTRACER_H
+
+#include <map>
+#include <list>
+#include <array>
+#include <tuple>
+#include <mutex>
+#include <cpprest/json.h>
+
+#include "../data/TaskTrace.h"
+
+namespace hpc
+{
+    namespace core
+    {
+        /// Keeps the startup trace of the running task attempts and the
+        /// per-phase latency histograms of the finished ones.
+        class TaskTracer
+        {
+            public:
+                static void Mark(int jobId, int taskId, int requeueCount, hpc::data::TracePhase phase);
+
+                /// The phase breakdown when the time from RequestReceived to Executed
+                /// exceeds StartupTraceThresholdMs, otherwise empty.
+                static std::string GetSlowStartupBreakdown(int jobId, int taskId, int requeueCount);
+
+                /// Adds the trace to the histograms and forgets the attempt.
+                static void Complete(int jobId, int taskId, int requeueCount);
+
+                static web::json::value HistogramsToJson();
+
+            protected:
+            private:
+                typedef std::tuple<int, int, int> Key;
+
+                // bucket n counts the deltas in [2^(n-1), 2^n) microseconds.
+                static const int BucketCount = 32;
+                static const size_t MaxTraces = 4096;
+
+                static uint64_t NowUs();
+                static long GetThresholdMs();
+
+                static std::mutex lock;
+                // the attempts in the order they started, the oldest is dropped first when full.
+                struct Entry
+                {
+                    hpc::data::TaskTrace Trace;
+                    std::list<Key>::iterator Order;
+                };
+
+                static std::map<Key, Entry> traces;
+                static std::list<Key> order;
+                static std::array<std::array<uint64_t, BucketCount>, (size_t)hpc::data::TracePhase::Count> histograms;
+        };
+    }
+}
+
+#endif // TASKTRACER_H
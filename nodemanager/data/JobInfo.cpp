@@ -1,7 +1,10 @@
+#include <algorithm>
+
 #include "JobInfo.h"
 
 using namespace web;
 using namespace hpc::data;
+using namespace hpc::utils;
 
 json::value JobInfo::ToJson() const
 {
@@ -17,3 +20,43 @@ json::value JobInfo::ToJson() const
 
     return std::move(j);
 }
+
+void JobInfo::WriteJson(JsonWriter& writer) const
+{
+    writer.StartObject();
+    writer.Field("JobId", this->JobId);
+
+    writer.Key("Tasks").StartArray();
+    for (const auto& t : this->Tasks)
+    {
+        t.second->WriteJson(writer);
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+}
+
+bool JobInfo::WriteDeltaJson(JsonWriter& writer, uint64_t sinceVersion) const
+{
+    if (std::none_of(this->Tasks.cbegin(), this->Tasks.cend(), [sinceVersion](const auto& t) { return t.second->Version > sinceVersion; }))
+    {
+        return false;
+    }
+
+    writer.StartObject();
+    writer.Field("JobId", this->JobId);
+
+    writer.Key("Tasks").StartArray();
+    for (const auto& t : this->Tasks)
+    {
+        if (t.second->Version > sinceVersion)
+        {
+            t.second->WriteJson(writer);
+        }
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+
+    return true;
+}
@@ -16,6 +16,10 @@ namespace hpc
                 JobInfo(int jobId) : JobId(jobId) { }
 
                 web::json::value ToJson() const;
+                void WriteJson(hpc::utils::JsonWriter& writer) const;
+
+                // only the tasks changed after the version, nothing is written when there is none.
+                bool WriteDeltaJson(hpc::utils::JsonWriter& writer, uint64_t sinceVersion) const;
 
                 int JobId;
                 std::map<int, std::shared_ptr<TaskInfo>> Tasks;
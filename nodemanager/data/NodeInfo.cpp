@@ -10,20 +10,36 @@ NodeInfo::NodeInfo()
     this->Name = System::GetNodeName();
 }
 
-json::value NodeInfo::ToJson()
+void NodeInfo::WriteJsonFields(JsonWriter& writer)
 {
-    json::value j;
-    j["Availability"] = json::value::number((int)this->Availability);
-    j["JustStarted"] = this->JustStarted;
-    j["MacAddress"] = json::value::string(this->MacAddress);
-    j["Name"] = json::value::string(this->Name);
+    writer.Field("Availability", (int)this->Availability);
+    writer.Field("JustStarted", this->JustStarted);
+    writer.Field("MacAddress", this->MacAddress);
+    writer.Field("Name", this->Name);
 
-    std::vector<json::value> jobs;
+    writer.Key("Jobs").StartArray();
+    for (const auto& job : this->Jobs)
+    {
+        job.second->WriteJson(writer);
+    }
 
-    std::transform(this->Jobs.cbegin(), this->Jobs.cend(), std::back_inserter(jobs), [](auto i) { return i.second->ToJson(); });
-
-    j["Jobs"] = json::value::array(jobs);
+    writer.EndArray();
 
     this->JustStarted = false;
-    return std::move(j);
+}
+
+void NodeInfo::WriteDeltaJsonFields(JsonWriter& writer, uint64_t sinceVersion)
+{
+    writer.Field("Availability", (int)this->Availability);
+    writer.Field("JustStarted", false);
+    writer.Field("MacAddress", this->MacAddress);
+    writer.Field("Name", this->Name);
+
+    writer.Key("Jobs").StartArray();
+    for (const auto& job : this->Jobs)
+    {
+        job.second->WriteDeltaJson(writer, sinceVersion);
+    }
+
+    writer.EndArray();
 }
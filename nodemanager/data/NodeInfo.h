@@ -23,7 +23,9 @@ namespace hpc
             public:
                 NodeInfo();
 
-                web::json::value ToJson();
+                // the fields of the heartbeat object, the caller writes the braces and its own fields.
+                void WriteJsonFields(hpc::utils::JsonWriter& writer);
+                void WriteDeltaJsonFields(hpc::utils::JsonWriter& writer, uint64_t sinceVersion);
 
                 NodeAvailability Availability = NodeAvailability::AlwaysOn;
                 bool JustStarted = true;
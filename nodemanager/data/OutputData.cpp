@@ -1,12 +1,13 @@
 #include "OutputData.h"
 
-json::value OutputData::ToJson() const
-{
-    json::value j;
-    j["NodeName"] = json::value::string(this->NodeName);
-    j["Order"] = this->Order;
-    j["Content"] = json::value::string(this->Content);
-    j["Eof"] = this->Eof;
+using namespace hpc::utils;
 
-    return std::move(j);
+void OutputData::WriteJson(JsonWriter& writer) const
+{
+    writer.StartObject();
+    writer.Field("NodeName", this->NodeName);
+    writer.Field("Order", this->Order);
+    writer.Field("Content", this->Content);
+    writer.Field("Eof", this->Eof);
+    writer.EndObject();
 }
@@ -1,10 +1,9 @@
 #ifndef OUTPUTDATA_H
 #define OUTPUTDATA_H
 
-#include <cpprest/json.h>
 #include <string>
 
-using namespace web;
+#include "../utils/JsonWriter.h"
 
 class OutputData
 {
@@ -14,7 +13,7 @@ class OutputData
         {
         }
 
-        json::value ToJson() const;
+        void WriteJson(hpc::utils::JsonWriter& writer) const;
 
         std::string NodeName;
         int Order;
@@ -13,6 +13,30 @@ namespace hpc
             uint64_t UserTimeMs = 0;
             uint64_t KernelTimeMs = 0;
             uint64_t WorkingSetKb = 0;
+            uint64_t NumaLocalPages = 0;
+            uint64_t NumaRemotePages = 0;
+            uint64_t OomKillCount = 0;
+            uint64_t ThrottledCount = 0;
+            uint64_t RssKb = 0;
+            uint64_t PageCacheKb = 0;
+            uint64_t MajorFaults = 0;
+            // the time at least one process was stalled, from cgroup v2 PSI.
+            uint64_t CpuStallMs = 0;
+            uint64_t MemoryStallMs = 0;
+            uint64_t IoStallMs = 0;
+            // over the downsampled RSS history of the task.
+            uint64_t RssP50Kb = 0;
+            uint64_t RssP95Kb = 0;
+            uint64_t IoReadBytes = 0;
+            uint64_t IoWriteBytes = 0;
+            uint64_t IoReadOps = 0;
+            uint64_t IoWriteOps = 0;
+            // the rates between the last two samples.
+            uint64_t IoReadIops = 0;
+            uint64_t IoWriteIops = 0;
+            // only for the tasks in their own network namespace, such as docker tasks.
+            uint64_t NetworkReceivedBytes = 0;
+            uint64_t NetworkSentBytes = 0;
             std::vector<int> ProcessIds;
 
             int GetProcessCount() const { return this->ProcessIds.size(); }
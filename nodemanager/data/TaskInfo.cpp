@@ -1,3 +1,5 @@
+#include <boost/functional/hash.hpp>
+
 #include "TaskInfo.h"
 #include "../utils/JsonHelper.h"
 #include "../utils/String.h"
@@ -8,6 +10,7 @@ using namespace hpc::utils;
 
 json::value TaskInfo::ToJson() const
 {
+    // built directly for the EndJob and EndTask responses, the same fields as WriteFields.
     json::value j;
 
     j["TaskId"] = this->TaskId;
@@ -18,23 +21,80 @@ json::value TaskInfo::ToJson() const
     j["UserProcessorTime"] = this->UserProcessorTimeMs;
     j["WorkingSet"] = this->WorkingSetKb;
     j["NumberOfProcesses"] = this->GetProcessCount();
+    j["NumaLocalPages"] = this->NumaLocalPages;
+    j["NumaRemotePages"] = this->NumaRemotePages;
+    j["OomKillCount"] = this->OomKillCount;
+    j["CpuThrottledCount"] = this->CpuThrottledCount;
+    j["IoReadBytes"] = this->IoReadBytes;
+    j["IoWriteBytes"] = this->IoWriteBytes;
+    j["IoReadOps"] = this->IoReadOps;
+    j["IoWriteOps"] = this->IoWriteOps;
+    j["IoReadIops"] = this->IoReadIops;
+    j["IoWriteIops"] = this->IoWriteIops;
+    j["NetworkReceivedBytes"] = this->NetworkReceivedBytes;
+    j["NetworkSentBytes"] = this->NetworkSentBytes;
     j["PrimaryTask"] = this->IsPrimaryTask;
     j["Message"] = JsonHelper<std::string>::ToJson(this->Message);
     j["ProcessIds"] = JsonHelper<std::string>::ToJson(String::Join<','>(this->ProcessIds));
 
-    return j;
+    return std::move(j);
+}
+
+void TaskInfo::WriteJson(JsonWriter& writer) const
+{
+    writer.StartObject();
+    this->WriteFields(writer);
+    writer.EndObject();
+}
+
+void TaskInfo::WriteFields(JsonWriter& writer) const
+{
+    writer.Field("TaskId", this->TaskId);
+    writer.Field("TaskRequeueCount", this->taskRequeueCount);
+    writer.Field("ExitCode", this->ExitCode);
+    writer.Field("Exited", this->Exited);
+    writer.Field("KernelProcessorTime", this->KernelProcessorTimeMs);
+    writer.Field("UserProcessorTime", this->UserProcessorTimeMs);
+    writer.Field("WorkingSet", this->WorkingSetKb);
+    writer.Field("NumberOfProcesses", this->GetProcessCount());
+    writer.Field("NumaLocalPages", this->NumaLocalPages);
+    writer.Field("NumaRemotePages", this->NumaRemotePages);
+    writer.Field("OomKillCount", this->OomKillCount);
+    writer.Field("CpuThrottledCount", this->CpuThrottledCount);
+    writer.Field("IoReadBytes", this->IoReadBytes);
+    writer.Field("IoWriteBytes", this->IoWriteBytes);
+    writer.Field("IoReadOps", this->IoReadOps);
+    writer.Field("IoWriteOps", this->IoWriteOps);
+    writer.Field("IoReadIops", this->IoReadIops);
+    writer.Field("IoWriteIops", this->IoWriteIops);
+    writer.Field("NetworkReceivedBytes", this->NetworkReceivedBytes);
+    writer.Field("NetworkSentBytes", this->NetworkSentBytes);
+    writer.Field("PrimaryTask", this->IsPrimaryTask);
+    writer.Field("Message", this->Message);
+    writer.Field("ProcessIds", String::Join<','>(this->ProcessIds));
 }
 
-json::value TaskInfo::ToCompletionEventArgJson() const
+void TaskInfo::WriteCompletionEventArgJson(JsonWriter& writer) const
 {
-    json::value j = this->ToJson();
+    writer.StartObject();
+    writer.Field("JobId", this->JobId);
 
-    json::value jobIdArg;
-    jobIdArg["JobId"] = this->JobId;
-    jobIdArg["TaskInfo"] = j;
-    jobIdArg["NodeName"] = json::value::string(this->NodeName);
+    writer.Key("TaskInfo").StartObject();
+    this->WriteFields(writer);
 
-    return jobIdArg;
+    // the memory and stall summary is only useful once the task is done.
+    writer.Field("Rss", this->RssKb);
+    writer.Field("PageCache", this->PageCacheKb);
+    writer.Field("MajorFaults", this->MajorFaults);
+    writer.Field("RssP50", this->RssP50Kb);
+    writer.Field("RssP95", this->RssP95Kb);
+    writer.Field("CpuStallTime", this->CpuStallMs);
+    writer.Field("MemoryStallTime", this->MemoryStallMs);
+    writer.Field("IoStallTime", this->IoStallMs);
+    writer.EndObject();
+
+    writer.Field("NodeName", this->NodeName);
+    writer.EndObject();
 }
 
 void TaskInfo::AssignFromStat(const ProcessStatistics& stat)
@@ -43,4 +103,53 @@ void TaskInfo::AssignFromStat(const ProcessStatistics& stat)
     this->UserProcessorTimeMs = stat.UserTimeMs;
     this->ProcessIds = stat.ProcessIds;
     this->WorkingSetKb = stat.WorkingSetKb;
+    this->NumaLocalPages = stat.NumaLocalPages;
+    this->NumaRemotePages = stat.NumaRemotePages;
+    this->OomKillCount = stat.OomKillCount;
+    this->CpuThrottledCount = stat.ThrottledCount;
+    this->RssKb = stat.RssKb;
+    this->PageCacheKb = stat.PageCacheKb;
+    this->MajorFaults = stat.MajorFaults;
+    this->CpuStallMs = stat.CpuStallMs;
+    this->MemoryStallMs = stat.MemoryStallMs;
+    this->IoStallMs = stat.IoStallMs;
+    this->RssP50Kb = stat.RssP50Kb;
+    this->RssP95Kb = stat.RssP95Kb;
+    this->IoReadBytes = stat.IoReadBytes;
+    this->IoWriteBytes = stat.IoWriteBytes;
+    this->IoReadOps = stat.IoReadOps;
+    this->IoWriteOps = stat.IoWriteOps;
+    this->IoReadIops = stat.IoReadIops;
+    this->IoWriteIops = stat.IoWriteIops;
+    this->NetworkReceivedBytes = stat.NetworkReceivedBytes;
+    this->NetworkSentBytes = stat.NetworkSentBytes;
+}
+
+size_t TaskInfo::GetReportedHash() const
+{
+    size_t hash = 0;
+
+    boost::hash_combine(hash, this->taskRequeueCount);
+    boost::hash_combine(hash, this->ExitCode);
+    boost::hash_combine(hash, this->Exited);
+    boost::hash_combine(hash, this->KernelProcessorTimeMs);
+    boost::hash_combine(hash, this->UserProcessorTimeMs);
+    boost::hash_combine(hash, this->WorkingSetKb);
+    boost::hash_combine(hash, this->NumaLocalPages);
+    boost::hash_combine(hash, this->NumaRemotePages);
+    boost::hash_combine(hash, this->OomKillCount);
+    boost::hash_combine(hash, this->CpuThrottledCount);
+    boost::hash_combine(hash, this->IoReadBytes);
+    boost::hash_combine(hash, this->IoWriteBytes);
+    boost::hash_combine(hash, this->IoReadOps);
+    boost::hash_combine(hash, this->IoWriteOps);
+    boost::hash_combine(hash, this->IoReadIops);
+    boost::hash_combine(hash, this->IoWriteIops);
+    boost::hash_combine(hash, this->NetworkReceivedBytes);
+    boost::hash_combine(hash, this->NetworkSentBytes);
+    boost::hash_combine(hash, this->IsPrimaryTask);
+    boost::hash_combine(hash, this->Message);
+    boost::hash_range(hash, this->ProcessIds.cbegin(), this->ProcessIds.cend());
+
+    return hash;
 }
@@ -7,6 +7,8 @@
 #include <memory>
 
 #include "../utils/Logger.h"
+#include "../utils/TimerWheel.h"
+#include "../utils/JsonWriter.h"
 #include "../data/ProcessStatistics.h"
 
 using namespace hpc::utils;
@@ -25,24 +27,24 @@ namespace hpc
 
                 ~TaskInfo()
                 {
-                    this->CancelGracefulThread();
+                    this->CancelGraceTimer();
                 }
 
-                void CancelGracefulThread()
+                void CancelGraceTimer()
                 {
-                    if (this->GracefulThreadId)
+                    if (this->GraceTimerId)
                     {
-                        pthread_cancel(this->GracefulThreadId);
-                        pthread_join(this->GracefulThreadId, nullptr);
-                        Logger::Debug("Destructed TaskInfo GracefulThread {0}", this->GracefulThreadId);
-                        this->GracefulThreadId = 0;
+                        bool cancelled = TimerWheel::GetInstance().Cancel(this->GraceTimerId);
+                        Logger::Debug("Cancel TaskInfo grace timer {0}, cancelled {1}", this->GraceTimerId, cancelled);
+                        this->GraceTimerId = 0;
                     }
                 }
 
                 TaskInfo(TaskInfo&& t) = default;
 
                 web::json::value ToJson() const;
-                web::json::value ToCompletionEventArgJson() const;
+                void WriteJson(hpc::utils::JsonWriter& writer) const;
+                void WriteCompletionEventArgJson(hpc::utils::JsonWriter& writer) const;
 
                 const std::string& NodeName;
 
@@ -83,6 +85,9 @@ namespace hpc
 
                 void AssignFromStat(const ProcessStatistics& stat);
 
+                // hash of the fields in ToJson, the job task table bumps Version when it changes.
+                size_t GetReportedHash() const;
+
                 int JobId;
                 int TaskId;
                 int ExitCode = 0;
@@ -90,6 +95,26 @@ namespace hpc
                 uint64_t KernelProcessorTimeMs = 0;
                 uint64_t UserProcessorTimeMs = 0;
                 uint64_t WorkingSetKb = 0;
+                uint64_t NumaLocalPages = 0;
+                uint64_t NumaRemotePages = 0;
+                uint64_t OomKillCount = 0;
+                uint64_t CpuThrottledCount = 0;
+                uint64_t RssKb = 0;
+                uint64_t PageCacheKb = 0;
+                uint64_t MajorFaults = 0;
+                uint64_t CpuStallMs = 0;
+                uint64_t MemoryStallMs = 0;
+                uint64_t IoStallMs = 0;
+                uint64_t RssP50Kb = 0;
+                uint64_t RssP95Kb = 0;
+                uint64_t IoReadBytes = 0;
+                uint64_t IoWriteBytes = 0;
+                uint64_t IoReadOps = 0;
+                uint64_t IoWriteOps = 0;
+                uint64_t IoReadIops = 0;
+                uint64_t IoWriteIops = 0;
+                uint64_t NetworkReceivedBytes = 0;
+                uint64_t NetworkSentBytes = 0;
                 bool IsPrimaryTask = true;
                 uint64_t ProcessKey;
 
@@ -97,9 +122,14 @@ namespace hpc
                 std::vector<int> ProcessIds;
                 std::vector<uint64_t> Affinity;
 
-                pthread_t GracefulThreadId = 0;
+                hpc::utils::TimerWheel::TimerId GraceTimerId = 0;
+
+                uint64_t Version = 0;
+                size_t ReportedHash = 0;
             protected:
             private:
+                void WriteFields(hpc::utils::JsonWriter& writer) const;
+
                 int taskRequeueCount = 0;
                 bool processKeySet = false;
 
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <sstream>
+
+#include "TaskTrace.h"
+
+using namespace hpc::data;
+
+std::string TaskTrace::ToString() const
+{
+    std::ostringstream oss;
+    uint64_t previous = 0;
+    bool first = true;
+
+    for (size_t i = 0; i < this->OffsetsUs.size(); i++)
+    {
+        if (this->OffsetsUs[i] == 0) continue;
+
+        if (!first) { oss << ", "; }
+        first = false;
+        oss << GetPhaseName((TracePhase)i) << " +" << (this->OffsetsUs[i] - std::min(previous, this->OffsetsUs[i])) << "us";
+        previous = this->OffsetsUs[i];
+    }
+
+    return oss.str();
+}
+
+const char* TaskTrace::GetPhaseName(TracePhase phase)
+{
+    static const char* names[] =
+    {
+        "RequestReceived",
+        "FilterStarted",
+        "FilterEnded",
+        "UserProvisioned",
+        "TaskFolderCreated",
+        "TaskPrepared",
+        "Forked",
+        "MutualTrustChecked",
+        "Executed",
+        "FirstOutput",
+        "Exited",
+        "StatisticsCollected",
+        "CleanedUp",
+        "CompletionAcknowledged",
+    };
+
+    return (size_t)phase < sizeof(names) / sizeof(names[0]) ? names[(size_t)phase] : "Unknown";
+}
@@ -0,0 +1,58 @@
+#ifndef TASKTRACE_H
+#define TASKTRACE_H
+
+#include <array>
+#include <algorithm>
+#include <string>
+#include <inttypes.h>
+
+namespace hpc
+{
+    namespace data
+    {
+        enum class TracePhase
+        {
+            RequestReceived,
+            FilterStarted,
+            FilterEnded,
+            UserProvisioned,
+            TaskFolderCreated,
+            TaskPrepared,
+            Forked,
+            MutualTrustChecked,
+            Executed,
+            FirstOutput,
+            Exited,
+            StatisticsCollected,
+            CleanedUp,
+            CompletionAcknowledged,
+            Count
+        };
+
+        /// Monotonic timestamps of the phases of one task attempt, in microseconds
+        /// after RequestReceived, 0 for the phases not reached.
+        struct TaskTrace
+        {
+            uint64_t StartUs = 0;
+            std::array<uint64_t, (size_t)TracePhase::Count> OffsetsUs { };
+
+            void Mark(TracePhase phase, uint64_t nowUs)
+            {
+                if (this->StartUs == 0) { this->StartUs = nowUs; }
+
+                // keep it non-zero for the phases reached in the same microsecond.
+                this->OffsetsUs[(size_t)phase] = std::max<uint64_t>(nowUs - this->StartUs, 1);
+            }
+
+            bool IsMarked(TracePhase phase) const { return this->OffsetsUs[(size_t)phase] != 0; }
+            uint64_t Get(TracePhase phase) const { return this->OffsetsUs[(size_t)phase]; }
+
+            /// e.g. "FilterStarted +12us, FilterEnded +2013us, ..." with the delta to the previous phase reached.
+            std::string ToString() const;
+
+            static const char* GetPhaseName(TracePhase phase);
+        };
+    }
+}
+
+#endif // TASKTRACE_H
@@ -1,3 +1,5 @@
+#include <unistd.h>
+
 #include "ExecutionFilter.h"
 #include "FilterException.h"
 #include "../utils/Logger.h"
@@ -11,22 +13,36 @@ using namespace hpc::utils;
 using namespace hpc::common;
 using namespace hpc::data;
 
-pplx::task<json::value> ExecutionFilter::OnJobStart(int jobId, int taskId, int requeueCount, const json::value& input) const
+pplx::task<std::string> ExecutionFilter::OnJobStart(int jobId, int taskId, int requeueCount, const std::string& input) const
 {
     return this->ExecuteFilter(JobStartFilter, jobId, taskId, requeueCount, input);
 }
 
 pplx::task<json::value> ExecutionFilter::OnJobEnd(int jobId, const json::value& input) const
 {
-    return this->ExecuteFilter(JobEndFilter, jobId, 0, 0, input);
+    if (!this->HasFilter(JobEndFilter))
+    {
+        return pplx::task_from_result(input);
+    }
+
+    return this->ExecuteFilter(JobEndFilter, jobId, 0, 0, input.serialize()).then([] (std::string output)
+    {
+        return json::value::parse(output);
+    });
 }
 
-pplx::task<json::value> ExecutionFilter::OnTaskStart(int jobId, int taskId, int requeueCount, const json::value& input) const
+pplx::task<std::string> ExecutionFilter::OnTaskStart(int jobId, int taskId, int requeueCount, const std::string& input) const
 {
     return this->ExecuteFilter(TaskStartFilter, jobId, taskId, requeueCount, input);
 }
 
-pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const json::value& input) const
+bool ExecutionFilter::HasFilter(const std::string& filterType) const
+{
+    auto filterIt = this->filterFiles.find(filterType);
+    return filterIt != this->filterFiles.end() && access(filterIt->second.c_str(), R_OK) == 0;
+}
+
+pplx::task<std::string> ExecutionFilter::ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const std::string& input) const
 {
     auto filterIt = this->filterFiles.find(filterType);
     if (filterIt == this->filterFiles.end())
@@ -72,7 +88,7 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
 #endif // DEBUG
 
     std::string stdinFile = folderString + "/stdin.txt";
-    ret = System::WriteStringToFile(stdinFile, input.serialize());
+    ret = System::WriteStringToFile(stdinFile, input);
 
     if (ret != 0)
     {
@@ -110,12 +126,11 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
         {
             std::ifstream fsStdout(stdoutFile, std::ios::in);
 
-            json::value output;
             if (fsStdout)
             {
-                std::string content((std::istreambuf_iterator<char>(fsStdout)), std::istreambuf_iterator<char>());
+                // the caller parses the output, a malformed one fails the request there.
+                std::string output((std::istreambuf_iterator<char>(fsStdout)), std::istreambuf_iterator<char>());
                 Logger::Info(jobId, taskId, requeueCount, "{0} {1}: plugin output read", filterType, filterFile);
-                output = json::value::parse(content);
                 fsStdout.close();
 
                 // In Debug build, only clean up the folder when success.
@@ -144,7 +159,7 @@ pplx::task<json::value> ExecutionFilter::ExecuteFilter(const std::string& filter
 #endif // DEBUG
 
     })
-    .then([=] (pplx::task<json::value> t) mutable -> json::value { p.reset(); return t.get(); } );
+    .then([=] (pplx::task<std::string> t) mutable -> std::string { p.reset(); return t.get(); } );
 
 #ifndef DEBUG        
     }
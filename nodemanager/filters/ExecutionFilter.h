@@ -21,12 +21,18 @@ namespace hpc
                     filterFiles[TaskStartFilter] = "filters/OnTaskStart.sh";
                 }
 
-                pplx::task<json::value> OnJobStart(int jobId, int taskId, int requeueCount, const json::value& input) const;
+                // without a filter the start requests are parsed from the request body as is.
+                bool HasJobStartFilter() const { return this->HasFilter(JobStartFilter); }
+                bool HasTaskStartFilter() const { return this->HasFilter(TaskStartFilter); }
+
+                pplx::task<std::string> OnJobStart(int jobId, int taskId, int requeueCount, const std::string& input) const;
                 pplx::task<json::value> OnJobEnd(int jobId, const json::value& input) const;
-                pplx::task<json::value> OnTaskStart(int jobId, int taskId, int requeueCount, const json::value& input) const;
-                pplx::task<json::value> ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const json::value& input) const;
+                pplx::task<std::string> OnTaskStart(int jobId, int taskId, int requeueCount, const std::string& input) const;
+                pplx::task<std::string> ExecuteFilter(const std::string& filterType, int jobId, int taskId, int requeueCount, const std::string& input) const;
 
             private:
+                bool HasFilter(const std::string& filterType) const;
+
                 std::map<std::string, std::string> filterFiles;
                 const std::string JobStartFilter = "JobStartFilter";
                 const std::string JobEndFilter = "JobEndFilter";
@@ -24,12 +24,6 @@ using namespace hpc;
 using namespace hpc::common;
 using namespace web::http::experimental::listener;
 
-void Cleanup()
-{
-    Logger::Info("Cleaning up zombie processes");
-    Process::Cleanup();
-}
-
 int main(int argc, char* argv[])
 {
     if (argc > 1)
@@ -93,12 +87,11 @@ int main(int argc, char* argv[])
 
 #endif // DEBUG
 
-    Cleanup();
-
     Logger::Debug(
         "Trusted CA File: {0}",
         NodeManagerConfig::GetTrustedCAFile());
 
+    // the tasks left by the previous instance are adopted or cleaned up here.
     const std::string networkName = "";
     RemoteExecutor executor(networkName);
 
@@ -2,6 +2,9 @@
 
 . common.sh
 
+# the ids of the tasks adopted by the node manager, they are left running.
+keptTaskIds=" $* "
+
 echo
 
 docker version >/dev/null 2>&1
@@ -21,8 +24,13 @@ if $CGInstalled; then
 	taskIds=$(GetExistingTaskIdsInCGroup)
 	for taskId in $taskIds;
 	do
+		if [[ "$keptTaskIds" == *" $taskId "* ]]; then
+			echo "$taskId kept"
+			continue
+		fi
+
 		echo "$taskId"
-		/bin/bash ./CleanupTask.sh "$taskId" "0"
+		/bin/bash ./CleanupTask.sh "$taskId" "0" "" "1"
 	done
 	exit 0
 fi
\ No newline at end of file
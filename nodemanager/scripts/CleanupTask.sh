@@ -9,6 +9,7 @@
 taskId=$1
 processId=$2
 taskFolder=$3
+killTask=$4
 
 isDockerTask=$(CheckDockerEnvFileExist $taskFolder)
 if $isDockerTask; then
@@ -33,7 +34,10 @@ if $isDockerTask; then
 	exit
 fi
 
-/bin/bash ./EndTask.sh "$taskId" "$processId" "1"
+# the node manager kills the tasks it runs before cleaning up, only the stale ones are killed here.
+if [ "$killTask" == "1" ]; then
+	/bin/bash ./EndTask.sh "$taskId" "$processId" "1"
+fi
 
 cgDisabled=$(CheckCgroupDisabledInFlagFile $taskFolder)
 if $CGInstalled && ! $cgDisabled; then
@@ -11,6 +11,12 @@ taskId=$1
 affinity=$2
 taskFolder=$3
 userName=$4
+mems=$5
+
+# the NUMA nodes covering the affinity are computed by nodemanager, fall back to all nodes
+if [ -z "$mems" ]; then
+	mems=0-$((`lscpu | grep 'NUMA node(s)' | awk '{print $NF}'` - 1))
+fi
 
 isDockerTask=$(CheckDockerEnvFileExist $taskFolder)
 if $isDockerTask; then
@@ -42,6 +48,7 @@ if $isDockerTask; then
 				$mpiContainerStartOption \
 				--name $containerName \
 				--cpuset-cpus $affinity \
+				--cpuset-mems $mems \
 				--env-file $envFile \
 				--cidfile $containerIdFile \
 				-v $taskFolder:$taskFolder:z \
@@ -114,8 +121,7 @@ if $CGInstalled && ! $cgDisabled; then
 	while [ $maxLoop -gt 0 ]
 	do
 		memsFile=$(GetMemsFile "$groupName")
-		numaMaxIndex=$((`lscpu | grep 'NUMA node(s)' | awk '{print $NF}'` - 1))
-		echo 0-$numaMaxIndex > "$memsFile"
+		echo "$mems" > "$memsFile"
 		ec=$?
 		if [ $ec -eq 0 ]
 		then
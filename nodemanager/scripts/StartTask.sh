@@ -12,6 +12,9 @@ runPath=$2
 userName=$3
 taskFolder=$4
 
+# the exit code is read from the file when the task is adopted by a restarted node manager.
+trap 'echo $? > $taskFolder/exit_code' EXIT
+
 cp {TestMutualTrust.sh,WaitForTrust.sh} $taskFolder
 
 # Generate hostfile or machinefile for Intel MPI, Open MPI, MPICH or other MPI applications
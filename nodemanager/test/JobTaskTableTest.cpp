@@ -0,0 +1,199 @@
+#include "JobTaskTableTest.h"
+
+#ifdef DEBUG
+
+#include <set>
+#include <utility>
+#include <cpprest/json.h>
+
+#include "../core/JobTaskTable.h"
+#include "../utils/JsonWriter.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+using namespace web;
+
+namespace
+{
+    typedef std::set<std::pair<int, int>> TaskIds;
+
+    json::value Heartbeat(JobTaskTable& table)
+    {
+        JsonWriter writer;
+        table.WriteJson(writer, true);
+        Logger::Info("Heartbeat {0}", writer.GetString());
+        return json::value::parse(writer.GetString());
+    }
+
+    void Acknowledge(JobTaskTable& table, const json::value& heartbeat)
+    {
+        json::value response;
+        response["AckSequence"] = heartbeat.at("Sequence");
+        table.AcknowledgeHeartbeat(response);
+    }
+
+    std::shared_ptr<TaskInfo> AddTask(JobTaskTable& table, int jobId, int taskId)
+    {
+        bool isNewEntry;
+        return table.AddJobAndTask(jobId, taskId, std::vector<uint64_t>(), isNewEntry);
+    }
+
+    bool IsDelta(const json::value& heartbeat)
+    {
+        return heartbeat.at("IsDelta").as_bool();
+    }
+
+    TaskIds GetTasks(const json::value& heartbeat)
+    {
+        TaskIds tasks;
+        for (const auto& job : heartbeat.at("Jobs").as_array())
+        {
+            for (const auto& task : job.at("Tasks").as_array())
+            {
+                tasks.insert(std::make_pair(job.at("JobId").as_integer(), task.at("TaskId").as_integer()));
+            }
+        }
+
+        return tasks;
+    }
+
+    TaskIds GetRemovedTasks(const json::value& heartbeat)
+    {
+        TaskIds tasks;
+        for (const auto& task : heartbeat.at("RemovedTasks").as_array())
+        {
+            tasks.insert(std::make_pair(task.at("JobId").as_integer(), task.at("TaskId").as_integer()));
+        }
+
+        return tasks;
+    }
+
+    bool Expect(const std::string& name, bool condition)
+    {
+        if (!condition)
+        {
+            Logger::Error("{0} failed", name);
+        }
+
+        return condition;
+    }
+}
+
+bool JobTaskTableTest::DeltaAfterAcknowledge()
+{
+    JobTaskTable table;
+    AddTask(table, 1, 1);
+    AddTask(table, 1, 2);
+
+    bool result = true;
+
+    // the first heartbeat after the start is always full.
+    auto full = Heartbeat(table);
+    result &= Expect("FirstIsFull", !IsDelta(full) && GetTasks(full) == TaskIds({ { 1, 1 }, { 1, 2 } }));
+    Acknowledge(table, full);
+
+    auto unchanged = Heartbeat(table);
+    result &= Expect("UnchangedIsEmpty", IsDelta(unchanged) && GetTasks(unchanged).empty());
+
+    table.GetTask(1, 2)->ExitCode = 3;
+
+    auto changed = Heartbeat(table);
+    result &= Expect("ChangedOnly", IsDelta(changed) && GetTasks(changed) == TaskIds({ { 1, 2 } }));
+    result &= Expect("BaseSequence", changed.at("BaseSequence") == full.at("Sequence"));
+
+    return result;
+}
+
+bool JobTaskTableTest::DeltaWithRemovals()
+{
+    JobTaskTable table;
+    auto removedTask = AddTask(table, 1, 1);
+    AddTask(table, 1, 2);
+    AddTask(table, 2, 1);
+
+    bool result = true;
+
+    Acknowledge(table, Heartbeat(table));
+
+    table.RemoveTask(1, 1, removedTask->GetAttemptId());
+    table.RemoveJob(2);
+
+    auto removal = Heartbeat(table);
+    result &= Expect("RemovedTask", IsDelta(removal) && GetRemovedTasks(removal) == TaskIds({ { 1, 1 } }));
+    result &= Expect("RemovedJob", removal.at("RemovedJobs").size() == 1 && removal.at("RemovedJobs").at(0).as_integer() == 2);
+    result &= Expect("NoTasks", GetTasks(removal).empty());
+    Acknowledge(table, removal);
+
+    // the acknowledged removals are not sent again.
+    auto next = Heartbeat(table);
+    result &= Expect("RemovalsAcknowledged", GetRemovedTasks(next).empty() && next.at("RemovedJobs").size() == 0);
+
+    return result;
+}
+
+bool JobTaskTableTest::DeltaAfterLostAcknowledge()
+{
+    JobTaskTable table;
+    AddTask(table, 1, 1);
+    AddTask(table, 1, 2);
+
+    bool result = true;
+
+    auto full = Heartbeat(table);
+    Acknowledge(table, full);
+
+    table.GetTask(1, 1)->ExitCode = 1;
+
+    // the response to this one is lost.
+    auto lost = Heartbeat(table);
+    result &= Expect("Sent", GetTasks(lost) == TaskIds({ { 1, 1 } }));
+
+    auto resent = Heartbeat(table);
+    result &= Expect("Resent", IsDelta(resent) && GetTasks(resent) == TaskIds({ { 1, 1 } }));
+    result &= Expect("SameBase", resent.at("BaseSequence") == full.at("Sequence"));
+
+    // a late acknowledgement of the lost one doesn't move the base.
+    Acknowledge(table, lost);
+    auto afterLate = Heartbeat(table);
+    result &= Expect("LateIgnored", GetTasks(afterLate) == TaskIds({ { 1, 1 } }));
+
+    Acknowledge(table, afterLate);
+    auto acknowledged = Heartbeat(table);
+    result &= Expect("Acknowledged", IsDelta(acknowledged) && GetTasks(acknowledged).empty());
+    result &= Expect("NewBase", acknowledged.at("BaseSequence") == afterLate.at("Sequence"));
+
+    return result;
+}
+
+bool JobTaskTableTest::FullSnapshotAfterRemovedOverflow()
+{
+    JobTaskTable table;
+    AddTask(table, 1, 1);
+
+    bool result = true;
+
+    Acknowledge(table, Heartbeat(table));
+
+    // more removals than MaxRemovedEntries without an acknowledgement.
+    for (int i = 0; i < 5000; i++)
+    {
+        auto task = AddTask(table, 2, i);
+        table.RemoveTask(2, i, task->GetAttemptId());
+    }
+
+    auto overflow = Heartbeat(table);
+    result &= Expect("Full", !IsDelta(overflow) && !overflow.has_field("RemovedTasks"));
+    result &= Expect("AllTasks", GetTasks(overflow) == TaskIds({ { 1, 1 } }));
+    Acknowledge(table, overflow);
+
+    auto next = Heartbeat(table);
+    result &= Expect("DeltaAgain", IsDelta(next) && GetRemovedTasks(next).empty());
+
+    return result;
+}
+
+#endif // DEBUG
@@ -0,0 +1,28 @@
+#ifndef JOBTASKTABLETEST_H
+#define JOBTASKTABLETEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class JobTaskTableTest
+        {
+            public:
+                JobTaskTableTest() { }
+
+                static bool DeltaAfterAcknowledge();
+                static bool DeltaWithRemovals();
+                static bool DeltaAfterLostAcknowledge();
+                static bool FullSnapshotAfterRemovedOverflow();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // JOBTASKTABLETEST_H
@@ -0,0 +1,224 @@
+#include "JournalTest.h"
+
+#ifdef DEBUG
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../utils/Journal.h"
+#include "../utils/Logger.h"
+#include "../utils/String.h"
+
+using namespace hpc::tests;
+using namespace hpc::utils;
+
+namespace
+{
+    typedef std::vector<std::pair<std::string, std::string>> Records;
+
+    const size_t Capacity = 4096;
+
+    // the file header and the length and crc in front of every record.
+    const size_t HeaderSize = 8;
+    const size_t RecordHeaderSize = 8;
+
+    std::string GetPath(const std::string& name)
+    {
+        return String::Join("", "/tmp/nodemanager_journaltest_", getpid(), "_", name);
+    }
+
+    void Remove(const std::string& path)
+    {
+        unlink(path.c_str());
+        unlink((path + ".tmp").c_str());
+    }
+
+    size_t RecordSize(const std::string& key, const std::string& payload)
+    {
+        return RecordHeaderSize + 3 + key.size() + payload.size();
+    }
+
+    void Overwrite(const std::string& path, size_t offset, const std::string& bytes)
+    {
+        std::fstream fs(path, std::ios::in | std::ios::out | std::ios::binary);
+        fs.seekp(offset);
+        fs.write(bytes.data(), bytes.size());
+    }
+
+    std::string ReadBytes(const std::string& path, size_t offset, size_t length)
+    {
+        std::ifstream fs(path, std::ios::binary);
+        fs.seekg(offset);
+        std::string bytes(length, '\0');
+        fs.read(&bytes[0], length);
+        return bytes;
+    }
+
+    Records Reload(const std::string& path)
+    {
+        Journal journal(path, Capacity);
+        return journal.GetPending();
+    }
+
+    bool Expect(const std::string& name, const Records& actual, const Records& expected)
+    {
+        if (actual == expected)
+        {
+            return true;
+        }
+
+        Logger::Error("{0}: {1} pending records, expected {2}", name, actual.size(), expected.size());
+        for (const auto& r : actual)
+        {
+            Logger::Error("{0}: pending {1} = {2}", name, r.first, r.second);
+        }
+
+        return false;
+    }
+}
+
+bool JournalTest::ReloadPending()
+{
+    std::string path = GetPath("reload");
+    Remove(path);
+
+    {
+        Journal journal(path, Capacity);
+        if (!journal.IsOpen()) { return false; }
+
+        journal.Append("a", "1");
+        journal.Append("b", "2");
+        journal.Append("c", "3");
+        journal.Acknowledge("b");
+
+        // a replaced record moves to the end.
+        journal.Append("a", "4");
+    }
+
+    bool result = Expect("ReloadPending", Reload(path), { { "c", "3" }, { "a", "4" } });
+
+    Remove(path);
+    return result;
+}
+
+bool JournalTest::CrcMismatch()
+{
+    std::string path = GetPath("crc");
+    Remove(path);
+
+    {
+        Journal journal(path, Capacity);
+        journal.Append("a", "first");
+        journal.Append("b", "second");
+    }
+
+    // one payload byte of b flipped, the length still matches.
+    size_t b = HeaderSize + RecordSize("a", "first");
+    Overwrite(path, b + RecordHeaderSize + 3 + 1, "S");
+
+    bool result = Expect("CrcMismatch", Reload(path), { { "a", "first" } });
+
+    // the dropped tail is cleared, the records appended after it are read again.
+    {
+        Journal journal(path, Capacity);
+        journal.Append("c", "third");
+    }
+
+    result &= Expect("CrcMismatchAppended", Reload(path), { { "a", "first" }, { "c", "third" } });
+
+    Remove(path);
+    return result;
+}
+
+bool JournalTest::TornRecord()
+{
+    std::string path = GetPath("torn");
+    Remove(path);
+
+    {
+        Journal journal(path, Capacity);
+        journal.Append("a", "first");
+        journal.Append("b", "second");
+    }
+
+    // the length of b reached the file before its body.
+    size_t b = HeaderSize + RecordSize("a", "first");
+    Overwrite(path, b + RecordHeaderSize, std::string(3 + 1 + 6, '\0'));
+
+    bool result = Expect("TornRecord", Reload(path), { { "a", "first" } });
+
+    // a length beyond the file is torn as well.
+    Overwrite(path, b, std::string("\xff\xff\x00\x00", 4));
+
+    result &= Expect("TornRecordLength", Reload(path), { { "a", "first" } });
+
+    Remove(path);
+    return result;
+}
+
+bool JournalTest::Compaction()
+{
+    std::string path = GetPath("compaction");
+    Remove(path);
+
+    std::string payload(100, 'x');
+    bool result = true;
+
+    {
+        Journal journal(path, Capacity);
+        journal.Append("stable", "kept");
+
+        // the replaced records fill the file several times over.
+        for (int i = 0; i < 100; i++)
+        {
+            result &= journal.Append("k", payload + std::to_string(i));
+        }
+
+        result &= Expect("CompactionInMemory", journal.GetPending(), { { "stable", "kept" }, { "k", payload + "99" } });
+    }
+
+    struct stat st;
+    result &= stat((path + ".tmp").c_str(), &st) != 0;
+    result &= stat(path.c_str(), &st) == 0 && (size_t)st.st_size == Capacity;
+
+    result &= Expect("Compaction", Reload(path), { { "stable", "kept" }, { "k", payload + "99" } });
+
+    Remove(path);
+    return result;
+}
+
+bool JournalTest::ResetOnLastAcknowledge()
+{
+    std::string path = GetPath("reset");
+    Remove(path);
+
+    {
+        Journal journal(path, Capacity);
+        journal.Append("a", "first");
+        journal.Append("b", "second");
+        journal.Acknowledge("a");
+        journal.Acknowledge("b");
+    }
+
+    // nothing pending, the records are cleared instead of the acknowledgement appended.
+    size_t written = RecordSize("a", "first") + RecordSize("b", "second") + RecordHeaderSize;
+    bool result = ReadBytes(path, HeaderSize, written) == std::string(written, '\0');
+
+    result &= Expect("ResetOnLastAcknowledge", Reload(path), { });
+
+    {
+        Journal journal(path, Capacity);
+        journal.Append("c", "third");
+    }
+
+    result &= Expect("ResetOnLastAcknowledgeAppended", Reload(path), { { "c", "third" } });
+
+    Remove(path);
+    return result;
+}
+
+#endif // DEBUG
@@ -0,0 +1,29 @@
+#ifndef JOURNALTEST_H
+#define JOURNALTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class JournalTest
+        {
+            public:
+                JournalTest() { }
+
+                static bool ReloadPending();
+                static bool CrcMismatch();
+                static bool TornRecord();
+                static bool Compaction();
+                static bool ResetOnLastAcknowledge();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // JOURNALTEST_H
@@ -0,0 +1,25 @@
+#ifndef JSONREADERTEST_H
+#define JSONREADERTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class JsonReaderTest
+        {
+            public:
+                JsonReaderTest() { }
+
+                static bool StartJobAndTaskArgsFromBody();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // JSONREADERTEST_H
@@ -0,0 +1,149 @@
+#include "JsonWriterTest.h"
+
+#ifdef DEBUG
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cpprest/json.h>
+
+#include "../utils/JsonWriter.h"
+#include "../utils/Logger.h"
+#include "../data/TaskInfo.h"
+
+using namespace hpc::tests;
+using namespace hpc::data;
+using namespace hpc::utils;
+
+using namespace web;
+
+namespace
+{
+    template <typename F>
+    long long MeasureUs(int rounds, F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) { f(); }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / rounds;
+    }
+}
+
+bool JsonWriterTest::Escaping()
+{
+    std::string tricky = "quote\" backslash\\ tab\t newline\n bell\x07 unicode \xe4\xb8\xad";
+
+    JsonWriter writer;
+    writer.StartObject()
+        .Field("Text", tricky)
+        .Field("Negative", -9223372036854775807LL - 1)
+        .Field("Max", 18446744073709551615ULL)
+        .Field("Double", 0.1)
+        .Key("Empty").StartArray().EndArray()
+        .Key("Nested").StartArray().StartObject().EndObject().Null().Value(true).EndArray()
+        .EndObject();
+
+    Logger::Info("Written {0}", writer.GetString());
+
+    auto parsed = json::value::parse(writer.GetString());
+
+    bool result = true;
+    result &= parsed.at("Text").as_string() == tricky;
+    result &= parsed.at("Negative").as_number().to_int64() == -9223372036854775807LL - 1;
+    result &= parsed.at("Max").as_number().to_uint64() == 18446744073709551615ULL;
+    result &= parsed.at("Double").as_double() == 0.1;
+    result &= parsed.at("Empty").size() == 0;
+    result &= parsed.at("Nested").size() == 3 && parsed.at("Nested").at(1).is_null();
+
+    return result;
+}
+
+bool JsonWriterTest::HeartbeatOf1000Tasks()
+{
+    const int JobCount = 10;
+    const int TasksPerJob = 100;
+    const int Rounds = 50;
+    const std::string nodeName = "benchmarknode";
+
+    std::vector<std::vector<std::unique_ptr<TaskInfo>>> jobs(JobCount);
+    for (int j = 0; j < JobCount; j++)
+    {
+        for (int i = 0; i < TasksPerJob; i++)
+        {
+            auto t = std::unique_ptr<TaskInfo>(new TaskInfo(j + 1, i + 1, nodeName));
+            t->KernelProcessorTimeMs = 1000 * i;
+            t->UserProcessorTimeMs = 3000 * i + j;
+            t->WorkingSetKb = 102400 + i;
+            t->IoReadBytes = 1ULL << 40;
+            t->ProcessIds = { 1000 + i, 2000 + i, 3000 + i };
+            t->Message = i % 10 == 0 ? "line one\nline \"two\"" : "";
+            jobs[j].push_back(std::move(t));
+        }
+    }
+
+    auto buildDom = [&jobs]()
+    {
+        std::vector<json::value> jobValues;
+        for (size_t j = 0; j < jobs.size(); j++)
+        {
+            std::vector<json::value> taskValues;
+            for (const auto& t : jobs[j])
+            {
+                taskValues.push_back(t->ToJson());
+            }
+
+            json::value job;
+            job["JobId"] = (int)j + 1;
+            job["Tasks"] = json::value::array(taskValues);
+            jobValues.push_back(job);
+        }
+
+        json::value j;
+        j["Name"] = json::value::string("benchmarknode");
+        j["Jobs"] = json::value::array(jobValues);
+        return j;
+    };
+
+    JsonWriter writer;
+    auto write = [&jobs, &writer]()
+    {
+        writer.Clear();
+        writer.StartObject();
+        writer.Field("Name", "benchmarknode");
+        writer.Key("Jobs").StartArray();
+        for (size_t j = 0; j < jobs.size(); j++)
+        {
+            writer.StartObject();
+            writer.Field("JobId", (int)j + 1);
+            writer.Key("Tasks").StartArray();
+            for (const auto& t : jobs[j])
+            {
+                t->WriteJson(writer);
+            }
+
+            writer.EndArray();
+            writer.EndObject();
+        }
+
+        writer.EndArray();
+        writer.EndObject();
+    };
+
+    std::string serialized;
+    long long domUs = MeasureUs(Rounds, [&]() { serialized = buildDom().serialize(); });
+    long long writerUs = MeasureUs(Rounds, write);
+
+    Logger::Info("Heartbeat of {0} tasks, {1} bytes: dom and serialize {2}us, writer {3}us",
+        JobCount * TasksPerJob, writer.GetSize(), domUs, writerUs);
+
+    // same document, the members may be in a different order.
+    bool result = json::value::parse(writer.GetString()) == json::value::parse(serialized);
+    if (!result)
+    {
+        Logger::Error("The written heartbeat differs from the dom one");
+    }
+
+    return result;
+}
+
+#endif // DEBUG
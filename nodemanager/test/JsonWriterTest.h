@@ -0,0 +1,26 @@
+#ifndef JSONWRITERTEST_H
+#define JSONWRITERTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class JsonWriterTest
+        {
+            public:
+                JsonWriterTest() { }
+
+                static bool Escaping();
+                static bool HeartbeatOf1000Tasks();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // JSONWRITERTEST_H
@@ -0,0 +1,59 @@
+#include "OutputStreamerTest.h"
+
+#ifdef DEBUG
+
+#include <string>
+
+#include "../core/OutputStreamer.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::tests;
+using namespace hpc::core;
+using namespace hpc::utils;
+
+namespace
+{
+    bool Expect(const std::string& name, const std::string& buffer, bool all, size_t expected)
+    {
+        size_t length = OutputStreamer::GetBatchLength(buffer, all);
+        if (length != expected)
+        {
+            Logger::Error("{0}: batch length {1}, expected {2}", name, length, expected);
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool OutputStreamerTest::BatchLengthOfCutSequences()
+{
+    bool result = true;
+
+    result &= Expect("Ascii", "abc", false, 3);
+    result &= Expect("Complete2", "ab\xc3\xa9", false, 4);
+    result &= Expect("Complete3", "ab\xe4\xb8\xad", false, 5);
+    result &= Expect("Complete4", "ab\xf0\x9f\x98\x80", false, 6);
+
+    // the cut sequence stays in the buffer for the next batch.
+    result &= Expect("Cut2", "ab\xc3", false, 2);
+    result &= Expect("Cut3After1", "ab\xe4", false, 2);
+    result &= Expect("Cut3After2", "ab\xe4\xb8", false, 2);
+    result &= Expect("Cut4After1", "ab\xf0", false, 2);
+    result &= Expect("Cut4After2", "ab\xf0\x9f", false, 2);
+    result &= Expect("Cut4After3", "ab\xf0\x9f\x98", false, 2);
+    result &= Expect("LoneLeadByte", "\xe4", false, 0);
+    result &= Expect("LoneContinuationByte", "\x80", false, 1);
+
+    // the rest of the output is sent as it is at the end.
+    result &= Expect("CutAtEnd", "ab\xe4\xb8", true, 4);
+
+    std::string full(OutputStreamer::MaxBatchBytes - 1, 'a');
+    result &= Expect("CutAtBatchEnd", full + "\xe4\xb8\xad", false, OutputStreamer::MaxBatchBytes - 1);
+    result &= Expect("CutAtBatchEndAll", full + "\xe4\xb8\xad", true, OutputStreamer::MaxBatchBytes - 1);
+    result &= Expect("CompleteAtBatchEnd", full + "a\xe4\xb8\xad", false, OutputStreamer::MaxBatchBytes);
+
+    return result;
+}
+
+#endif // DEBUG
@@ -0,0 +1,25 @@
+#ifndef OUTPUTSTREAMERTEST_H
+#define OUTPUTSTREAMERTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class OutputStreamerTest
+        {
+            public:
+                OutputStreamerTest() { }
+
+                static bool BatchLengthOfCutSequences();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // OUTPUTSTREAMERTEST_H
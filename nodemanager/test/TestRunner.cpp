@@ -6,6 +6,12 @@
 #include "ProcessTest.h"
 #include "ExecutionFilterTest.h"
 #include "ProxyTest.h"
+#include "JsonWriterTest.h"
+#include "JsonReaderTest.h"
+#include "OutputStreamerTest.h"
+#include "JournalTest.h"
+#include "JobTaskTableTest.h"
+#include "TimerWheelTest.h"
 
 using namespace hpc::tests;
 using namespace hpc::utils;
@@ -18,6 +24,21 @@ TestRunner::TestRunner()
     this->tests["ClusRun"] = []() { return ProcessTest::ClusRun(); };
     this->tests["FilterJobStart"] = []() { return ExecutionFilterTest::JobStart(); };
     this->tests["ProxyTest"] = []() { return ProxyTest::ProxyToLocal(); };
+    this->tests["JsonWriterEscaping"] = []() { return JsonWriterTest::Escaping(); };
+    this->tests["JsonWriterHeartbeat"] = []() { return JsonWriterTest::HeartbeatOf1000Tasks(); };
+    this->tests["JsonReaderStartArgs"] = []() { return JsonReaderTest::StartJobAndTaskArgsFromBody(); };
+    this->tests["OutputStreamerBatchLength"] = []() { return OutputStreamerTest::BatchLengthOfCutSequences(); };
+    this->tests["JournalReloadPending"] = []() { return JournalTest::ReloadPending(); };
+    this->tests["JournalCrcMismatch"] = []() { return JournalTest::CrcMismatch(); };
+    this->tests["JournalTornRecord"] = []() { return JournalTest::TornRecord(); };
+    this->tests["JournalCompaction"] = []() { return JournalTest::Compaction(); };
+    this->tests["JournalResetOnLastAcknowledge"] = []() { return JournalTest::ResetOnLastAcknowledge(); };
+    this->tests["HeartbeatDeltaAfterAcknowledge"] = []() { return JobTaskTableTest::DeltaAfterAcknowledge(); };
+    this->tests["HeartbeatDeltaWithRemovals"] = []() { return JobTaskTableTest::DeltaWithRemovals(); };
+    this->tests["HeartbeatDeltaAfterLostAcknowledge"] = []() { return JobTaskTableTest::DeltaAfterLostAcknowledge(); };
+    this->tests["HeartbeatFullAfterRemovedOverflow"] = []() { return JobTaskTableTest::FullSnapshotAfterRemovedOverflow(); };
+    this->tests["TimerWheelLevelBoundaries"] = []() { return TimerWheelTest::FireAtLevelBoundaries(); };
+    this->tests["TimerWheelCancelAfterFired"] = []() { return TimerWheelTest::CancelAfterFired(); };
 }
 
 bool TestRunner::Run()
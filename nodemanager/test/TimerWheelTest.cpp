@@ -0,0 +1,95 @@
+#include "TimerWheelTest.h"
+
+#ifdef DEBUG
+
+#include <map>
+#include <vector>
+#include <functional>
+
+#include "../utils/TimerWheel.h"
+#include "../utils/Logger.h"
+
+using namespace hpc::tests;
+using namespace hpc::utils;
+
+bool TimerWheelTest::FireAtLevelBoundaries()
+{
+    TimerWheel wheel(false);
+
+    // the timers are not scheduled on a level boundary.
+    const uint64_t StartTick = 37;
+    std::vector<std::function<void()>> expired;
+    while (wheel.currentTick < StartTick) { wheel.Tick(expired); }
+
+    // just below, on and just past the span of each level, and beyond the outermost wheel.
+    const uint64_t Ticks[] =
+    {
+        1, 63, 64, 65,
+        4095, 4096, 4097,
+        262143, 262144, 262145,
+        16777215, 16777216, 16777217, 16777216 + 4097,
+    };
+
+    std::map<uint64_t, uint64_t> firedAt;
+    uint64_t last = 0;
+    for (uint64_t ticks : Ticks)
+    {
+        wheel.Schedule(ticks * TimerWheel::TickMs, [&firedAt, &wheel, ticks]() { firedAt[ticks] = wheel.currentTick; });
+        last = std::max(last, ticks);
+    }
+
+    while (wheel.currentTick < StartTick + last + 1)
+    {
+        expired.clear();
+        wheel.Tick(expired);
+        for (auto& callback : expired) { callback(); }
+    }
+
+    bool result = true;
+    for (uint64_t ticks : Ticks)
+    {
+        auto it = firedAt.find(ticks);
+        if (it == firedAt.end() || it->second != StartTick + ticks)
+        {
+            Logger::Error("Timer of {0} ticks fired at {1}, expected {2}",
+                ticks, it == firedAt.end() ? 0 : it->second, StartTick + ticks);
+            result = false;
+        }
+    }
+
+    result &= wheel.timers.empty();
+
+    return result;
+}
+
+bool TimerWheelTest::CancelAfterFired()
+{
+    TimerWheel wheel(false);
+
+    int fired = 0;
+    auto firing = wheel.Schedule(2 * TimerWheel::TickMs, [&fired]() { fired++; });
+    auto cancelled = wheel.Schedule(100 * TimerWheel::TickMs, [&fired]() { fired += 100; });
+
+    bool result = wheel.Cancel(cancelled);
+
+    std::vector<std::function<void()>> expired;
+    for (int i = 0; i < 200; i++)
+    {
+        wheel.Tick(expired);
+    }
+
+    for (auto& callback : expired) { callback(); }
+
+    result &= fired == 1;
+    result &= !wheel.Cancel(firing);
+    result &= !wheel.Cancel(cancelled);
+
+    if (!result)
+    {
+        Logger::Error("Fired {0}", fired);
+    }
+
+    return result;
+}
+
+#endif // DEBUG
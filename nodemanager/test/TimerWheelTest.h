@@ -0,0 +1,26 @@
+#ifndef TIMERWHEELTEST_H
+#define TIMERWHEELTEST_H
+
+#ifdef DEBUG
+
+namespace hpc
+{
+    namespace tests
+    {
+        class TimerWheelTest
+        {
+            public:
+                TimerWheelTest() { }
+
+                static bool FireAtLevelBoundaries();
+                static bool CancelAfterFired();
+
+            protected:
+            private:
+        };
+    }
+}
+
+#endif // DEBUG
+
+#endif // TIMERWHEELTEST_H
@@ -0,0 +1,300 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <signal.h>
+#include <chrono>
+
+#include "CGroup.h"
+#include "String.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+const std::map<std::string, CGroup::Mount>& CGroup::GetMounts()
+{
+    // the same lookup as lssubsys -am in common.sh, done once without forking.
+    static std::map<std::string, Mount> mounts = []()
+    {
+        std::map<std::string, Mount> m;
+        std::string unifiedPath;
+
+        std::ifstream fs("/proc/mounts", std::ios::in);
+        std::string device, mountPoint, type, options;
+
+        while (fs >> device >> mountPoint >> type >> options)
+        {
+            if (type == "cgroup")
+            {
+                for (const auto& controller : String::Split(options, ','))
+                {
+                    m[controller] = Mount { mountPoint, false };
+                }
+            }
+            else if (type == "cgroup2")
+            {
+                unifiedPath = mountPoint;
+            }
+
+            fs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+
+        if (!unifiedPath.empty())
+        {
+            std::ifstream controllers(unifiedPath + "/cgroup.controllers", std::ios::in);
+            std::string controller;
+            while (controllers >> controller)
+            {
+                m.emplace(controller, Mount { unifiedPath, true });
+            }
+
+            // cpuacct and freezer are built into the v2 core.
+            m.emplace("cpuacct", Mount { unifiedPath, true });
+            m.emplace("freezer", Mount { unifiedPath, true });
+        }
+
+        return m;
+    }();
+
+    return mounts;
+}
+
+std::string CGroup::GetMountPoint(const std::string& controller, bool* unified)
+{
+    const auto& mounts = GetMounts();
+    auto it = mounts.find(controller);
+    if (it == mounts.end())
+    {
+        return std::string();
+    }
+
+    if (unified) { *unified = it->second.Unified; }
+    return it->second.Path;
+}
+
+std::string CGroup::GetPath(const std::string& controller) const
+{
+    auto mountPoint = GetMountPoint(controller);
+    return mountPoint.empty() ? mountPoint : String::Join("/", mountPoint, this->name);
+}
+
+std::string CGroup::GetProcsFile(const std::string& controller) const
+{
+    auto path = this->GetPath(controller);
+    return path.empty() ? path : path + (this->IsUnified(controller) ? "/cgroup.procs" : "/tasks");
+}
+
+bool CGroup::IsUnified(const std::string& controller) const
+{
+    bool unified = false;
+    GetMountPoint(controller, &unified);
+    return unified;
+}
+
+int CGroup::Create(const std::string& controller) const
+{
+    auto path = this->GetPath(controller);
+    if (path.empty()) return ENOENT;
+
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        int err = errno;
+        Logger::Error("Failed to create cgroup {0}, errno {1}", path, err);
+        return err;
+    }
+
+    return 0;
+}
+
+int CGroup::Remove(const std::string& controller) const
+{
+    auto path = this->GetPath(controller);
+    if (path.empty()) return ENOENT;
+
+    if (rmdir(path.c_str()) != 0 && errno != ENOENT)
+    {
+        int err = errno;
+        Logger::Warn("Failed to remove cgroup {0}, errno {1}", path, err);
+        return err;
+    }
+
+    return 0;
+}
+
+int CGroup::Write(const std::string& controller, const std::string& file, const std::string& value) const
+{
+    auto path = this->GetPath(controller);
+    if (path.empty()) return ENOENT;
+
+    path = String::Join("/", path, file);
+    int fd = open(path.c_str(), O_WRONLY);
+    if (fd < 0 || write(fd, value.c_str(), value.size()) != (ssize_t)value.size())
+    {
+        int err = errno;
+        if (fd >= 0) close(fd);
+        Logger::Error("Failed to write '{0}' to {1}, errno {2}", value, path, err);
+        return err;
+    }
+
+    close(fd);
+    return 0;
+}
+
+bool CGroup::Read(const std::string& controller, const std::string& file, std::string& content) const
+{
+    auto path = this->GetPath(controller);
+    if (path.empty()) return false;
+
+    std::ifstream fs(String::Join("/", path, file), std::ios::in);
+    if (!fs.good()) return false;
+
+    std::ostringstream oss;
+    oss << fs.rdbuf();
+    content = oss.str();
+
+    return true;
+}
+
+int CGroup::Freeze(bool frozen, int timeoutMs) const
+{
+    if (this->IsUnified("freezer"))
+    {
+        int ret = this->Write("freezer", "cgroup.freeze", frozen ? "1" : "0");
+        if (ret != 0) return ret;
+
+        return WaitEvent(this->GetPath("freezer") + "/cgroup.events", "frozen", frozen ? 1 : 0, timeoutMs) ? 0 : ETIMEDOUT;
+    }
+
+    std::string state = frozen ? "FROZEN" : "THAWED";
+    int ret = this->Write("freezer", "freezer.state", state);
+    if (ret != 0) return ret;
+
+    return this->Poll("freezer.state", [&state](const std::string& content) { return content.compare(0, state.size(), state) == 0; }, timeoutMs) ? 0 : ETIMEDOUT;
+}
+
+int CGroup::Signal(int sig) const
+{
+    auto procsFile = this->GetProcsFile("freezer");
+    if (procsFile.empty()) return ENOENT;
+
+    std::ifstream fs(procsFile, std::ios::in);
+    if (!fs.good()) return ENOENT;
+
+    pid_t pid;
+    while (fs >> pid)
+    {
+        if (kill(pid, sig) != 0 && errno != ESRCH)
+        {
+            Logger::Warn("Failed to send signal {0} to {1} in cgroup {2}, errno {3}", sig, pid, this->name, errno);
+        }
+    }
+
+    return 0;
+}
+
+int CGroup::Kill() const
+{
+    if (!this->IsUnified("freezer")) return ENOENT;
+
+    struct stat st;
+    if (stat((this->GetPath("freezer") + "/cgroup.kill").c_str(), &st) != 0) return ENOENT;
+
+    return this->Write("freezer", "cgroup.kill", "1");
+}
+
+bool CGroup::WaitEmpty(int timeoutMs) const
+{
+    if (this->IsUnified("freezer"))
+    {
+        return WaitEvent(this->GetPath("freezer") + "/cgroup.events", "populated", 0, timeoutMs);
+    }
+
+    return this->Poll("tasks", [](const std::string& content) { return content.find_first_not_of(" \n") == std::string::npos; }, timeoutMs);
+}
+
+bool CGroup::WaitEvent(const std::string& eventsFile, const std::string& key, uint64_t value, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0 || inotify_add_watch(fd, eventsFile.c_str(), IN_MODIFY) < 0)
+    {
+        // the group is gone, so is everything in it.
+        bool gone = errno == ENOENT;
+        if (fd >= 0) close(fd);
+        return gone;
+    }
+
+    bool reached = false;
+    while (true)
+    {
+        std::ifstream fs(eventsFile, std::ios::in);
+        if (!fs.good())
+        {
+            reached = true;
+            break;
+        }
+
+        std::ostringstream oss;
+        oss << fs.rdbuf();
+        if (ReadKey(oss.str(), key) == value)
+        {
+            reached = true;
+            break;
+        }
+
+        int remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remainingMs <= 0) break;
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, remainingMs) > 0)
+        {
+            char events[4096];
+            while (read(fd, events, sizeof(events)) > 0) { }
+        }
+    }
+
+    close(fd);
+    return reached;
+}
+
+bool CGroup::Poll(const std::string& file, const std::function<bool(const std::string&)>& check, int timeoutMs) const
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    int intervalMs = 1;
+
+    while (true)
+    {
+        std::string content;
+        if (!this->Read("freezer", file, content) || check(content))
+        {
+            return true;
+        }
+
+        int remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remainingMs <= 0) return false;
+
+        usleep(std::min(intervalMs, remainingMs) * 1000);
+        intervalMs = std::min(intervalMs * 2, 50);
+    }
+}
+
+uint64_t CGroup::ReadKey(const std::string& content, const std::string& key)
+{
+    std::istringstream iss(content);
+    std::string k;
+    uint64_t v;
+
+    while (iss >> k >> v)
+    {
+        if (k == key) return v;
+    }
+
+    return 0;
+}
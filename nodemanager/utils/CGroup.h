@@ -0,0 +1,75 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <string>
+#include <map>
+#include <functional>
+#include <inttypes.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// One cgroup by name in every controller hierarchy, for cgroup v1
+        /// (a mount per controller) and v2 (the unified mount).
+        class CGroup
+        {
+            public:
+                CGroup(const std::string& groupName) : name(groupName) { }
+
+                const std::string& GetName() const { return this->name; }
+
+                /// The directory of this group for the controller, empty when the controller is not mounted.
+                std::string GetPath(const std::string& controller) const;
+
+                /// The file to write a pid into for joining this group.
+                std::string GetProcsFile(const std::string& controller) const;
+
+                bool IsUnified(const std::string& controller) const;
+
+                int Create(const std::string& controller) const;
+                int Remove(const std::string& controller) const;
+
+                int Write(const std::string& controller, const std::string& file, const std::string& value) const;
+                bool Read(const std::string& controller, const std::string& file, std::string& content) const;
+
+                /// Freezes or thaws the group, and waits until the state is reached or the timeout elapses.
+                int Freeze(bool frozen, int timeoutMs) const;
+
+                /// Sends the signal to every process in the group.
+                int Signal(int sig) const;
+
+                /// Kills every process in the group by cgroup.kill, ENOENT when the kernel doesn't have it.
+                int Kill() const;
+
+                /// Waits until no process is left in the group, false when the timeout elapses.
+                bool WaitEmpty(int timeoutMs) const;
+
+                /// Reads the value of a "key value" line, as in cpu.stat and memory.events.
+                static uint64_t ReadKey(const std::string& content, const std::string& key);
+
+                /// The mount point of the controller, the unified mount when only cgroup v2 has it.
+                static std::string GetMountPoint(const std::string& controller, bool* unified = nullptr);
+
+            protected:
+            private:
+                struct Mount
+                {
+                    std::string Path;
+                    bool Unified;
+                };
+
+                static const std::map<std::string, Mount>& GetMounts();
+
+                /// Waits on a cgroup v2 cgroup.events file by inotify until the key has the value.
+                static bool WaitEvent(const std::string& eventsFile, const std::string& key, uint64_t value, int timeoutMs);
+
+                /// Polls a cgroup v1 file with backoff until the check passes, v1 has no change notification for it.
+                bool Poll(const std::string& file, const std::function<bool(const std::string&)>& check, int timeoutMs) const;
+
+                const std::string name;
+        };
+    }
+}
+
+#endif // CGROUP_H
@@ -0,0 +1,191 @@
+#include <fstream>
+#include <dirent.h>
+#include <algorithm>
+#include <cctype>
+#include <tuple>
+#include <iterator>
+
+#include "CpuTopology.h"
+#include "String.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+const CpuTopology& CpuTopology::GetInstance()
+{
+    static CpuTopology instance;
+    return instance;
+}
+
+CpuTopology::CpuTopology()
+{
+    const std::string cpuRoot = "/sys/devices/system/cpu/";
+
+    std::ifstream online(cpuRoot + "online", std::ios::in);
+    std::string onlineList;
+    getline(online, onlineList);
+
+    for (int id : ParseList(onlineList))
+    {
+        LogicalCpu cpu;
+        std::string topology = String::Join("", cpuRoot, "cpu", id, "/topology/");
+
+        cpu.Id = id;
+        cpu.CoreId = ReadInt(topology + "core_id", id);
+        cpu.SocketId = ReadInt(topology + "physical_package_id", 0);
+
+        std::ifstream siblings(topology + "thread_siblings_list", std::ios::in);
+        std::string siblingList;
+        getline(siblings, siblingList);
+        auto siblingIds = ParseList(siblingList);
+        auto self = std::find(siblingIds.cbegin(), siblingIds.cend(), id);
+        cpu.ThreadIndex = self == siblingIds.cend() ? 0 : self - siblingIds.cbegin();
+
+        // index3 is the L3 on x86 and arm64, fall back to the socket when absent.
+        cpu.L3Id = ReadInt(String::Join("", cpuRoot, "cpu", id, "/cache/index3/id"), -1);
+        if (cpu.L3Id < 0)
+        {
+            std::ifstream shared(String::Join("", cpuRoot, "cpu", id, "/cache/index3/shared_cpu_list"), std::ios::in);
+            std::string sharedList;
+            getline(shared, sharedList);
+            auto sharedIds = ParseList(sharedList);
+            cpu.L3Id = sharedIds.empty() ? cpu.SocketId : sharedIds.front();
+        }
+
+        this->cpus.push_back(cpu);
+    }
+
+    const std::string nodeRoot = "/sys/devices/system/node/";
+    DIR* dir = opendir(nodeRoot.c_str());
+    if (dir)
+    {
+        int maxNode = 0;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 || !std::isdigit(name[4])) continue;
+
+            int node = String::ConvertTo<int>(name.substr(4));
+            maxNode = std::max(maxNode, node);
+
+            std::ifstream cpuList(nodeRoot + name + "/cpulist", std::ios::in);
+            std::string list;
+            getline(cpuList, list);
+
+            for (int id : ParseList(list))
+            {
+                auto it = std::find_if(this->cpus.begin(), this->cpus.end(), [id](const auto& c) { return c.Id == id; });
+                if (it != this->cpus.end()) { it->NumaNode = node; }
+            }
+        }
+
+        closedir(dir);
+        this->numaNodeCount = maxNode + 1;
+    }
+
+    this->BuildCpuOrders();
+
+    Logger::Info("Detected {0} logical cpus on {1} NUMA nodes", this->cpus.size(), this->numaNodeCount);
+}
+
+void CpuTopology::BuildCpuOrders()
+{
+    auto order = [this](auto less)
+    {
+        auto sorted = this->cpus;
+        std::stable_sort(sorted.begin(), sorted.end(), less);
+
+        std::vector<int> ids;
+        std::transform(sorted.cbegin(), sorted.cend(), std::back_inserter(ids), [](const auto& c) { return c.Id; });
+        return ids;
+    };
+
+    this->identityOrder = order([](const auto& a, const auto& b) { return a.Id < b.Id; });
+
+    this->physicalCoreFirstOrder = order([](const auto& a, const auto& b)
+    {
+        return std::tie(a.ThreadIndex, a.SocketId, a.CoreId, a.Id) < std::tie(b.ThreadIndex, b.SocketId, b.CoreId, b.Id);
+    });
+
+    this->compactL3Order = order([](const auto& a, const auto& b)
+    {
+        return std::tie(a.SocketId, a.L3Id, a.ThreadIndex, a.CoreId, a.Id) < std::tie(b.SocketId, b.L3Id, b.ThreadIndex, b.CoreId, b.Id);
+    });
+}
+
+const std::vector<int>& CpuTopology::GetCpuOrder(AffinityMode mode) const
+{
+    switch (mode)
+    {
+        case AffinityMode::PhysicalCoreFirst: return this->physicalCoreFirstOrder;
+        case AffinityMode::CompactL3: return this->compactL3Order;
+        default: return this->identityOrder;
+    }
+}
+
+CpuTopology::AffinityMode CpuTopology::ParseAffinityMode(const std::string& mode)
+{
+    if (mode == "physical-core-first") return AffinityMode::PhysicalCoreFirst;
+    if (mode == "compact-l3") return AffinityMode::CompactL3;
+    if (!mode.empty() && mode != "identity")
+    {
+        Logger::Warn("Unknown affinity mode {0}, use identity", mode);
+    }
+
+    return AffinityMode::Identity;
+}
+
+std::set<int> CpuTopology::GetNumaNodes(const std::vector<int>& cpuIds) const
+{
+    std::set<int> nodes;
+
+    for (int id : cpuIds)
+    {
+        auto it = std::find_if(this->cpus.cbegin(), this->cpus.cend(), [id](const auto& c) { return c.Id == id; });
+        if (it != this->cpus.cend()) { nodes.insert(it->NumaNode); }
+    }
+
+    return nodes;
+}
+
+std::vector<int> CpuTopology::ParseList(const std::string& list)
+{
+    // kernel cpu list format, e.g. 0-3,8,10-11
+    std::vector<int> ids;
+
+    for (const auto& range : String::Split(String::Trim(list), ','))
+    {
+        auto bounds = String::Split(range, '-');
+        if (bounds.empty() || bounds[0].empty()) continue;
+
+        int first = String::ConvertTo<int>(bounds[0]);
+        int last = bounds.size() > 1 ? String::ConvertTo<int>(bounds[1]) : first;
+        for (int i = first; i <= last; i++) { ids.push_back(i); }
+    }
+
+    return ids;
+}
+
+std::string CpuTopology::ToList(const std::set<int>& ids)
+{
+    std::vector<std::string> ranges;
+
+    for (auto it = ids.cbegin(); it != ids.cend();)
+    {
+        int first = *it, last = *it;
+        while (++it != ids.cend() && *it == last + 1) { last = *it; }
+
+        ranges.push_back(first == last ? String::Join("", first) : String::Join("-", first, last));
+    }
+
+    return String::Join<','>(ranges);
+}
+
+int CpuTopology::ReadInt(const std::string& path, int defaultValue)
+{
+    std::ifstream fs(path, std::ios::in);
+    int value = defaultValue;
+    if (!(fs >> value)) { value = defaultValue; }
+    return value;
+}
@@ -0,0 +1,69 @@
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <set>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// The logical cpu layout read from sysfs once, used to translate
+        /// the scheduler affinity and to bind task memory to NUMA nodes.
+        class CpuTopology
+        {
+            public:
+                struct LogicalCpu
+                {
+                    int Id = 0;
+                    int CoreId = 0;
+                    int SocketId = 0;
+                    int NumaNode = 0;
+                    int L3Id = 0;
+                    // position of this cpu in its core's thread_siblings_list.
+                    int ThreadIndex = 0;
+                };
+
+                /// How the scheduler core ids are translated to logical cpus.
+                enum class AffinityMode
+                {
+                    // scheduler core n is logical cpu n.
+                    Identity,
+                    // one logical cpu per physical core first, then the SMT siblings.
+                    PhysicalCoreFirst,
+                    // fill one L3 domain (physical cores first) before the next one.
+                    CompactL3,
+                };
+
+                static const CpuTopology& GetInstance();
+
+                const std::vector<LogicalCpu>& GetCpus() const { return this->cpus; }
+                int GetNumaNodeCount() const { return this->numaNodeCount; }
+
+                std::set<int> GetNumaNodes(const std::vector<int>& cpuIds) const;
+                const std::vector<int>& GetCpuOrder(AffinityMode mode) const;
+
+                static AffinityMode ParseAffinityMode(const std::string& mode);
+
+                static std::vector<int> ParseList(const std::string& list);
+                static std::string ToList(const std::set<int>& ids);
+
+            protected:
+            private:
+                CpuTopology();
+
+                static int ReadInt(const std::string& path, int defaultValue);
+
+                void BuildCpuOrders();
+
+                std::vector<LogicalCpu> cpus;
+                std::vector<int> identityOrder;
+                std::vector<int> physicalCoreFirstOrder;
+                std::vector<int> compactL3Order;
+                int numaNodeCount = 1;
+        };
+    }
+}
+
+#endif // CPUTOPOLOGY_H
@@ -0,0 +1,347 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <algorithm>
+#include <boost/crc.hpp>
+
+#include "Journal.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+// the file header, a file without it is started over.
+const char Journal::Magic[8] = { 'H', 'P', 'C', 'J', 'R', 'N', 'L', '1' };
+const size_t Journal::HeaderSize;
+const size_t Journal::RecordHeaderSize;
+
+namespace
+{
+    uint32_t Crc32(const char* data, size_t length)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, length);
+        return crc.checksum();
+    }
+}
+
+Journal::Journal(const std::string& path, size_t capacity) :
+    path(path), capacity(std::max(capacity, (size_t)sysconf(_SC_PAGESIZE)))
+{
+    if (this->Open())
+    {
+        this->Load();
+    }
+}
+
+Journal::~Journal()
+{
+    this->Close();
+}
+
+std::vector<std::pair<std::string, std::string>> Journal::GetPending()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    std::vector<std::pair<uint64_t, std::pair<std::string, std::string>>> ordered;
+    for (const auto& p : this->pending)
+    {
+        ordered.push_back(std::make_pair(p.second.Sequence, std::make_pair(p.first, p.second.Payload)));
+    }
+
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<std::pair<std::string, std::string>> records;
+    for (auto& r : ordered)
+    {
+        records.push_back(std::move(r.second));
+    }
+
+    return records;
+}
+
+bool Journal::Append(const std::string& key, const std::string& payload)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    if (!this->IsOpen()) { return false; }
+
+    if (!this->Write(RecordType::Append, key, payload))
+    {
+        return false;
+    }
+
+    this->pending[key] = Pending { this->nextSequence++, payload };
+    return true;
+}
+
+void Journal::Acknowledge(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    if (!this->IsOpen() || this->pending.erase(key) == 0) { return; }
+
+    if (this->pending.empty())
+    {
+        // nothing to keep, start over instead of appending the acknowledgement.
+        this->Reset();
+        return;
+    }
+
+    this->Write(RecordType::Acknowledge, key, std::string());
+}
+
+bool Journal::Open()
+{
+    this->fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (this->fd < 0)
+    {
+        Logger::Error("Journal {0}: failed to open, errno {1}", this->path, errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(this->fd, &st) != 0)
+    {
+        Logger::Error("Journal {0}: failed to stat, errno {1}", this->path, errno);
+        this->Close();
+        return false;
+    }
+
+    // a bigger file written with an earlier capacity is kept as is.
+    this->capacity = std::max(this->capacity, (size_t)st.st_size);
+
+    if ((size_t)st.st_size < this->capacity && ftruncate(this->fd, this->capacity) != 0)
+    {
+        Logger::Error("Journal {0}: failed to resize to {1}, errno {2}", this->path, this->capacity, errno);
+        this->Close();
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, this->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        Logger::Error("Journal {0}: failed to map {1} bytes, errno {2}", this->path, this->capacity, errno);
+        this->Close();
+        return false;
+    }
+
+    this->data = static_cast<char*>(mapped);
+    return true;
+}
+
+void Journal::Load()
+{
+    if (memcmp(this->data, Magic, sizeof(Magic)) != 0)
+    {
+        Logger::Info("Journal {0}: initializing", this->path);
+        memset(this->data, 0, this->capacity);
+        memcpy(this->data, Magic, sizeof(Magic));
+        this->used = HeaderSize;
+        this->Sync(0, this->capacity, true);
+        return;
+    }
+
+    size_t offset = HeaderSize;
+    while (offset + RecordHeaderSize <= this->capacity)
+    {
+        uint32_t length, crc;
+        memcpy(&length, this->data + offset, sizeof(length));
+        memcpy(&crc, this->data + offset + sizeof(length), sizeof(crc));
+
+        if (length == 0) { break; }
+
+        const char* body = this->data + offset + RecordHeaderSize;
+        if (length < 3 || length > this->capacity - offset - RecordHeaderSize || Crc32(body, length) != crc)
+        {
+            // a record torn by a crash, the rest is cleared so nothing behind it is read again.
+            Logger::Warn("Journal {0}: invalid record at {1}, dropping the rest", this->path, offset);
+            memset(this->data + offset, 0, this->capacity - offset);
+            this->Sync(offset, this->capacity - offset, true);
+            break;
+        }
+
+        RecordType type = (RecordType)body[0];
+        uint16_t keyLength;
+        memcpy(&keyLength, body + 1, sizeof(keyLength));
+
+        if ((size_t)keyLength + 3 <= length)
+        {
+            std::string key(body + 3, keyLength);
+
+            if (type == RecordType::Append)
+            {
+                this->pending[key] = Pending { this->nextSequence++, std::string(body + 3 + keyLength, length - 3 - keyLength) };
+            }
+            else if (type == RecordType::Acknowledge)
+            {
+                this->pending.erase(key);
+            }
+        }
+
+        offset += RecordHeaderSize + length;
+    }
+
+    this->used = offset;
+    Logger::Info("Journal {0}: loaded {1} bytes, {2} pending records", this->path, this->used, this->pending.size());
+}
+
+void Journal::Close()
+{
+    if (this->data != nullptr)
+    {
+        munmap(this->data, this->capacity);
+        this->data = nullptr;
+    }
+
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+        this->fd = -1;
+    }
+}
+
+void Journal::EncodeRecord(std::string& buffer, RecordType type, const std::string& key, const std::string& payload)
+{
+    uint32_t length = 3 + key.size() + payload.size();
+    uint16_t keyLength = key.size();
+    size_t start = buffer.size();
+
+    buffer.resize(start + RecordHeaderSize);
+    buffer.push_back((char)type);
+    buffer.append((const char*)&keyLength, sizeof(keyLength));
+    buffer.append(key);
+    buffer.append(payload);
+
+    uint32_t crc = Crc32(buffer.data() + start + RecordHeaderSize, length);
+    memcpy(&buffer[start], &length, sizeof(length));
+    memcpy(&buffer[start + sizeof(length)], &crc, sizeof(crc));
+}
+
+bool Journal::Write(RecordType type, const std::string& key, const std::string& payload)
+{
+    if (key.size() > UINT16_MAX) { return false; }
+
+    std::string record;
+    EncodeRecord(record, type, key, payload);
+
+    // one record must leave room for the others.
+    if (record.size() > (this->capacity - HeaderSize) / 2)
+    {
+        Logger::Error("Journal {0}: record {1} of {2} bytes is too large", this->path, key, record.size());
+        return false;
+    }
+
+    // the terminating zero length is part of the used space.
+    if (this->used + record.size() + RecordHeaderSize > this->capacity && !this->Compact(record.size() + RecordHeaderSize))
+    {
+        return false;
+    }
+
+    // the length goes last, a record is never seen before its body is there.
+    memcpy(this->data + this->used + RecordHeaderSize, record.data() + RecordHeaderSize, record.size() - RecordHeaderSize);
+    memcpy(this->data + this->used + sizeof(uint32_t), record.data() + sizeof(uint32_t), sizeof(uint32_t));
+    memcpy(this->data + this->used, record.data(), sizeof(uint32_t));
+
+    this->Sync(this->used, record.size(), false);
+    this->used += record.size();
+    return true;
+}
+
+bool Journal::Compact(size_t required)
+{
+    std::vector<std::pair<uint64_t, std::string>> ordered;
+    for (const auto& p : this->pending)
+    {
+        ordered.push_back(std::make_pair(p.second.Sequence, p.first));
+    }
+
+    std::sort(ordered.begin(), ordered.end());
+
+    std::string content(Magic, sizeof(Magic));
+    size_t dropped = 0;
+
+    // the newest records are kept when they don't fit together.
+    size_t budget = this->capacity - HeaderSize - required;
+    size_t size = 0;
+    size_t first = ordered.size();
+    while (first > 0)
+    {
+        const auto& key = ordered[first - 1].second;
+        size_t recordSize = RecordHeaderSize + 3 + key.size() + this->pending[key].Payload.size();
+        if (size + recordSize > budget) { break; }
+
+        size += recordSize;
+        first--;
+    }
+
+    for (size_t i = 0; i < first; i++)
+    {
+        Logger::Error("Journal {0}: full, dropping the pending record {1}", this->path, ordered[i].second);
+        this->pending.erase(ordered[i].second);
+        dropped++;
+    }
+
+    for (size_t i = first; i < ordered.size(); i++)
+    {
+        const auto& key = ordered[i].second;
+        EncodeRecord(content, RecordType::Append, key, this->pending[key].Payload);
+    }
+
+    // the compacted file replaces the old one at once, a crash leaves either of them.
+    std::string tempPath = this->path + ".tmp";
+    int tempFd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool written = tempFd >= 0 &&
+        ftruncate(tempFd, this->capacity) == 0 &&
+        pwrite(tempFd, content.data(), content.size(), 0) == (ssize_t)content.size() &&
+        fsync(tempFd) == 0 &&
+        rename(tempPath.c_str(), this->path.c_str()) == 0;
+
+    if (!written)
+    {
+        Logger::Error("Journal {0}: failed to compact, errno {1}", this->path, errno);
+        if (tempFd >= 0) { close(tempFd); }
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    this->Close();
+    this->fd = tempFd;
+
+    void* mapped = mmap(nullptr, this->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        Logger::Error("Journal {0}: failed to map the compacted file, errno {1}", this->path, errno);
+        this->Close();
+        return false;
+    }
+
+    this->data = static_cast<char*>(mapped);
+    this->used = content.size();
+
+    Logger::Info("Journal {0}: compacted to {1} bytes, {2} pending records, {3} dropped",
+        this->path, this->used, this->pending.size(), dropped);
+
+    return true;
+}
+
+void Journal::Reset()
+{
+    memset(this->data + HeaderSize, 0, this->used - HeaderSize);
+    this->Sync(HeaderSize, this->used - HeaderSize, false);
+    this->used = HeaderSize;
+}
+
+void Journal::Sync(size_t offset, size_t length, bool wait)
+{
+    // msync takes page aligned addresses. the records are flushed in the background,
+    // the crc finds the ones a power loss tore.
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t start = offset / pageSize * pageSize;
+
+    if (msync(this->data + start, offset + length - start, wait ? MS_SYNC : MS_ASYNC) != 0)
+    {
+        Logger::Warn("Journal {0}: msync failed, errno {1}", this->path, errno);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// An append only file of keyed records, mapped in memory and checked by crc32.
+        /// A record stays pending until its key is acknowledged, appending a pending key replaces it.
+        /// The file never grows beyond the capacity, it is compacted into a new file when full
+        /// and the oldest pending records are dropped when even the compacted one is full.
+        class Journal
+        {
+            public:
+                Journal(const std::string& path, size_t capacity);
+                ~Journal();
+
+                Journal(const Journal&) = delete;
+                Journal& operator=(const Journal&) = delete;
+
+                bool IsOpen() const { return this->data != nullptr; }
+
+                // key and payload of the records pending when the file was opened, in the append order.
+                std::vector<std::pair<std::string, std::string>> GetPending();
+
+                bool Append(const std::string& key, const std::string& payload);
+                void Acknowledge(const std::string& key);
+
+            protected:
+            private:
+                enum class RecordType : uint8_t
+                {
+                    Append = 1,
+                    Acknowledge = 2,
+                };
+
+                struct Pending
+                {
+                    uint64_t Sequence;
+                    std::string Payload;
+                };
+
+                bool Open();
+                void Load();
+                void Close();
+                bool Write(RecordType type, const std::string& key, const std::string& payload);
+                bool Compact(size_t required);
+                void Reset();
+                void Sync(size_t offset, size_t length, bool wait);
+
+                static void EncodeRecord(std::string& buffer, RecordType type, const std::string& key, const std::string& payload);
+
+                static const char Magic[8];
+                static const size_t HeaderSize = 8;
+                static const size_t RecordHeaderSize = 8;
+
+                std::string path;
+                size_t capacity;
+                int fd = -1;
+                char* data = nullptr;
+                size_t used = 0;
+
+                uint64_t nextSequence = 0;
+                std::map<std::string, Pending> pending;
+
+                std::mutex lock;
+        };
+    }
+}
+
+#endif // JOURNAL_H
@@ -0,0 +1,322 @@
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <stdexcept>
+
+#include "JsonReader.h"
+#include "String.h"
+
+using namespace hpc::utils;
+
+JsonReader::JsonReader(const char* data, size_t size) :
+    begin(data), p(data), end(data + size)
+{
+}
+
+void JsonReader::StartObject()
+{
+    this->Expect('{');
+    this->firstElement.push_back(true);
+}
+
+bool JsonReader::NextKey(std::string& key)
+{
+    if (!this->Separate('}')) { return false; }
+
+    if (this->Peek() != '"') { this->Fail("expecting a key"); }
+
+    key.clear();
+    this->ReadStringToken(key);
+    this->Expect(':');
+    return true;
+}
+
+void JsonReader::StartArray()
+{
+    this->Expect('[');
+    this->firstElement.push_back(true);
+}
+
+bool JsonReader::NextElement()
+{
+    return this->Separate(']');
+}
+
+bool JsonReader::Separate(char close)
+{
+    if (this->firstElement.empty()) { this->Fail("not in an object or array"); }
+
+    if (this->Peek() == close)
+    {
+        this->p++;
+        this->firstElement.pop_back();
+        return false;
+    }
+
+    if (this->firstElement.back())
+    {
+        this->firstElement.back() = false;
+    }
+    else
+    {
+        this->Expect(',');
+    }
+
+    return true;
+}
+
+bool JsonReader::ReadNull()
+{
+    if (this->Peek() != 'n') { return false; }
+
+    this->ExpectLiteral("null");
+    return true;
+}
+
+bool JsonReader::ReadString(std::string& value)
+{
+    value.clear();
+
+    if (this->Peek() != '"')
+    {
+        this->Skip();
+        return false;
+    }
+
+    this->ReadStringToken(value);
+    return true;
+}
+
+long long JsonReader::ReadInt64()
+{
+    std::string token;
+    this->ReadNumber(token);
+
+    if (token.find_first_of(".eE") != std::string::npos)
+    {
+        return (long long)strtod(token.c_str(), nullptr);
+    }
+
+    errno = 0;
+    long long value = strtoll(token.c_str(), nullptr, 10);
+    if (errno == ERANGE) { this->Fail("number out of range"); }
+
+    return value;
+}
+
+uint64_t JsonReader::ReadUInt64()
+{
+    std::string token;
+    this->ReadNumber(token);
+
+    if (token[0] == '-') { this->Fail("expecting an unsigned number"); }
+
+    if (token.find_first_of(".eE") != std::string::npos)
+    {
+        return (uint64_t)strtod(token.c_str(), nullptr);
+    }
+
+    errno = 0;
+    uint64_t value = strtoull(token.c_str(), nullptr, 10);
+    if (errno == ERANGE) { this->Fail("number out of range"); }
+
+    return value;
+}
+
+bool JsonReader::ReadBool()
+{
+    char c = this->Peek();
+    if (c == 't') { this->ExpectLiteral("true"); return true; }
+    if (c == 'f') { this->ExpectLiteral("false"); return false; }
+
+    this->Skip();
+    return false;
+}
+
+void JsonReader::Skip()
+{
+    std::string ignored;
+
+    switch (this->Peek())
+    {
+        case '{':
+            this->StartObject();
+            while (this->NextKey(ignored)) { this->Skip(); }
+            break;
+        case '[':
+            this->StartArray();
+            while (this->NextElement()) { this->Skip(); }
+            break;
+        case '"':
+            this->ReadStringToken(ignored);
+            break;
+        case 't':
+            this->ExpectLiteral("true");
+            break;
+        case 'f':
+            this->ExpectLiteral("false");
+            break;
+        case 'n':
+            this->ExpectLiteral("null");
+            break;
+        default:
+            this->ReadNumber(ignored);
+            break;
+    }
+}
+
+void JsonReader::End()
+{
+    this->SkipWhiteSpaces();
+    if (this->p != this->end || !this->firstElement.empty()) { this->Fail("unexpected content at the end"); }
+}
+
+void JsonReader::SkipWhiteSpaces()
+{
+    while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r'))
+    {
+        this->p++;
+    }
+}
+
+char JsonReader::Peek()
+{
+    this->SkipWhiteSpaces();
+    if (this->p == this->end) { this->Fail("unexpected end"); }
+
+    return *this->p;
+}
+
+void JsonReader::Expect(char c)
+{
+    if (this->Peek() != c)
+    {
+        char message[] = "expecting 'x'";
+        message[11] = c;
+        this->Fail(message);
+    }
+
+    this->p++;
+}
+
+void JsonReader::ExpectLiteral(const char* literal)
+{
+    size_t length = strlen(literal);
+    if ((size_t)(this->end - this->p) < length || memcmp(this->p, literal, length) != 0)
+    {
+        this->Fail("invalid literal");
+    }
+
+    this->p += length;
+}
+
+void JsonReader::ReadNumber(std::string& token)
+{
+    this->SkipWhiteSpaces();
+
+    const char* start = this->p;
+    while (this->p < this->end && (isdigit(*this->p) || strchr("+-.eE", *this->p) != nullptr))
+    {
+        this->p++;
+    }
+
+    if (this->p == start) { this->Fail("expecting a number"); }
+
+    token.assign(start, this->p - start);
+}
+
+void JsonReader::ReadStringToken(std::string& value)
+{
+    this->Expect('"');
+
+    while (true)
+    {
+        // copy the runs without escapes at once.
+        const char* start = this->p;
+        while (this->p < this->end && *this->p != '"' && *this->p != '\\') { this->p++; }
+
+        value.append(start, this->p - start);
+
+        if (this->p == this->end) { this->Fail("unterminated string"); }
+        if (*this->p++ == '"') { return; }
+        if (this->p == this->end) { this->Fail("unterminated string"); }
+
+        char c = *this->p++;
+        switch (c)
+        {
+            case '"': value.push_back('"'); break;
+            case '\\': value.push_back('\\'); break;
+            case '/': value.push_back('/'); break;
+            case 'b': value.push_back('\b'); break;
+            case 'f': value.push_back('\f'); break;
+            case 'n': value.push_back('\n'); break;
+            case 'r': value.push_back('\r'); break;
+            case 't': value.push_back('\t'); break;
+            case 'u':
+            {
+                unsigned code = this->ReadHex4();
+                if (code >= 0xd800 && code < 0xdc00)
+                {
+                    this->ExpectLiteral("\\u");
+                    unsigned low = this->ReadHex4();
+                    if (low < 0xdc00 || low >= 0xe000) { this->Fail("invalid surrogate pair"); }
+
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+
+                // utf-8, as cpprest keeps the strings on linux.
+                if (code < 0x80)
+                {
+                    value.push_back((char)code);
+                }
+                else if (code < 0x800)
+                {
+                    value.push_back((char)(0xc0 | (code >> 6)));
+                    value.push_back((char)(0x80 | (code & 0x3f)));
+                }
+                else if (code < 0x10000)
+                {
+                    value.push_back((char)(0xe0 | (code >> 12)));
+                    value.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+                    value.push_back((char)(0x80 | (code & 0x3f)));
+                }
+                else
+                {
+                    value.push_back((char)(0xf0 | (code >> 18)));
+                    value.push_back((char)(0x80 | ((code >> 12) & 0x3f)));
+                    value.push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+                    value.push_back((char)(0x80 | (code & 0x3f)));
+                }
+
+                break;
+            }
+            default:
+                this->Fail("invalid escape");
+        }
+    }
+}
+
+unsigned JsonReader::ReadHex4()
+{
+    if (this->end - this->p < 4) { this->Fail("unterminated string"); }
+
+    unsigned code = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char c = *this->p++;
+        code <<= 4;
+
+        if (c >= '0' && c <= '9') { code |= c - '0'; }
+        else if (c >= 'a' && c <= 'f') { code |= c - 'a' + 10; }
+        else if (c >= 'A' && c <= 'F') { code |= c - 'A' + 10; }
+        else { this->Fail("invalid unicode escape"); }
+    }
+
+    return code;
+}
+
+void JsonReader::Fail(const char* message) const
+{
+    throw std::runtime_error(String::Join("", "Json parse error at ", this->p - this->begin, ": ", message));
+}
@@ -0,0 +1,66 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// Pulls the json tokens straight from a buffer, so the arguments are filled without a json::value tree.
+        /// The buffer must outlive the reader, strings are decoded into the caller's strings.
+        class JsonReader
+        {
+            public:
+                JsonReader(const char* data, size_t size);
+                JsonReader(const std::string& json) : JsonReader(json.data(), json.size()) { }
+
+                void StartObject();
+                // false when the object ends.
+                bool NextKey(std::string& key);
+
+                void StartArray();
+                // false when the array ends.
+                bool NextElement();
+
+                // consumes a null, used for the optional arrays and objects.
+                bool ReadNull();
+
+                // a value which is not a string is skipped and read as empty, same as JsonHelper.
+                bool ReadString(std::string& value);
+                long long ReadInt64();
+                uint64_t ReadUInt64();
+                int ReadInt() { return (int)this->ReadInt64(); }
+                bool ReadBool();
+
+                void Skip();
+
+                // nothing but white spaces may follow the document.
+                void End();
+
+            protected:
+            private:
+                void SkipWhiteSpaces();
+                char Peek();
+                void Expect(char c);
+                void ExpectLiteral(const char* literal);
+                // false when the container is closed instead.
+                bool Separate(char close);
+                void ReadNumber(std::string& token);
+                void ReadStringToken(std::string& value);
+                unsigned ReadHex4();
+                void Fail(const char* message) const;
+
+                const char* begin;
+                const char* p;
+                const char* end;
+
+                // one per open object or array, true until its first element is read.
+                std::vector<bool> firstElement;
+        };
+    }
+}
+
+#endif // JSONREADER_H
@@ -0,0 +1,204 @@
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+#include "JsonWriter.h"
+
+using namespace hpc::utils;
+
+JsonWriter::JsonWriter(size_t capacity)
+{
+    this->buffer.reserve(capacity);
+}
+
+void JsonWriter::Clear()
+{
+    this->buffer.clear();
+    this->firstElement.clear();
+    this->afterKey = false;
+}
+
+void JsonWriter::Separate()
+{
+    if (this->afterKey)
+    {
+        this->afterKey = false;
+    }
+    else if (!this->firstElement.empty())
+    {
+        if (this->firstElement.back())
+        {
+            this->firstElement.back() = false;
+        }
+        else
+        {
+            this->buffer.push_back(',');
+        }
+    }
+}
+
+JsonWriter& JsonWriter::StartObject()
+{
+    this->Separate();
+    this->buffer.push_back('{');
+    this->firstElement.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject()
+{
+    this->buffer.push_back('}');
+    this->firstElement.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::StartArray()
+{
+    this->Separate();
+    this->buffer.push_back('[');
+    this->firstElement.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray()
+{
+    this->buffer.push_back(']');
+    this->firstElement.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(const char* name)
+{
+    this->Separate();
+    this->WriteString(name, strlen(name));
+    this->buffer.push_back(':');
+    this->afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(const std::string& value)
+{
+    this->Separate();
+    this->WriteString(value.data(), value.size());
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(const char* value)
+{
+    this->Separate();
+    this->WriteString(value, strlen(value));
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(bool value)
+{
+    this->Separate();
+    this->buffer.append(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(int value) { return this->Value((long long)value); }
+JsonWriter& JsonWriter::Value(unsigned int value) { return this->Value((unsigned long long)value); }
+JsonWriter& JsonWriter::Value(long value) { return this->Value((long long)value); }
+JsonWriter& JsonWriter::Value(unsigned long value) { return this->Value((unsigned long long)value); }
+
+JsonWriter& JsonWriter::Value(long long value)
+{
+    this->Separate();
+
+    if (value < 0)
+    {
+        this->buffer.push_back('-');
+        this->WriteUnsigned(0ULL - (unsigned long long)value);
+    }
+    else
+    {
+        this->WriteUnsigned(value);
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(unsigned long long value)
+{
+    this->Separate();
+    this->WriteUnsigned(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(double value)
+{
+    this->Separate();
+
+    if (!std::isfinite(value))
+    {
+        // json has no representation for them.
+        this->buffer.append("null");
+        return *this;
+    }
+
+    // the same precision cpprest uses for doubles.
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%.17g", value);
+    this->buffer.append(digits, length);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null()
+{
+    this->Separate();
+    this->buffer.append("null");
+    return *this;
+}
+
+void JsonWriter::WriteUnsigned(unsigned long long value)
+{
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+
+    do
+    {
+        *--p = '0' + value % 10;
+        value /= 10;
+    }
+    while (value != 0);
+
+    this->buffer.append(p, end - p);
+}
+
+void JsonWriter::WriteString(const char* value, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    this->buffer.push_back('"');
+
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = value[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        this->buffer.append(value + start, i - start);
+        start = i + 1;
+
+        switch (c)
+        {
+            case '"': this->buffer.append("\\\""); break;
+            case '\\': this->buffer.append("\\\\"); break;
+            case '\b': this->buffer.append("\\b"); break;
+            case '\f': this->buffer.append("\\f"); break;
+            case '\n': this->buffer.append("\\n"); break;
+            case '\r': this->buffer.append("\\r"); break;
+            case '\t': this->buffer.append("\\t"); break;
+            default:
+                this->buffer.append("\\u00");
+                this->buffer.push_back(hex[c >> 4]);
+                this->buffer.push_back(hex[c & 0xf]);
+                break;
+        }
+    }
+
+    this->buffer.append(value + start, length - start);
+    this->buffer.push_back('"');
+}
@@ -0,0 +1,64 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// Serializes json straight into a growable buffer, with the string escaping of cpprest.
+        /// Clear keeps the capacity, so a writer kept by a reporter allocates only when the payload grows.
+        class JsonWriter
+        {
+            public:
+                JsonWriter(size_t capacity = 4096);
+
+                void Clear();
+
+                JsonWriter& StartObject();
+                JsonWriter& EndObject();
+                JsonWriter& StartArray();
+                JsonWriter& EndArray();
+
+                JsonWriter& Key(const char* name);
+
+                JsonWriter& Value(const std::string& value);
+                JsonWriter& Value(const char* value);
+                JsonWriter& Value(bool value);
+                JsonWriter& Value(int value);
+                JsonWriter& Value(unsigned int value);
+                JsonWriter& Value(long value);
+                JsonWriter& Value(unsigned long value);
+                JsonWriter& Value(long long value);
+                JsonWriter& Value(unsigned long long value);
+                JsonWriter& Value(double value);
+                JsonWriter& Null();
+
+                template <typename T>
+                JsonWriter& Field(const char* name, const T& value)
+                {
+                    return this->Key(name).Value(value);
+                }
+
+                const std::string& GetString() const { return this->buffer; }
+                size_t GetSize() const { return this->buffer.size(); }
+
+            protected:
+            private:
+                void Separate();
+                void WriteString(const char* value, size_t length);
+                void WriteUnsigned(unsigned long long value);
+
+                std::string buffer;
+
+                // one per open object or array, true until its first element is written.
+                std::vector<bool> firstElement;
+                bool afterKey = false;
+        };
+    }
+}
+
+#endif // JSONWRITER_H
@@ -0,0 +1,90 @@
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "LockStatistics.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+using namespace web;
+
+namespace
+{
+    std::mutex& RegistryLock()
+    {
+        static std::mutex registryLock;
+        return registryLock;
+    }
+
+    std::vector<const LockStatistics*>& Registry()
+    {
+        static std::vector<const LockStatistics*> registry;
+        return registry;
+    }
+}
+
+const int LockStatistics::SlowHoldMs;
+
+LockStatistics::LockStatistics(const std::string& name) :
+    name(name), count(0), totalWaitUs(0), maxWaitUs(0), totalHoldUs(0), maxHoldUs(0)
+{
+    std::lock_guard<std::mutex> guard(RegistryLock());
+    Registry().push_back(this);
+}
+
+LockStatistics::~LockStatistics()
+{
+    std::lock_guard<std::mutex> guard(RegistryLock());
+    auto& registry = Registry();
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+}
+
+void LockStatistics::Record(Clock::duration wait, Clock::duration hold)
+{
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(wait).count();
+    uint64_t holdUs = std::chrono::duration_cast<std::chrono::microseconds>(hold).count();
+
+    this->count++;
+    this->totalWaitUs += waitUs;
+    this->totalHoldUs += holdUs;
+    UpdateMax(this->maxWaitUs, waitUs);
+    UpdateMax(this->maxHoldUs, holdUs);
+
+    if (holdUs >= (uint64_t)SlowHoldMs * 1000)
+    {
+        Logger::Warn("Lock {0} was held for {1}ms after waiting {2}ms", this->name, holdUs / 1000, waitUs / 1000);
+    }
+}
+
+void LockStatistics::UpdateMax(std::atomic<uint64_t>& max, uint64_t value)
+{
+    uint64_t current = max.load();
+    while (value > current && !max.compare_exchange_weak(current, value)) { }
+}
+
+json::value LockStatistics::ToJsonValue() const
+{
+    uint64_t c = this->count.load();
+
+    json::value j;
+    j["Name"] = json::value::string(this->name);
+    j["Count"] = c;
+    j["AverageWaitUs"] = c == 0 ? 0 : this->totalWaitUs.load() / c;
+    j["MaxWaitUs"] = this->maxWaitUs.load();
+    j["AverageHoldUs"] = c == 0 ? 0 : this->totalHoldUs.load() / c;
+    j["MaxHoldUs"] = this->maxHoldUs.load();
+    return j;
+}
+
+json::value LockStatistics::ToJson()
+{
+    std::lock_guard<std::mutex> guard(RegistryLock());
+
+    std::vector<json::value> locks;
+    for (const auto* stat : Registry())
+    {
+        locks.push_back(stat->ToJsonValue());
+    }
+
+    return json::value::array(locks);
+}
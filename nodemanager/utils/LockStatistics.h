@@ -0,0 +1,51 @@
+#ifndef LOCKSTATISTICS_H
+#define LOCKSTATISTICS_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+
+#include <cpprest/json.h>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// Wait and hold time counters of one named lock, fed by the ReaderLock and WriterLock guards.
+        /// All the living instances are listed by ToJson for the debug endpoint.
+        class LockStatistics
+        {
+            public:
+                typedef std::chrono::steady_clock Clock;
+
+                LockStatistics(const std::string& name);
+                ~LockStatistics();
+
+                LockStatistics(const LockStatistics&) = delete;
+                LockStatistics& operator=(const LockStatistics&) = delete;
+
+                void Record(Clock::duration wait, Clock::duration hold);
+
+                web::json::value ToJsonValue() const;
+
+                static web::json::value ToJson();
+
+                // holding longer than this is logged with the lock name.
+                static const int SlowHoldMs = 1000;
+
+            protected:
+            private:
+                static void UpdateMax(std::atomic<uint64_t>& max, uint64_t value);
+
+                std::string name;
+                std::atomic<uint64_t> count;
+                std::atomic<uint64_t> totalWaitUs;
+                std::atomic<uint64_t> maxWaitUs;
+                std::atomic<uint64_t> totalHoldUs;
+                std::atomic<uint64_t> maxHoldUs;
+        };
+    }
+}
+
+#endif // LOCKSTATISTICS_H
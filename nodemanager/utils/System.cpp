@@ -8,6 +8,20 @@
 #include <fstream>
 #include <unistd.h>
 #include <set>
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <pwd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/bn.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 
 #include "System.h"
 #include "String.h"
@@ -482,6 +496,14 @@ int System::CreateUser(
 {
     std::string output;
 
+    // same as the useradd exit code when the user exists, without starting it.
+    uid_t uid;
+    gid_t gid;
+    if (0 == System::GetUserEntry(userName, uid, gid, output))
+    {
+        return 9;
+    }
+
     int ret = System::ExecuteCommandOut(output, "useradd", userName, "-m", "-s /bin/bash");
     if (ret == 0)
     {
@@ -515,16 +537,116 @@ int System::CreateUser(
     return ret;
 }
 
-int System::GetHomeDir(const std::string& userName, std::string& homeDir)
+int System::Pressure(const std::string& resource, float &someAvg10, float &fullAvg10)
 {
-    std::string folder = String::Join("", "~", userName);
+    std::ifstream fs("/proc/pressure/" + resource, std::ios::in);
+    if (!fs.good())
+    {
+        // the kernel is older than 4.20 or built without PSI.
+        return -1;
+    }
 
-    int ret = System::ExecuteCommandOut(
-        homeDir,
-        "echo -n",
-        folder);
+    std::ostringstream oss;
+    oss << fs.rdbuf();
+    std::string content = oss.str();
+
+    uint64_t totalUs;
+    someAvg10 = fullAvg10 = 0.0f;
+    ParsePressure(content, "some", someAvg10, totalUs);
+    ParsePressure(content, "full", fullAvg10, totalUs);
+
+    return 0;
+}
+
+bool System::ParsePressure(const std::string& content, const std::string& kind, float &avg10, uint64_t &totalUs)
+{
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    std::istringstream iss(content);
+    std::string line;
+
+    while (std::getline(iss, line))
+    {
+        if (line.compare(0, kind.size() + 1, kind + " ") != 0) continue;
+
+        auto avg = line.find("avg10=");
+        auto total = line.find("total=");
+        if (avg == std::string::npos || total == std::string::npos) return false;
+
+        avg10 = strtof(line.c_str() + avg + 6, nullptr);
+        totalUs = strtoull(line.c_str() + total + 6, nullptr, 10);
+        return true;
+    }
+
+    return false;
+}
+
+bool System::IsCGroupInstalled()
+{
+    // checked once, the initialization of the static is thread safe.
+    static const bool installed = []()
+    {
+        std::string output;
+        return 0 == System::ExecuteCommandOut(output, "command -v cgexec > /dev/null 2>&1");
+    }();
+
+    return installed;
+}
+
+uint64_t System::GetProcessStartTime(pid_t pid)
+{
+    std::ifstream fs("/proc/" + std::to_string(pid) + "/stat", std::ios::in);
+    std::string stat;
+    if (!std::getline(fs, stat))
+    {
+        return 0;
+    }
+
+    // the comm may have spaces and parentheses, the start time is the 20th field after it.
+    size_t p = stat.rfind(')');
+    if (p == std::string::npos)
+    {
+        return 0;
+    }
+
+    std::istringstream fields(stat.substr(p + 2));
+    std::string field;
+    for (int i = 0; i < 19 && fields >> field; i++) { }
+
+    uint64_t startTime = 0;
+    fields >> startTime;
+
+    // a zombie is as good as gone.
+    return stat[p + 2] == 'Z' ? 0 : startTime;
+}
+
+int System::GetUserEntry(const std::string& userName, uid_t& uid, gid_t& gid, std::string& homeDir)
+{
+    long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+    std::vector<char> buffer(size > 0 ? size : 16384);
+
+    struct passwd entry;
+    struct passwd* result = nullptr;
+    int ret = getpwnam_r(userName.c_str(), &entry, buffer.data(), buffer.size(), &result);
+
+    if (ret != 0 || result == nullptr)
+    {
+        return ret != 0 ? ret : (int)ErrorCodes::CannotFindHomeDir;
+    }
+
+    uid = entry.pw_uid;
+    gid = entry.pw_gid;
+    homeDir = entry.pw_dir;
+
+    return 0;
+}
+
+int System::GetHomeDir(const std::string& userName, std::string& homeDir)
+{
+    uid_t uid;
+    gid_t gid;
+    int ret = System::GetUserEntry(userName, uid, gid, homeDir);
 
-    if (0 != ret || homeDir.find('~') != homeDir.npos)
+    if (0 != ret || homeDir.empty())
     {
         Logger::Error("Cannot find home folder for user {0}", userName);
         return ret == 0 ? (int)ErrorCodes::CannotFindHomeDir : ret;
@@ -533,6 +655,45 @@ int System::GetHomeDir(const std::string& userName, std::string& homeDir)
     return ret;
 }
 
+int System::CreateSshFolder(const std::string& userName, uid_t uid, gid_t gid, const std::string& homeDir, std::string& sshFolder)
+{
+    sshFolder = String::Join("", homeDir, "/.ssh/");
+
+    Logger::Debug("User {0}'s ssh folder {1}", userName, sshFolder);
+
+    struct stat st;
+    if (stat(homeDir.c_str(), &st) != 0)
+    {
+        for (size_t slash = homeDir.find('/', 1); ; slash = homeDir.find('/', slash + 1))
+        {
+            std::string folder = homeDir.substr(0, slash);
+            if (mkdir(folder.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                Logger::Info("Cannot create folder {0}, errno {1}", folder, errno);
+                return errno;
+            }
+
+            if (slash == std::string::npos) break;
+        }
+
+        if (chown(homeDir.c_str(), uid, -1) != 0)
+        {
+            Logger::Info("Cannot change the owner of {0}, errno {1}", homeDir, errno);
+            return errno;
+        }
+    }
+
+    if ((mkdir(sshFolder.c_str(), 0700) != 0 && errno != EEXIST) ||
+        chown(sshFolder.c_str(), uid, -1) != 0 ||
+        chmod(sshFolder.c_str(), 0700) != 0)
+    {
+        Logger::Info("Cannot create folder {0}, errno {1}", sshFolder, errno);
+        return errno;
+    }
+
+    return 0;
+}
+
 int System::AddSshKey(
     const std::string& userName,
     const std::string& key,
@@ -540,59 +701,54 @@ int System::AddSshKey(
     const std::string& filePermission,
     std::string& filePath)
 {
-    std::string output;
-    int ret = System::GetHomeDir(userName, output);
-
-    if (0 != ret) { return ret; }
-
-    std::string homeDir = output;
-    std::string sshFolder = String::Join("", homeDir, "/.ssh/");
-
-    Logger::Debug("User {0}'s ssh folder {1}", userName, sshFolder);
+    uid_t uid;
+    gid_t gid;
+    std::string homeDir, sshFolder;
+    int ret = System::GetUserEntry(userName, uid, gid, homeDir);
 
-    ret = System::ExecuteCommandOut(
-        output,
-        "[ -d ", homeDir, " ] || (mkdir -p ", homeDir, " && chown ", userName, " ", homeDir, ")",
-        " && [ -d ", sshFolder, " ] || mkdir ", sshFolder,
-        " && chown ", userName, " ", sshFolder, " && chmod 700 ", sshFolder);
-
-    if (ret != 0)
+    if (0 != ret)
     {
-        Logger::Info("Cannot create folder {0}, error code {1}", sshFolder, ret);
+        Logger::Error("Cannot find home folder for user {0}", userName);
         return ret;
     }
 
+    ret = System::CreateSshFolder(userName, uid, gid, homeDir, sshFolder);
+    if (0 != ret) { return ret; }
+
     filePath = String::Join("", sshFolder, fileName);
 
-    if (!key.empty())
+    if (key.empty())
     {
-        std::ifstream test(filePath);
-        // won't overwrite existing user's private key
-        if (!test.good())
-        {
-            std::ofstream keyFile(filePath, std::ios::trunc);
-            keyFile << key;
-            keyFile.close();
+        return -1;
+    }
 
-            ret = System::ExecuteCommandOut(output, "chown", userName, filePath, "&& chmod", filePermission, filePath);
+    mode_t mode = strtol(filePermission.c_str(), nullptr, 8);
 
-            if (0 != ret)
-            {
-                Logger::Error("Error when change the file {0}'s permission to {1}, ret {2}", filePath, filePermission, ret);
-            }
-        }
-        else
+    // won't overwrite existing user's private key
+    int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    if (fd < 0)
+    {
+        if (errno == EEXIST)
         {
             Logger::Info("File {0} exist, skip overwriting", filePath);
-            ret = -2;
+            return -2;
         }
 
-        test.close();
+        Logger::Error("Cannot create the file {0}, errno {1}", filePath, errno);
+        return (int)ErrorCodes::WriteFileError;
+    }
+
+    ret = System::WriteAll(fd, key) ? 0 : (int)ErrorCodes::WriteFileError;
 
-        return ret;
+    if (0 == ret && (fchown(fd, uid, -1) != 0 || fchmod(fd, mode) != 0))
+    {
+        Logger::Error("Error when change the file {0}'s permission to {1}, errno {2}", filePath, filePermission, errno);
+        ret = errno;
     }
 
-    return -1;
+    close(fd);
+
+    return ret;
 }
 
 int System::RemoveSshKey(
@@ -604,111 +760,271 @@ int System::RemoveSshKey(
 
     if (0 != ret) { return ret; }
 
-    std::string sshFolder = String::Join("", output, "/.ssh/");
+    auto keyFileName = String::Join("", output, "/.ssh/", fileName);
 
-    auto keyFileName = String::Join("", sshFolder, fileName);
-    std::ifstream test(keyFileName);
-    // won't overwrite existing user's private key
-    if (test.good())
+    if (unlink(keyFileName.c_str()) != 0 && errno != ENOENT)
     {
-        std::string output;
-        ret = System::ExecuteCommandOut(output, "rm -f", keyFileName);
+        ret = errno;
+        Logger::Error("Cannot remove the file {0}, errno {1}", keyFileName, ret);
     }
 
-    test.close();
-
     return ret;
 }
 
-int System::AddAuthorizedKey(
+int System::UpdateAuthorizedKeys(
     const std::string& userName,
-    const std::string& key,
-    const std::string& filePermission,
+    bool createFolder,
+    mode_t mode,
+    const std::function<bool(std::vector<std::string>&)>& update,
     std::string& filePath)
 {
-    std::string output;
-    int ret = System::GetHomeDir(userName, output);
+    uid_t uid;
+    gid_t gid;
+    std::string homeDir, sshFolder;
+    int ret = System::GetUserEntry(userName, uid, gid, homeDir);
 
-    if (0 != ret) { return ret; }
+    if (0 != ret)
+    {
+        Logger::Error("Cannot find home folder for user {0}", userName);
+        return ret;
+    }
 
-    std::string sshFolder = String::Join("", output, "/.ssh/");
+    if (createFolder)
+    {
+        ret = System::CreateSshFolder(userName, uid, gid, homeDir, sshFolder);
+        if (0 != ret) { return ret; }
+    }
+    else
+    {
+        sshFolder = String::Join("", homeDir, "/.ssh/");
+    }
 
     filePath = String::Join("", sshFolder, "authorized_keys");
 
-    std::ofstream authFile(filePath, std::ios::app);
+    // the file is replaced by rename, so the folder is locked instead of the file.
+    int folderFd = open(sshFolder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (folderFd < 0 || flock(folderFd, LOCK_EX) != 0)
+    {
+        Logger::Error("Cannot lock the folder {0}, errno {1}", sshFolder, errno);
+        if (folderFd >= 0) { close(folderFd); }
+        return (int)ErrorCodes::WriteFileError;
+    }
 
-    ret = (int)ErrorCodes::WriteFileError;
+    std::vector<std::string> lines;
+    struct stat st;
+    bool exists = stat(filePath.c_str(), &st) == 0;
 
-    if (authFile.good())
+    if (exists)
     {
-        authFile << key;
+        mode = st.st_mode & 07777;
+        uid = st.st_uid;
+        gid = st.st_gid;
 
-        ret = 0;
+        std::ifstream authFile(filePath, std::ios::in);
+        std::string line;
+        while (getline(authFile, line))
+        {
+            lines.push_back(line);
+        }
     }
 
-    authFile.close();
+    if (!update(lines))
+    {
+        close(folderFd);
+        return -2;
+    }
 
-    if (0 != ret)
+    std::string content;
+    for (const auto& line : lines)
     {
-        Logger::Error("Error when open the auth file {0}", filePath);
-        return ret;
+        content += line;
+        content += '\n';
     }
 
-    ret = System::ExecuteCommandOut(output, "chown", userName, filePath, "&& chmod", filePermission, filePath);
+    std::string tempFile = String::Join("", sshFolder, ".authorized_keys.XXXXXX");
+    int fd = mkstemp(&tempFile[0]);
+
+    ret = (int)ErrorCodes::WriteFileError;
+
+    if (fd >= 0)
+    {
+        if (System::WriteAll(fd, content) &&
+            fchown(fd, uid, gid) == 0 &&
+            fchmod(fd, mode) == 0 &&
+            fsync(fd) == 0)
+        {
+            ret = 0;
+        }
+
+        close(fd);
+
+        if (0 == ret && rename(tempFile.c_str(), filePath.c_str()) != 0)
+        {
+            ret = (int)ErrorCodes::WriteFileError;
+        }
+
+        if (0 != ret)
+        {
+            unlink(tempFile.c_str());
+        }
+    }
 
     if (0 != ret)
     {
-        Logger::Error("Error when change the file {0}'s permission to {1}, ret {2}", filePath, filePermission, ret);
+        Logger::Error("Error when rewrite the auth file {0}, errno {1}", filePath, errno);
     }
 
+    close(folderFd);
+
     return ret;
 }
 
+int System::AddAuthorizedKey(
+    const std::string& userName,
+    const std::string& key,
+    const std::string& filePermission,
+    std::string& filePath)
+{
+    std::string trimKey = String::Trim(key);
+
+    return System::UpdateAuthorizedKeys(
+        userName,
+        true,
+        strtol(filePermission.c_str(), nullptr, 8),
+        [&trimKey](std::vector<std::string>& lines)
+        {
+            // the key added by the user is not touched, and won't be removed by us.
+            for (const auto& line : lines)
+            {
+                if (String::Trim(line) == trimKey) { return false; }
+            }
+
+            lines.push_back(trimKey);
+            return true;
+        },
+        filePath);
+}
+
 int System::RemoveAuthorizedKey(
     const std::string& userName,
     const std::string& key)
 {
-    std::string output;
-    int ret = System::GetHomeDir(userName, output);
+    std::string trimKey = String::Trim(key);
+    std::string filePath;
 
-    if (0 != ret) { return ret; }
+    int ret = System::UpdateAuthorizedKeys(
+        userName,
+        false,
+        0600,
+        [&trimKey](std::vector<std::string>& lines)
+        {
+            auto size = lines.size();
+            lines.erase(
+                std::remove_if(lines.begin(), lines.end(), [&trimKey](const std::string& line) { return String::Trim(line) == trimKey; }),
+                lines.end());
 
-    std::string sshFolder = String::Join("", output, "/.ssh/");
-    std::string authFileName = String::Join("", sshFolder, "authorized_keys");
+            return lines.size() != size;
+        },
+        filePath);
 
-    std::ifstream authFile(authFileName, std::ios::in);
-    std::vector<std::string> lines;
+    return ret == -2 ? 0 : ret;
+}
 
-    ret = (int)ErrorCodes::WriteFileError;
+std::string System::GetKeyFingerprint(const std::string& key)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
 
-    if (!authFile.good())
+    if (1 != EVP_Digest(key.data(), key.size(), digest, &length, EVP_sha256(), nullptr))
     {
-        authFile.close();
-        return ret;
+        return std::string();
     }
 
-    std::string trimKey = String::Trim(key);
-    std::string line;
-    while (getline(authFile, line))
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (unsigned int i = 0; i < length; i++)
     {
-        if (String::Trim(line) != trimKey)
-        {
-            lines.push_back(line);
-        }
+        oss << std::setw(2) << (int)digest[i];
     }
 
-    authFile.close();
+    return oss.str();
+}
+
+int System::GetSshPublicKey(const std::string& privateKey, std::string& publicKey)
+{
+    std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new_mem_buf(privateKey.data(), (int)privateKey.size()), BIO_free);
+    if (!bio) { return -1; }
+
+    // keys in the OPENSSH format or with a passphrase can't be read here.
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(
+        PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, const_cast<char*>("")), EVP_PKEY_free);
+
+    if (!key || EVP_PKEY_base_id(key.get()) != EVP_PKEY_RSA) { return -1; }
+
+    BIGNUM* n = nullptr;
+    BIGNUM* e = nullptr;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_PKEY_get_bn_param(key.get(), OSSL_PKEY_PARAM_RSA_N, &n);
+    EVP_PKEY_get_bn_param(key.get(), OSSL_PKEY_PARAM_RSA_E, &e);
+#else
+    const BIGNUM* rsaN = nullptr;
+    const BIGNUM* rsaE = nullptr;
+    RSA_get0_key(EVP_PKEY_get0_RSA(key.get()), &rsaN, &rsaE, nullptr);
+    n = rsaN ? BN_dup(rsaN) : nullptr;
+    e = rsaE ? BN_dup(rsaE) : nullptr;
+#endif
+
+    std::unique_ptr<BIGNUM, decltype(&BN_free)> modulus(n, BN_free), exponent(e, BN_free);
+    if (!modulus || !exponent) { return -1; }
+
+    // the RFC 4253 ssh-rsa blob, string "ssh-rsa", mpint e, mpint n.
+    std::vector<unsigned char> blob;
+    auto appendString = [&blob](const unsigned char* data, size_t size)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8) { blob.push_back((size >> shift) & 0xff); }
+        blob.insert(blob.end(), data, data + size);
+    };
 
-    std::ofstream authFileOut(authFileName, std::ios::trunc);
-    for (auto& k : lines)
+    auto appendMpint = [&appendString](const BIGNUM* value)
     {
-        authFileOut << k << std::endl;
-    }
+        std::vector<unsigned char> bytes(BN_num_bytes(value) + 1, 0);
+        BN_bn2bin(value, bytes.data() + 1);
 
-    ret = 0;
-    authFileOut.close();
+        // a leading zero keeps the positive number from being read as negative.
+        size_t start = (bytes.size() > 1 && (bytes[1] & 0x80)) ? 0 : 1;
+        appendString(bytes.data() + start, bytes.size() - start);
+    };
 
-    return ret;
+    const std::string type = "ssh-rsa";
+    appendString(reinterpret_cast<const unsigned char*>(type.data()), type.size());
+    appendMpint(exponent.get());
+    appendMpint(modulus.get());
+
+    std::vector<unsigned char> encoded(4 * ((blob.size() + 2) / 3) + 1);
+    int encodedLength = EVP_EncodeBlock(encoded.data(), blob.data(), (int)blob.size());
+
+    publicKey = String::Join("", type, " ", std::string(encoded.begin(), encoded.begin() + encodedLength), "\n");
+
+    return 0;
+}
+
+bool System::WriteAll(int fd, const std::string& content)
+{
+    size_t written = 0;
+    while (written < content.size())
+    {
+        ssize_t ret = write(fd, content.data() + written, content.size() - written);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        written += ret;
+    }
+
+    return true;
 }
 
 int System::DeleteUser(const std::string& userName)
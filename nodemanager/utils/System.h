@@ -3,6 +3,9 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
 
 #include "String.h"
 #include "Logger.h"
@@ -97,9 +100,15 @@ namespace hpc
                 static int Iostat(float &bytesPerSec);
                 static int IostatX(float &queueLength);
                 static int FreeSpace(float &freeSpaceKB);
+                static int Pressure(const std::string& resource, float &someAvg10, float &fullAvg10);
+                static bool ParsePressure(const std::string& content, const std::string& kind, float &avg10, uint64_t &totalUs);
                 static const std::string& GetNodeName();
                 static bool IsCGroupInstalled();
 
+                // the start time of the process in clock ticks after boot, 0 when the process is gone.
+                // together with the pid it identifies a process across pid reuse.
+                static uint64_t GetProcessStartTime(pid_t pid);
+
                 static const std::string& GetDistroInfo();
 
                 static int CreateUser(
@@ -129,6 +138,11 @@ namespace hpc
                     const std::string& key);
 
                 static int GetHomeDir(const std::string& userName, std::string& homeDir);
+                static int GetUserEntry(const std::string& userName, uid_t& uid, gid_t& gid, std::string& homeDir);
+
+                /// Derives the "ssh-rsa" public key line from a PEM RSA private key, returns -1 for other keys.
+                static int GetSshPublicKey(const std::string& privateKey, std::string& publicKey);
+                static std::string GetKeyFingerprint(const std::string& key);
 
                 static int DeleteUser(const std::string& userName);
                 static int CreateTempFolder(char* folderTemplate, const std::string& userName);
@@ -202,6 +216,18 @@ namespace hpc
 
             protected:
             private:
+                static int CreateSshFolder(const std::string& userName, uid_t uid, gid_t gid, const std::string& homeDir, std::string& sshFolder);
+
+                /// Rewrites authorized_keys to a temp file and renames it under an flock of the .ssh folder,
+                /// returns -2 when update leaves the lines unchanged.
+                static int UpdateAuthorizedKeys(
+                    const std::string& userName,
+                    bool createFolder,
+                    mode_t mode,
+                    const std::function<bool(std::vector<std::string>&)>& update,
+                    std::string& filePath);
+
+                static bool WriteAll(int fd, const std::string& content);
         };
     }
 }
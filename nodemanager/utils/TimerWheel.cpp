@@ -0,0 +1,178 @@
+#include <chrono>
+#include <pplx/pplxtasks.h>
+
+#include "TimerWheel.h"
+#include "Logger.h"
+
+using namespace hpc::utils;
+
+const int TimerWheel::TickMs;
+
+TimerWheel& TimerWheel::GetInstance()
+{
+    static TimerWheel instance;
+    return instance;
+}
+
+TimerWheel::TimerWheel(bool ticking)
+{
+    if (!ticking)
+    {
+        return;
+    }
+
+    int result = pthread_create(&this->threadId, nullptr, TickingThread, this);
+    if (result != 0)
+    {
+        Logger::Error("Create timer wheel thread result {0}, errno {1}", result, errno);
+        this->threadId = 0;
+    }
+}
+
+TimerWheel::~TimerWheel()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->isRunning = false;
+    }
+
+    this->stopping.notify_all();
+    if (this->threadId != 0)
+    {
+        pthread_join(this->threadId, nullptr);
+    }
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(int delayMs, std::function<void()> callback)
+{
+    uint64_t ticks = delayMs <= 0 ? 1 : (delayMs + TickMs - 1) / TickMs;
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    TimerId id = this->nextId++;
+    Slot pending;
+    pending.push_back(Timer { id, this->currentTick + ticks, std::move(callback) });
+    this->Place(pending, pending.begin());
+
+    return id;
+}
+
+bool TimerWheel::Cancel(TimerId id)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    auto it = this->timers.find(id);
+    if (it == this->timers.end())
+    {
+        return false;
+    }
+
+    it->second.first->erase(it->second.second);
+    this->timers.erase(it);
+
+    return true;
+}
+
+void TimerWheel::Place(Slot& from, Slot::iterator it)
+{
+    uint64_t delta = it->ExpireTick > this->currentTick ? it->ExpireTick - this->currentTick : 0;
+
+    int level = 0;
+    while (level < LevelCount - 1 && delta >= (1ull << (SlotBits * (level + 1))))
+    {
+        level++;
+    }
+
+    // beyond the last level the timer goes round the outermost wheel again.
+    Slot& slot = this->slots[level][(it->ExpireTick >> (SlotBits * level)) & (SlotCount - 1)];
+    slot.splice(slot.end(), from, it);
+    this->timers[it->Id] = std::make_pair(&slot, it);
+}
+
+void TimerWheel::Tick(std::vector<std::function<void()>>& expired)
+{
+    this->currentTick++;
+
+    // cascade the timers of the upper levels whose slot comes around.
+    for (int level = 1; level < LevelCount; level++)
+    {
+        if ((this->currentTick & ((1ull << (SlotBits * level)) - 1)) != 0)
+        {
+            break;
+        }
+
+        Slot cascading;
+        cascading.splice(cascading.end(), this->slots[level][(this->currentTick >> (SlotBits * level)) & (SlotCount - 1)]);
+        while (!cascading.empty())
+        {
+            this->Place(cascading, cascading.begin());
+        }
+    }
+
+    Slot due;
+    due.splice(due.end(), this->slots[0][this->currentTick & (SlotCount - 1)]);
+    while (!due.empty())
+    {
+        if (due.front().ExpireTick > this->currentTick)
+        {
+            // a timer from the wrapped outermost wheel, not yet due.
+            this->Place(due, due.begin());
+            continue;
+        }
+
+        expired.push_back(std::move(due.front().Callback));
+        this->timers.erase(due.front().Id);
+        due.pop_front();
+    }
+}
+
+void* TimerWheel::TickingThread(void* arg)
+{
+    TimerWheel* const w = static_cast<TimerWheel* const>(arg);
+    auto nextTick = std::chrono::steady_clock::now() + std::chrono::milliseconds(TickMs);
+
+    std::unique_lock<std::mutex> guard(w->lock);
+    while (w->isRunning)
+    {
+        if (w->stopping.wait_until(guard, nextTick, [w]() { return !w->isRunning; }))
+        {
+            break;
+        }
+
+        std::vector<std::function<void()>> expired;
+
+        // catch up the ticks missed when the thread was late.
+        auto now = std::chrono::steady_clock::now();
+        while (nextTick <= now)
+        {
+            w->Tick(expired);
+            nextTick += std::chrono::milliseconds(TickMs);
+        }
+
+        if (expired.empty()) continue;
+
+        guard.unlock();
+        for (auto& callback : expired)
+        {
+            pplx::create_task([callback = std::move(callback)]()
+            {
+                try
+                {
+                    callback();
+                }
+                catch (const std::exception& ex)
+                {
+                    Logger::Error("Exception happened in timer callback, ex = {0}", ex.what());
+                }
+                catch (...)
+                {
+                    Logger::Error("Unknown exception happened in timer callback");
+                }
+            });
+        }
+
+        guard.lock();
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,87 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <inttypes.h>
+#include <pthread.h>
+
+namespace hpc
+{
+#ifdef DEBUG
+    namespace tests
+    {
+        class TimerWheelTest;
+    }
+#endif // DEBUG
+
+    namespace utils
+    {
+        /// A hierarchical timing wheel on one thread, for delayed and cancellable callbacks.
+        /// Schedule and Cancel are O(1), the expired callbacks run on the pplx thread pool.
+        class TimerWheel
+        {
+            public:
+                typedef uint64_t TimerId;
+
+                static TimerWheel& GetInstance();
+
+                ~TimerWheel();
+
+                TimerWheel(const TimerWheel&) = delete;
+                TimerWheel& operator=(const TimerWheel&) = delete;
+
+                /// Runs the callback once after the delay, returns the id to cancel it with.
+                TimerId Schedule(int delayMs, std::function<void()> callback);
+
+                /// Returns false when the timer already fired or doesn't exist.
+                bool Cancel(TimerId id);
+
+                static const int TickMs = 100;
+
+            protected:
+            private:
+#ifdef DEBUG
+                // drives Tick without the thread.
+                friend class hpc::tests::TimerWheelTest;
+#endif // DEBUG
+
+                explicit TimerWheel(bool ticking = true);
+
+                struct Timer
+                {
+                    TimerId Id;
+                    uint64_t ExpireTick;
+                    std::function<void()> Callback;
+                };
+
+                typedef std::list<Timer> Slot;
+
+                static void* TickingThread(void* arg);
+                void Tick(std::vector<std::function<void()>>& expired);
+                void Place(Slot& from, Slot::iterator it);
+
+                // 4 levels of 64 slots cover 64^4 ticks, about 19 days.
+                static const int SlotBits = 6;
+                static const int SlotCount = 1 << SlotBits;
+                static const int LevelCount = 4;
+
+                Slot slots[LevelCount][SlotCount];
+                std::unordered_map<TimerId, std::pair<Slot*, Slot::iterator>> timers;
+
+                uint64_t currentTick = 0;
+                TimerId nextId = 1;
+
+                std::mutex lock;
+                std::condition_variable stopping;
+                bool isRunning = true;
+                pthread_t threadId = 0;
+        };
+    }
+}
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,40 @@
+#include "UnionFindSet.h"
+
+using namespace hpc::utils;
+
+void UnionFindSet::AddPair(int child, int parent)
+{
+    int childRoot = this->FindParent(child);
+    int parentRoot = this->FindParent(parent);
+
+    if (childRoot != parentRoot)
+    {
+        this->parents[childRoot] = parentRoot;
+    }
+}
+
+int UnionFindSet::FindParent(int child)
+{
+    auto it = this->parents.find(child);
+    if (it == this->parents.end())
+    {
+        this->parents.emplace(child, child);
+        return child;
+    }
+
+    int root = child;
+    while (this->parents[root] != root)
+    {
+        root = this->parents[root];
+    }
+
+    // path compression, iterative for the deep process trees.
+    while (child != root)
+    {
+        int& parent = this->parents[child];
+        child = parent;
+        parent = root;
+    }
+
+    return root;
+}
@@ -0,0 +1,30 @@
+#ifndef UNIONFINDSET_H
+#define UNIONFINDSET_H
+
+#include <unordered_map>
+#include <cstddef>
+
+namespace hpc
+{
+    namespace utils
+    {
+        /// Disjoint sets of ids, where the representative of a set is its topmost parent,
+        /// so that a process tree is found by its ancestor.
+        class UnionFindSet
+        {
+            public:
+                void Clear() { this->parents.clear(); }
+                void Reserve(size_t count) { this->parents.reserve(count); }
+
+                /// Links the set of the child under the set of the parent.
+                void AddPair(int child, int parent);
+
+                int FindParent(int child);
+
+            private:
+                std::unordered_map<int, int> parents;
+        };
+    }
+}
+
+#endif // UNIONFINDSET_H
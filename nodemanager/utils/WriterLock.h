@@ -3,6 +3,8 @@
 
 #include <pthread.h>
 
+#include "LockStatistics.h"
+
 namespace hpc
 {
     namespace utils
@@ -10,11 +12,32 @@ namespace hpc
         class WriterLock
         {
             public:
-                WriterLock(pthread_rwlock_t* l) : lock(l) { pthread_rwlock_wrlock(lock); }
-                ~WriterLock() { pthread_rwlock_unlock(lock); }
+                WriterLock(pthread_rwlock_t* l, LockStatistics* s = nullptr) : lock(l), statistics(s)
+                {
+                    if (statistics)
+                    {
+                        auto waitStart = LockStatistics::Clock::now();
+                        pthread_rwlock_wrlock(lock);
+                        acquired = LockStatistics::Clock::now();
+                        waited = acquired - waitStart;
+                    }
+                    else
+                    {
+                        pthread_rwlock_wrlock(lock);
+                    }
+                }
+
+                ~WriterLock()
+                {
+                    pthread_rwlock_unlock(lock);
+                    if (statistics) { statistics->Record(waited, LockStatistics::Clock::now() - acquired); }
+                }
             protected:
             private:
                 pthread_rwlock_t* lock;
+                LockStatistics* statistics;
+                LockStatistics::Clock::time_point acquired;
+                LockStatistics::Clock::duration waited;
         };
     }
 }